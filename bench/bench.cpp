@@ -0,0 +1,287 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+
+#include "sx/kernels.h"
+#include "sx/parallel.h"
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            struct registered {
+                std::string name;
+                function f;
+                ssize_t size, stride, bytes;
+            };
+
+            struct result {
+                std::string name;
+                ssize_t size, stride, bytes;
+                ssize_t iterations;
+                double real_ns, cpu_ns;     //per iteration
+                double items_per_second, bytes_per_second;
+                perf_counters::counts counts;   //per iteration
+                double bytes_per_iteration;
+            };
+
+            struct options {
+                std::string filter;
+                double min_time;
+                ssize_t max_bytes;
+                std::string out;
+                bool list;
+                bool counters;
+
+                options() : min_time(0.1), max_bytes(-1), list(false), counters(true) {
+                }
+            };
+
+            std::vector<registered> &registry() {
+                static std::vector<registered> r;
+                return r;
+            }
+
+            double cpu_now() {
+                return double(std::clock()) / CLOCKS_PER_SEC;
+            }
+
+            double real_now() {
+                return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            bool parse_flag(const char *arg, const char *name, std::string &value) {
+                const size_t n = strlen(name);
+                if (strncmp(arg, name, n) != 0 || arg[n] != '=')
+                    return false;
+                value = arg + n + 1;
+                return true;
+            }
+
+            options parse_options(int argc, const char *argv[]) {
+                options opts;
+                for (int i = 1; i < argc; ++i) {
+                    std::string v;
+                    if (parse_flag(argv[i], "--filter", v))
+                        opts.filter = v;
+                    else if (parse_flag(argv[i], "--min_time", v))
+                        opts.min_time = atof(v.c_str());
+                    else if (parse_flag(argv[i], "--max_bytes", v))
+                        opts.max_bytes = atoll(v.c_str());
+                    else if (parse_flag(argv[i], "--out", v))
+                        opts.out = v;
+                    else if (parse_flag(argv[i], "--counters", v))
+                        opts.counters = atoi(v.c_str()) != 0;
+                    else if (strcmp(argv[i], "--list") == 0)
+                        opts.list = true;
+                    else
+                        throw std::runtime_error(std::string("sx_bench: unknown argument ") + argv[i]);
+                }
+                return opts;
+            }
+
+            result run_one(const registered &b, const options &opts, perf_counters *counters) {
+                const state st = measure(b.f, b.size, b.stride, opts.min_time, counters);
+                const ssize_t iterations = st.iterations();
+                const double t = st.real_seconds();
+                result r;
+                r.name = b.name;
+                r.size = b.size;
+                r.stride = b.stride;
+                r.bytes = b.bytes;
+                r.iterations = iterations;
+                r.real_ns = t * 1e9 / iterations;
+                r.cpu_ns = st.cpu_seconds() * 1e9 / iterations;
+                r.items_per_second = t > 0 ? st.items_processed() / t : 0;
+                r.bytes_per_second = t > 0 ? st.bytes_processed() / t : 0;
+                r.counts = st.counts();
+                for (double &x : r.counts.value)
+                    x /= iterations;
+                r.bytes_per_iteration = double(st.bytes_processed()) / iterations;
+                return r;
+            }
+
+            //raw counts per iteration, and ipc and bytes_per_cycle derived from them
+            void write_counters(FILE *f, const result &r) {
+                const perf_counters::counts &c = r.counts;
+                for (int i = 0; i < perf_counters::ncounters; ++i)
+                    if (c.valid[i])
+                        fprintf(f, "      \"%s\": %.6g,\n", perf_counters::name(perf_counters::counter(i)), c.value[i]);
+                const double cycles = c.value[perf_counters::cycles];
+                if (!c.valid[perf_counters::cycles] || cycles <= 0)
+                    return;
+                if (c.valid[perf_counters::instructions])
+                    fprintf(f, "      \"ipc\": %.6g,\n", c.value[perf_counters::instructions] / cycles);
+                fprintf(f, "      \"bytes_per_cycle\": %.6g,\n", r.bytes_per_iteration / cycles);
+            }
+
+            void write_json(FILE *f, const std::vector<result> &results, const perf_counters *counters) {
+                fprintf(f, "{\n");
+                write_json_context(f, counters);
+                fprintf(f, ",\n  \"benchmarks\": [");
+                for (size_t i = 0; i < results.size(); ++i) {
+                    const result &r = results[i];
+                    fprintf(f, "%s\n    {\n", i == 0 ? "" : ",");
+                    fprintf(f, "      \"name\": %s,\n", json_string(r.name).c_str());
+                    fprintf(f, "      \"size\": %td,\n", r.size);
+                    fprintf(f, "      \"stride\": %td,\n", r.stride);
+                    fprintf(f, "      \"bytes\": %td,\n", r.bytes);
+                    fprintf(f, "      \"iterations\": %td,\n", r.iterations);
+                    fprintf(f, "      \"real_time\": %.6g,\n", r.real_ns);
+                    fprintf(f, "      \"cpu_time\": %.6g,\n", r.cpu_ns);
+                    fprintf(f, "      \"time_unit\": \"ns\",\n");
+                    write_counters(f, r);
+                    fprintf(f, "      \"items_per_second\": %.6g,\n", r.items_per_second);
+                    fprintf(f, "      \"bytes_per_second\": %.6g\n", r.bytes_per_second);
+                    fprintf(f, "    }");
+                }
+                fprintf(f, "\n  ]\n}\n");
+            }
+        }
+
+        state::state(ssize_t size, ssize_t stride, ssize_t iterations, perf_counters *counters)
+                : size_(size), stride_(stride), iterations_(iterations), done_(0),
+                  real_start_(0), cpu_start_(0), real_(0), cpu_(0), items_(0), bytes_(0), counters_(counters) {
+        }
+
+        void state::start_timer() {
+            real_start_ = real_now();
+            cpu_start_ = cpu_now();
+            if (counters_)
+                counters_->start();
+        }
+
+        void state::stop_timer() {
+            if (counters_)
+                counts_ = counters_->stop();
+            real_ = real_now() - real_start_;
+            cpu_ = cpu_now() - cpu_start_;
+        }
+
+        const std::vector<ssize_t> &sweep_bytes() {
+            //L1, L2, L3 and DRAM on typical x86 and arm64 parts
+            static const std::vector<ssize_t> b = {ssize_t(16) << 10, ssize_t(256) << 10, ssize_t(4) << 20, ssize_t(64) << 20};
+            return b;
+        }
+
+        int register_sweep(const std::string &name, function f, ssize_t elem_size, bool strided) {
+            static const ssize_t strides[] = {1, 4};
+            for (ssize_t bytes : sweep_bytes()) {
+                for (ssize_t stride : strides) {
+                    if (stride != 1 && !strided)
+                        break;
+                    registered r;
+                    r.name = name + "/bytes:" + std::to_string(bytes) + "/stride:" + std::to_string(stride);
+                    r.f = f;
+                    r.size = bytes / (elem_size * stride);
+                    r.stride = stride;
+                    r.bytes = bytes;
+                    registry().push_back(r);
+                }
+            }
+            return 0;
+        }
+
+        state measure(function f, ssize_t size, ssize_t stride, double min_time, perf_counters *counters) {
+            const ssize_t max_iterations = ssize_t(1) << 30;
+            ssize_t iterations = 1;
+            for (;;) {
+                state st(size, stride, iterations, counters);
+                f(st);
+                const double t = st.real_seconds();
+                if (t >= min_time || iterations >= max_iterations)
+                    return st;
+                //aim past min_time with the next run, growing at most 10x at once
+                const double factor = t > 0 ? std::min(10.0, 1.4 * min_time / t) : 10.0;
+                iterations = std::min(max_iterations, std::max(iterations + 1, ssize_t(iterations * factor)));
+            }
+        }
+
+        std::string json_string(const std::string &s) {
+            std::string r = "\"";
+            for (char c : s) {
+                if (c == '"' || c == '\\')
+                    r += '\\';
+                r += c;
+            }
+            return r + "\"";
+        }
+
+        void write_json_context(FILE *f, const perf_counters *counters) {
+            char date[64];
+            const std::time_t now = std::time(nullptr);
+            strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+            fprintf(f, "  \"context\": {\n");
+            fprintf(f, "    \"date\": \"%s\",\n", date);
+            fprintf(f, "    \"num_cpus\": %td,\n", default_thread_count());
+            fprintf(f, "    \"perf_counters\": %s,\n", json_string(
+                    !counters ? "off" : counters->available() ? "on" : counters->error()).c_str());
+            fprintf(f, "    \"isa\": \"%s\",\n", isa_name(active_isa()));
+#ifdef __OPTIMIZE__
+            fprintf(f, "    \"library_build_type\": \"release\"\n");
+#else
+            fprintf(f, "    \"library_build_type\": \"debug\"\n");
+#endif
+            fprintf(f, "  }");
+        }
+
+        darray1<ssize_t> make_permutation(ssize_t n, uint32_t seed) {
+            darray1<ssize_t> p(n);
+            for (ssize_t i = 0; i < n; ++i)
+                p[i] = i;
+            for (ssize_t i = n - 1; i > 0; --i) {
+                seed = seed * 1664525u + 1013904223u;
+                std::swap(p[i], p[ssize_t((uint64_t(seed) * uint64_t(i + 1)) >> 32)]);
+            }
+            return p;
+        }
+
+        int run(int argc, const char *argv[]) {
+            const options opts = parse_options(argc, argv);
+#ifndef __OPTIMIZE__
+            fprintf(stderr, "sx_bench: built without optimization, timings are not representative\n");
+#endif
+            std::unique_ptr<perf_counters> counters;
+            if (opts.counters && !opts.list) {
+                counters.reset(new perf_counters());
+                if (!counters->available())
+                    fprintf(stderr, "sx_bench: no hardware counters, %s\n", counters->error().c_str());
+            }
+            std::vector<result> results;
+            for (const registered &b : registry()) {
+                if (!opts.filter.empty() && b.name.find(opts.filter) == std::string::npos)
+                    continue;
+                if (opts.max_bytes >= 0 && b.bytes > opts.max_bytes)
+                    continue;
+                if (opts.list) {
+                    printf("%s\n", b.name.c_str());
+                    continue;
+                }
+                results.push_back(run_one(b, opts, counters && counters->available() ? counters.get() : nullptr));
+                const result &r = results.back();
+                fprintf(stderr, "%-60s %14.1f ns %12td", r.name.c_str(), r.real_ns, r.iterations);
+                const perf_counters::counts &c = r.counts;
+                if (c.valid[perf_counters::cycles] && c.valid[perf_counters::instructions] && c.value[perf_counters::cycles] > 0)
+                    fprintf(stderr, "  ipc %.2f", c.value[perf_counters::instructions] / c.value[perf_counters::cycles]);
+                fprintf(stderr, "\n");
+            }
+            if (opts.list)
+                return EXIT_SUCCESS;
+            FILE *f = opts.out.empty() ? stdout : fopen(opts.out.c_str(), "w");
+            if (!f)
+                throw std::runtime_error("sx_bench: can't open " + opts.out);
+            write_json(f, results, counters.get());
+            if (f != stdout)
+                fclose(f);
+            return EXIT_SUCCESS;
+        }
+
+    }
+}
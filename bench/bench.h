@@ -0,0 +1,188 @@
+#ifndef BENCH_INCLUDED_7340915
+#define BENCH_INCLUDED_7340915
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "sx/array1.h"
+#include "perf_counters.h"
+
+namespace sx {
+    namespace bench {
+
+        //passed to a benchmark function, which sets up its input and then times
+        //    while (st.keep_running())
+        //        ...
+        class state {
+        public:
+            //counters, if not null, count along with the timer
+            state(ssize_t size, ssize_t stride, ssize_t iterations, perf_counters *counters = nullptr);
+
+            //elements of the input, and the step between them in the underlying buffer
+            ssize_t size() const {
+                return size_;
+            }
+
+            ssize_t stride() const {
+                return stride_;
+            }
+
+            ssize_t iterations() const {
+                return iterations_;
+            }
+
+            //the first call starts the timer, the one returning false stops it
+            bool keep_running() {
+                if (done_ == 0)
+                    start_timer();
+                if (done_ < iterations_) {
+                    ++done_;
+                    return true;
+                }
+                stop_timer();
+                return false;
+            }
+
+            //totals over all iterations, reported per second
+            void set_items_processed(int64_t n) {
+                items_ = n;
+            }
+
+            void set_bytes_processed(int64_t n) {
+                bytes_ = n;
+            }
+
+            double real_seconds() const {
+                return real_;
+            }
+
+            double cpu_seconds() const {
+                return cpu_;
+            }
+
+            int64_t items_processed() const {
+                return items_;
+            }
+
+            int64_t bytes_processed() const {
+                return bytes_;
+            }
+
+            const perf_counters::counts &counts() const {
+                return counts_;
+            }
+
+        private:
+            void start_timer();
+
+            void stop_timer();
+
+            ssize_t size_, stride_, iterations_, done_;
+            double real_start_, cpu_start_, real_, cpu_;
+            int64_t items_, bytes_;
+            perf_counters *counters_;
+            perf_counters::counts counts_;
+        };
+
+        typedef void (*function)(state &);
+
+        //bytes of input the sweeps run at, from L1-resident to DRAM
+        const std::vector<ssize_t> &sweep_bytes();
+
+        //registers name/bytes:B/stride:S for every sweep size, and for strides 1 and 4 if strided,
+        //with size() = B / (elem_size * stride) so the buffer behind the view is B bytes
+        int register_sweep(const std::string &name, function f, ssize_t elem_size, bool strided);
+
+        //runs the registered benchmarks selected by the command line, writes JSON, returns the exit code
+        //  --filter=substring  --min_time=seconds  --max_bytes=n  --out=file  --list
+        //  --counters=0 turns off the hardware counters, they are recorded when the system allows it
+        int run(int argc, const char *argv[]);
+
+        //runs f with growing iteration counts until one run takes at least min_time seconds, returns that run
+        state measure(function f, ssize_t size, ssize_t stride, double min_time, perf_counters *counters = nullptr);
+
+        //quoted and escaped
+        std::string json_string(const std::string &s);
+
+        //writes the "context" member shared by the JSON outputs, without a trailing comma or newline
+        void write_json_context(FILE *f, const perf_counters *counters);
+
+        //keeps the compiler from dropping the computation of x
+        template<typename T, typename std::enable_if<!std::is_scalar<T>::value>::type * = nullptr>
+        inline void do_not_optimize(const T &x) {
+#if defined(__GNUC__) || defined(__clang__)
+            asm volatile("" : : "r"(&x) : "memory");
+#else
+            const volatile char *p = reinterpret_cast<const volatile char *>(&x);
+            (void) *p;
+#endif
+        }
+
+        //scalars go by value: taking the address of an accumulator makes it escape, and then the loop stores
+        //it to the stack on every iteration, which times the stack slot rather than the loop
+        template<typename T, typename std::enable_if<std::is_scalar<T>::value>::type * = nullptr>
+        inline void do_not_optimize(const T &x) {
+#if defined(__GNUC__) || defined(__clang__)
+            asm volatile("" : : "r,m"(x) : "memory");
+#else
+            const volatile T y = x;
+            (void) y;
+#endif
+        }
+
+        //deterministic pseudo random values in [0, 64)
+        template<typename T>
+        darray1<T> make_data(ssize_t n, uint32_t seed = 1) {
+            darray1<T> result(n);
+            for (ssize_t i = 0; i < n; ++i) {
+                seed = seed * 1664525u + 1013904223u;
+                result[i] = T(seed >> 26);
+            }
+            return result;
+        }
+
+        //random permutation of [0, n)
+        darray1<ssize_t> make_permutation(ssize_t n, uint32_t seed = 1);
+
+        //make_data behind a strided view as the state asks for
+        template<typename T>
+        class input {
+        public:
+            explicit input(const state &st, uint32_t seed = 1)
+                    : buffer_(make_data<T>(st.size() * st.stride(), seed)), stride_(st.stride()) {
+            }
+
+            array1<T> view() const {
+                return array1<T>(buffer_).step(stride_);
+            }
+
+            marray1<T> mview() {
+                return marray1<T>(buffer_).step(stride_);
+            }
+
+        private:
+            darray1<T> buffer_;
+            ssize_t stride_;
+        };
+
+    }
+}
+
+#define SX_BENCH_CONCAT2(a, b) a##b
+#define SX_BENCH_CONCAT(a, b) SX_BENCH_CONCAT2(a, b)
+
+//registers f<int> and f<double> as name<int> and name<double>, swept over sizes and strides
+#define SX_BENCH_TYPED(name, f) \
+    static const int SX_BENCH_CONCAT(bench_registered_, __LINE__) = \
+        (::sx::bench::register_sweep(#name "<int>", &f<int>, sizeof(int), true), \
+         ::sx::bench::register_sweep(#name "<double>", &f<double>, sizeof(double), true));
+
+//registers f swept over sizes only, size() counts bytes
+#define SX_BENCH_BYTES(name, f) \
+    static const int SX_BENCH_CONCAT(bench_registered_, __LINE__) = \
+        ::sx::bench::register_sweep(#name, &f, 1, false);
+
+#endif
@@ -0,0 +1,457 @@
+#include "bench.h"
+#include "sx/dynamic_bitset.h"
+
+//one benchmark per dynamic_bitset operation, size() is the number of bytes of bits
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            typedef dynamic_bitset::size_type bit_size_type;
+
+            dynamic_bitset make_bits(bit_size_type nbits, uint64_t seed) {
+                dynamic_bitset b(nbits);
+                std::vector<dynamic_bitset::block_type> blocks(b.num_blocks());
+                for (auto &x : blocks) {
+                    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                    x = seed ^ (seed >> 29);
+                }
+                from_block_range(blocks.begin(), blocks.end(), b);
+                return b;
+            }
+
+            bit_size_type nbits(const state &st) {
+                return bit_size_type(st.size()) * 8;
+            }
+
+            void processed(state &st, int64_t bits_per_iteration) {
+                st.set_items_processed(int64_t(st.iterations()) * bits_per_iteration);
+                st.set_bytes_processed(int64_t(st.iterations()) * bits_per_iteration / 8);
+            }
+
+            void bm_construct(state &st) {
+                const bit_size_type n = nbits(st);
+                while (st.keep_running()) {
+                    dynamic_bitset b(n);
+                    do_not_optimize(b);
+                }
+                processed(st, n);
+            }
+
+            void bm_copy(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    dynamic_bitset b(a);
+                    do_not_optimize(b);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_resize(state &st) {
+                const bit_size_type n = nbits(st);
+                while (st.keep_running()) {
+                    dynamic_bitset b;
+                    b.resize(n, true);
+                    do_not_optimize(b);
+                }
+                processed(st, n);
+            }
+
+            void bm_push_back(state &st) {
+                const bit_size_type n = nbits(st);
+                while (st.keep_running()) {
+                    dynamic_bitset b;
+                    for (bit_size_type i = 0; i < n; ++i)
+                        b.push_back((i & 3) == 0);
+                    do_not_optimize(b);
+                }
+                processed(st, n);
+            }
+
+            void bm_append(state &st) {
+                const bit_size_type n = nbits(st);
+                while (st.keep_running()) {
+                    dynamic_bitset b;
+                    for (bit_size_type i = 0; i < n; i += dynamic_bitset::bits_per_block)
+                        b.append(dynamic_bitset::block_type(i));
+                    do_not_optimize(b);
+                }
+                processed(st, n);
+            }
+
+            void bm_and_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                const dynamic_bitset b = make_bits(nbits(st), 2);
+                while (st.keep_running()) {
+                    a &= b;
+                    do_not_optimize(a);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_or_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                const dynamic_bitset b = make_bits(nbits(st), 2);
+                while (st.keep_running()) {
+                    a |= b;
+                    do_not_optimize(a);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_xor_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                const dynamic_bitset b = make_bits(nbits(st), 2);
+                while (st.keep_running()) {
+                    a ^= b;
+                    do_not_optimize(a);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_minus_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                const dynamic_bitset b = make_bits(nbits(st), 2);
+                while (st.keep_running()) {
+                    a -= b;
+                    do_not_optimize(a);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_shift_left_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    a <<= 3;
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_shift_right_assign(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    a >>= 3;
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_shift_left(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running())
+                    do_not_optimize(a << 67);
+                processed(st, a.size());
+            }
+
+            void bm_shift_right(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running())
+                    do_not_optimize(a >> 67);
+                processed(st, a.size());
+            }
+
+            void bm_and(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b = make_bits(nbits(st), 2);
+                while (st.keep_running())
+                    do_not_optimize(a & b);
+                processed(st, 2 * a.size());
+            }
+
+            void bm_or(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b = make_bits(nbits(st), 2);
+                while (st.keep_running())
+                    do_not_optimize(a | b);
+                processed(st, 2 * a.size());
+            }
+
+            void bm_xor(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b = make_bits(nbits(st), 2);
+                while (st.keep_running())
+                    do_not_optimize(a ^ b);
+                processed(st, 2 * a.size());
+            }
+
+            void bm_minus(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b = make_bits(nbits(st), 2);
+                while (st.keep_running())
+                    do_not_optimize(a - b);
+                processed(st, 2 * a.size());
+            }
+
+            void bm_complement(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running())
+                    do_not_optimize(~a);
+                processed(st, a.size());
+            }
+
+            void bm_set_all(state &st) {
+                dynamic_bitset a(nbits(st));
+                while (st.keep_running()) {
+                    a.set();
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_reset_all(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    a.reset();
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_flip_all(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    a.flip();
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_set_each(state &st) {
+                dynamic_bitset a(nbits(st));
+                while (st.keep_running()) {
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        a.set(i, (i & 1) != 0);
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_reset_each(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        a.reset(i);
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_flip_each(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        a.flip(i);
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_test_each(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bit_size_type n = 0;
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        n += a.test(i);
+                    do_not_optimize(n);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_test_set_each(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bit_size_type n = 0;
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        n += a.test_set(i, (i & 1) != 0);
+                    do_not_optimize(n);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_index_read(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bit_size_type n = 0;
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        n += a[i];
+                    do_not_optimize(n);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_index_write(state &st) {
+                dynamic_bitset a(nbits(st));
+                while (st.keep_running()) {
+                    for (bit_size_type i = 0; i < a.size(); ++i)
+                        a[i] = (i % 3) == 0;
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_all(state &st) {
+                dynamic_bitset a(nbits(st));
+                a.set();
+                while (st.keep_running()) {
+                    bool r = a.all();
+                    do_not_optimize(r);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_any(state &st) {
+                const dynamic_bitset a(nbits(st));
+                while (st.keep_running()) {
+                    bool r = a.any();
+                    do_not_optimize(r);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_none(state &st) {
+                const dynamic_bitset a(nbits(st));
+                while (st.keep_running()) {
+                    bool r = a.none();
+                    do_not_optimize(r);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_count(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bit_size_type r = a.count();
+                    do_not_optimize(r);
+                }
+                processed(st, a.size());
+            }
+
+            //subsets and intersections are checked on their worst case, when the loop can't exit early
+            void bm_is_subset_of(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bool r = a.is_subset_of(a);
+                    do_not_optimize(r);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_is_proper_subset_of(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bool r = a.is_proper_subset_of(a);
+                    do_not_optimize(r);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_intersects(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                const dynamic_bitset b = ~a;
+                while (st.keep_running()) {
+                    bool r = a.intersects(b);
+                    do_not_optimize(r);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_find_next(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                while (st.keep_running()) {
+                    bit_size_type n = 0;
+                    for (bit_size_type i = a.find_first(); i != dynamic_bitset::npos; i = a.find_next(i))
+                        ++n;
+                    do_not_optimize(n);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_equal(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b(a);
+                while (st.keep_running()) {
+                    bool r = a == b;
+                    do_not_optimize(r);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_less(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1), b(a);
+                while (st.keep_running()) {
+                    bool r = a < b;
+                    do_not_optimize(r);
+                }
+                processed(st, 2 * a.size());
+            }
+
+            void bm_swap(state &st) {
+                dynamic_bitset a = make_bits(nbits(st), 1), b = make_bits(nbits(st), 2);
+                while (st.keep_running()) {
+                    swap(a, b);
+                    do_not_optimize(a);
+                }
+                processed(st, 0);
+            }
+
+            void bm_to_block_range(state &st) {
+                const dynamic_bitset a = make_bits(nbits(st), 1);
+                std::vector<dynamic_bitset::block_type> blocks(a.num_blocks());
+                while (st.keep_running()) {
+                    to_block_range(a, blocks.begin());
+                    do_not_optimize(blocks[0]);
+                }
+                processed(st, a.size());
+            }
+
+            void bm_from_block_range(state &st) {
+                dynamic_bitset a(nbits(st));
+                const std::vector<dynamic_bitset::block_type> blocks(a.num_blocks(), 0x5555555555555555ull);
+                while (st.keep_running()) {
+                    from_block_range(blocks.begin(), blocks.end(), a);
+                    do_not_optimize(a);
+                }
+                processed(st, a.size());
+            }
+        }
+
+        SX_BENCH_BYTES(bitset_construct, bm_construct)
+        SX_BENCH_BYTES(bitset_copy, bm_copy)
+        SX_BENCH_BYTES(bitset_resize, bm_resize)
+        SX_BENCH_BYTES(bitset_push_back, bm_push_back)
+        SX_BENCH_BYTES(bitset_append, bm_append)
+        SX_BENCH_BYTES(bitset_and_assign, bm_and_assign)
+        SX_BENCH_BYTES(bitset_or_assign, bm_or_assign)
+        SX_BENCH_BYTES(bitset_xor_assign, bm_xor_assign)
+        SX_BENCH_BYTES(bitset_minus_assign, bm_minus_assign)
+        SX_BENCH_BYTES(bitset_shift_left_assign, bm_shift_left_assign)
+        SX_BENCH_BYTES(bitset_shift_right_assign, bm_shift_right_assign)
+        SX_BENCH_BYTES(bitset_shift_left, bm_shift_left)
+        SX_BENCH_BYTES(bitset_shift_right, bm_shift_right)
+        SX_BENCH_BYTES(bitset_and, bm_and)
+        SX_BENCH_BYTES(bitset_or, bm_or)
+        SX_BENCH_BYTES(bitset_xor, bm_xor)
+        SX_BENCH_BYTES(bitset_minus, bm_minus)
+        SX_BENCH_BYTES(bitset_complement, bm_complement)
+        SX_BENCH_BYTES(bitset_set_all, bm_set_all)
+        SX_BENCH_BYTES(bitset_reset_all, bm_reset_all)
+        SX_BENCH_BYTES(bitset_flip_all, bm_flip_all)
+        SX_BENCH_BYTES(bitset_set_each, bm_set_each)
+        SX_BENCH_BYTES(bitset_reset_each, bm_reset_each)
+        SX_BENCH_BYTES(bitset_flip_each, bm_flip_each)
+        SX_BENCH_BYTES(bitset_test_each, bm_test_each)
+        SX_BENCH_BYTES(bitset_test_set_each, bm_test_set_each)
+        SX_BENCH_BYTES(bitset_index_read, bm_index_read)
+        SX_BENCH_BYTES(bitset_index_write, bm_index_write)
+        SX_BENCH_BYTES(bitset_all, bm_all)
+        SX_BENCH_BYTES(bitset_any, bm_any)
+        SX_BENCH_BYTES(bitset_none, bm_none)
+        SX_BENCH_BYTES(bitset_count, bm_count)
+        SX_BENCH_BYTES(bitset_is_subset_of, bm_is_subset_of)
+        SX_BENCH_BYTES(bitset_is_proper_subset_of, bm_is_proper_subset_of)
+        SX_BENCH_BYTES(bitset_intersects, bm_intersects)
+        SX_BENCH_BYTES(bitset_find_next, bm_find_next)
+        SX_BENCH_BYTES(bitset_equal, bm_equal)
+        SX_BENCH_BYTES(bitset_less, bm_less)
+        SX_BENCH_BYTES(bitset_swap, bm_swap)
+        SX_BENCH_BYTES(bitset_to_block_range, bm_to_block_range)
+        SX_BENCH_BYTES(bitset_from_block_range, bm_from_block_range)
+
+    }
+}
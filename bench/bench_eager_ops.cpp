@@ -0,0 +1,282 @@
+#include <functional>
+
+#include "bench.h"
+#include "sx/eager_ops.h"
+
+//one benchmark per op of eager_ops.h, input elements are strided views
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            template<typename T>
+            void processed(state &st, ssize_t n) {
+                st.set_items_processed(int64_t(st.iterations()) * n);
+                st.set_bytes_processed(int64_t(st.iterations()) * n * (int64_t) sizeof(T));
+            }
+
+            template<typename T>
+            void bm_where(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(where(x));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_equal_list(state &st) {
+                const input<T> in1(st), in2(st);
+                const array1<T> x = in1.view(), y = in2.view();
+                while (st.keep_running()) {
+                    bool r = x == y;
+                    do_not_optimize(r);
+                }
+                processed<T>(st, 2 * x.size());
+            }
+
+            template<typename T>
+            void bm_add(state &st) {
+                const input<T> in1(st, 1), in2(st, 2);
+                const array1<T> x = in1.view(), y = in2.view();
+                while (st.keep_running())
+                    do_not_optimize(x + y);
+                processed<T>(st, 2 * x.size());
+            }
+
+            template<typename T>
+            void bm_mul_atom(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(x * T(3));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_div_atom(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(x / T(3));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_equal_atom(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(x == T(7));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_horzcat_list_atom(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(horzcat(x, T(1)));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_horzcat_atom_list(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(horzcat(T(1), x));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_grade_up(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(grade_up(x));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_grade_down(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(grade_down(x));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_drop(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    do_not_optimize(drop(1)(x));
+                    do_not_optimize(drop(-1)(x));
+                }
+                processed<T>(st, 0);
+            }
+
+            template<typename T>
+            void bm_cut(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                darray1<ssize_t> idcs;
+                for (ssize_t i = 0; i < x.size(); i += 16)
+                    idcs.push_back(i);
+                while (st.keep_running())
+                    do_not_optimize(cut(idcs, x));
+                processed<T>(st, idcs.size());
+            }
+
+            template<typename T>
+            void bm_each(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running())
+                    do_not_optimize(each([](const T &a) { return a * 2 + 1; }, x));
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_over_init(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T r = over(T(0), std::plus<T>(), x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_over(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    auto r = over(std::plus<T>(), x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_gather(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                const darray1<ssize_t> idcs = make_permutation(x.size());
+                while (st.keep_running()) {
+                    darray1<T> r = gather(x, idcs);
+                    do_not_optimize(r.data());
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_sum(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T r = sum(x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_prod(state &st) {
+                //all ones, so integer products can't overflow
+                darray1<T> buffer(st.size() * st.stride(), T(1));
+                const array1<T> x = array1<T>(buffer).step(st.stride());
+                while (st.keep_running()) {
+                    T r = prod(x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_min(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T r = min(x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_max(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T r = max(x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_at_assign_atom(state &st) {
+                input<T> in(st);
+                marray1<T> x = in.mview();
+                while (st.keep_running()) {
+                    at(x) = T(5);
+                    do_not_optimize(x[0]);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_at_assign_list(state &st) {
+                input<T> in1(st, 1);
+                const input<T> in2(st, 2);
+                marray1<T> x = in1.mview();
+                const array1<T> y = in2.view();
+                while (st.keep_running()) {
+                    at(x) = y;
+                    do_not_optimize(x[0]);
+                }
+                processed<T>(st, 2 * x.size());
+            }
+
+            template<typename T>
+            void bm_norm(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T r = norm(x);
+                    do_not_optimize(r);
+                }
+                processed<T>(st, x.size());
+            }
+        }
+
+        SX_BENCH_TYPED(where, bm_where)
+        SX_BENCH_TYPED(equal_list, bm_equal_list)
+        SX_BENCH_TYPED(add, bm_add)
+        SX_BENCH_TYPED(mul_atom, bm_mul_atom)
+        SX_BENCH_TYPED(div_atom, bm_div_atom)
+        SX_BENCH_TYPED(equal_atom, bm_equal_atom)
+        SX_BENCH_TYPED(horzcat_list_atom, bm_horzcat_list_atom)
+        SX_BENCH_TYPED(horzcat_atom_list, bm_horzcat_atom_list)
+        SX_BENCH_TYPED(grade_up, bm_grade_up)
+        SX_BENCH_TYPED(grade_down, bm_grade_down)
+        SX_BENCH_TYPED(drop, bm_drop)
+        SX_BENCH_TYPED(cut, bm_cut)
+        SX_BENCH_TYPED(gather, bm_gather)
+        SX_BENCH_TYPED(each, bm_each)
+        SX_BENCH_TYPED(over_init, bm_over_init)
+        SX_BENCH_TYPED(over, bm_over)
+        SX_BENCH_TYPED(sum, bm_sum)
+        SX_BENCH_TYPED(prod, bm_prod)
+        SX_BENCH_TYPED(min, bm_min)
+        SX_BENCH_TYPED(max, bm_max)
+        SX_BENCH_TYPED(at_assign_atom, bm_at_assign_atom)
+        SX_BENCH_TYPED(at_assign_list, bm_at_assign_list)
+        SX_BENCH_TYPED(norm, bm_norm)
+
+    }
+}
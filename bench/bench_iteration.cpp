@@ -0,0 +1,159 @@
+#include <algorithm>
+
+#include "bench.h"
+#include "sx/array2.h"
+#include "sx/proxy_index_at.h"
+
+//iteration through index_iterator and gathers through index_at
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            template<typename T>
+            void processed(state &st, ssize_t n) {
+                st.set_items_processed(int64_t(st.iterations()) * n);
+                st.set_bytes_processed(int64_t(st.iterations()) * n * (int64_t) sizeof(T));
+            }
+
+            //nr x nc view of the input, stride() apart within the rows
+            template<typename T>
+            array2<T> make_array2(const darray1<T> &buffer, const state &st) {
+                const ssize_t nc = std::min<ssize_t>(st.size(), 256);
+                return array2<T>(buffer.data(), st.size() / nc, nc, nc * st.stride(), st.stride());
+            }
+
+            template<typename T>
+            void bm_iterate_array1(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                while (st.keep_running()) {
+                    T s = 0;
+                    for (const T &a : x)
+                        s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_iterate_marray1_fill(state &st) {
+                input<T> in(st);
+                const marray1<T> x = in.mview();
+                while (st.keep_running()) {
+                    std::fill(begin(x), end(x), T(3));
+                    do_not_optimize(x[0]);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_iterate_darray1(state &st) {
+                //darrays are contiguous, stride > 1 copies the strided view
+                const input<T> in(st);
+                const darray1<T> x(in.view());
+                while (st.keep_running()) {
+                    T s = 0;
+                    for (const T &a : x)
+                        s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_iterate_array2(state &st) {
+                const darray1<T> buffer = make_data<T>(st.size() * st.stride());
+                const array2<T> x = make_array2(buffer, st);
+                while (st.keep_running()) {
+                    T s = 0;
+                    for (const T &a : x)
+                        s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_iterate_array2_rows(state &st) {
+                const darray1<T> buffer = make_data<T>(st.size() * st.stride());
+                const array2<T> x = make_array2(buffer, st);
+                while (st.keep_running()) {
+                    T s = 0;
+                    for (ssize_t r = 0; r < x.nr(); ++r)
+                        for (const T &a : x.row(r))
+                            s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void bm_iterate_array2_cols(state &st) {
+                const darray1<T> buffer = make_data<T>(st.size() * st.stride());
+                const array2<T> x = make_array2(buffer, st);
+                while (st.keep_running()) {
+                    T s = 0;
+                    for (ssize_t c = 0; c < x.nc(); ++c)
+                        for (const T &a : x.col(c))
+                            s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, x.size());
+            }
+
+            template<typename T>
+            void gather(state &st, const darray1<ssize_t> &idcs, const array1<T> &x) {
+                while (st.keep_running()) {
+                    const auto g = index_at(x, idcs);
+                    T s = 0;
+                    for (ssize_t i = 0; i < g.size(); ++i)
+                        s += g[i];
+                    do_not_optimize(s);
+                }
+                processed<T>(st, idcs.size());
+            }
+
+            template<typename T>
+            void bm_index_at_sequential(state &st) {
+                const input<T> in(st);
+                darray1<ssize_t> idcs(st.size());
+                for (ssize_t i = 0; i < st.size(); ++i)
+                    idcs[i] = i;
+                gather(st, idcs, in.view());
+            }
+
+            template<typename T>
+            void bm_index_at_random(state &st) {
+                const input<T> in(st);
+                gather(st, make_permutation(st.size()), in.view());
+            }
+
+            template<typename T>
+            void bm_index_at_iterate(state &st) {
+                const input<T> in(st);
+                const array1<T> x = in.view();
+                const darray1<ssize_t> idcs = make_permutation(st.size());
+                while (st.keep_running()) {
+                    const auto g = index_at(x, idcs);
+                    T s = 0;
+                    for (const T &a : g)
+                        s += a;
+                    do_not_optimize(s);
+                }
+                processed<T>(st, idcs.size());
+            }
+        }
+
+        SX_BENCH_TYPED(iterate_array1, bm_iterate_array1)
+        SX_BENCH_TYPED(iterate_marray1_fill, bm_iterate_marray1_fill)
+        SX_BENCH_TYPED(iterate_darray1, bm_iterate_darray1)
+        SX_BENCH_TYPED(iterate_array2, bm_iterate_array2)
+        SX_BENCH_TYPED(iterate_array2_rows, bm_iterate_array2_rows)
+        SX_BENCH_TYPED(iterate_array2_cols, bm_iterate_array2_cols)
+        SX_BENCH_TYPED(index_at_sequential, bm_index_at_sequential)
+        SX_BENCH_TYPED(index_at_random, bm_index_at_random)
+        SX_BENCH_TYPED(index_at_iterate, bm_index_at_iterate)
+
+    }
+}
@@ -0,0 +1,230 @@
+#include "penalty.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            struct registered {
+                std::string name;
+                function sx_f, raw_f, valarray_f;
+                ssize_t size, stride, bytes;
+            };
+
+            struct result {
+                const registered *b;
+                double sx_ns, raw_ns, valarray_ns;  //best per iteration, valarray_ns < 0 if not run
+                std::vector<double> ratios;         //sx over raw of each round
+                double penalty;                     //median of ratios
+            };
+
+            struct options {
+                std::string filter;
+                double min_time;
+                ssize_t max_bytes;
+                std::string out;
+                bool list;
+                double threshold;
+                int rounds;
+                int retries;
+
+                options() : min_time(0.02), max_bytes(-1), list(false), threshold(1.25), rounds(5), retries(2) {
+                }
+            };
+
+            std::vector<registered> &registry() {
+                static std::vector<registered> r;
+                return r;
+            }
+
+            bool parse_flag(const char *arg, const char *name, std::string &value) {
+                const size_t n = strlen(name);
+                if (strncmp(arg, name, n) != 0 || arg[n] != '=')
+                    return false;
+                value = arg + n + 1;
+                return true;
+            }
+
+            options parse_options(int argc, const char *argv[]) {
+                options opts;
+                for (int i = 1; i < argc; ++i) {
+                    std::string v;
+                    if (parse_flag(argv[i], "--filter", v))
+                        opts.filter = v;
+                    else if (parse_flag(argv[i], "--min_time", v))
+                        opts.min_time = atof(v.c_str());
+                    else if (parse_flag(argv[i], "--max_bytes", v))
+                        opts.max_bytes = atoll(v.c_str());
+                    else if (parse_flag(argv[i], "--out", v))
+                        opts.out = v;
+                    else if (parse_flag(argv[i], "--threshold", v))
+                        opts.threshold = atof(v.c_str());
+                    else if (parse_flag(argv[i], "--rounds", v))
+                        opts.rounds = std::max(1, atoi(v.c_str()));
+                    else if (parse_flag(argv[i], "--retries", v))
+                        opts.retries = std::max(0, atoi(v.c_str()));
+                    else if (strcmp(argv[i], "--list") == 0)
+                        opts.list = true;
+                    else
+                        throw std::runtime_error(std::string("sx_penalty: unknown argument ") + argv[i]);
+                }
+                if (!(opts.threshold > 0))
+                    throw std::runtime_error("sx_penalty: --threshold must be positive");
+                return opts;
+            }
+
+            double time_ns(function f, const registered &b, const options &opts) {
+                const state st = measure(f, b.size, b.stride, opts.min_time);
+                return st.real_seconds() * 1e9 / st.iterations();
+            }
+
+            //the ratio of the best times lets a single quiet window on one side decide, the sx and raw timings
+            //of a round run back to back under the same conditions, so the median of the round ratios counts
+            double median_ratio(std::vector<double> ratios) {
+                if (ratios.empty())
+                    return 1;
+                std::sort(ratios.begin(), ratios.end());
+                const size_t m = ratios.size() / 2;
+                return ratios.size() % 2 ? ratios[m] : (ratios[m - 1] + ratios[m]) / 2;
+            }
+
+            //the variants alternate within a round, so drifting clocks and neighbours hit all of them alike
+            //each round starts with the next variant, so none of them is always the one timed right after the
+            //frees of the previous round
+            result run_one(const registered &b, const options &opts) {
+                result r;
+                r.b = &b;
+                r.sx_ns = r.raw_ns = r.valarray_ns = 1e300;
+                const bool valarray = b.valarray_f && b.stride == 1;
+                const function fs[] = {b.sx_f, b.raw_f, b.valarray_f};
+                double *const ns[] = {&r.sx_ns, &r.raw_ns, &r.valarray_ns};
+                const int n = valarray ? 3 : 2;
+                //warm up caches, allocator and clock frequency first, the first timings of a process run slow
+                for (int i = 0; i < n; ++i)
+                    time_ns(fs[i], b, opts);
+                for (int round = 0; round < opts.rounds; ++round) {
+                    double t[3];
+                    for (int k = 0; k < n; ++k) {
+                        const int i = (round + k) % n;
+                        t[i] = time_ns(fs[i], b, opts);
+                        *ns[i] = std::min(*ns[i], t[i]);
+                    }
+                    r.ratios.push_back(t[1] > 0 ? t[0] / t[1] : 1);
+                }
+                if (!valarray)
+                    r.valarray_ns = -1;
+                r.penalty = median_ratio(r.ratios);
+                return r;
+            }
+
+            //the sx and raw loops of a comparison often compile to the same instructions, a penalty above the
+            //threshold is then a noisy neighbour or an unlucky stretch of rounds, so a failing comparison is
+            //measured again and the rounds and best times of all attempts count
+            result run_checked(const registered &b, const options &opts) {
+                result r = run_one(b, opts);
+                for (int i = 0; i < opts.retries && r.penalty > opts.threshold; ++i) {
+                    const result s = run_one(b, opts);
+                    r.sx_ns = std::min(r.sx_ns, s.sx_ns);
+                    r.raw_ns = std::min(r.raw_ns, s.raw_ns);
+                    if (r.valarray_ns >= 0)
+                        r.valarray_ns = std::min(r.valarray_ns, s.valarray_ns);
+                    r.ratios.insert(r.ratios.end(), s.ratios.begin(), s.ratios.end());
+                    r.penalty = median_ratio(r.ratios);
+                }
+                return r;
+            }
+
+            void write_json(FILE *f, const std::vector<result> &results, const options &opts) {
+                fprintf(f, "{\n");
+                write_json_context(f, nullptr);
+                fprintf(f, ",\n  \"threshold\": %.6g,\n  \"comparisons\": [", opts.threshold);
+                for (size_t i = 0; i < results.size(); ++i) {
+                    const result &r = results[i];
+                    fprintf(f, "%s\n    {\n", i == 0 ? "" : ",");
+                    fprintf(f, "      \"name\": %s,\n", json_string(r.b->name).c_str());
+                    fprintf(f, "      \"size\": %td,\n", r.b->size);
+                    fprintf(f, "      \"stride\": %td,\n", r.b->stride);
+                    fprintf(f, "      \"bytes\": %td,\n", r.b->bytes);
+                    fprintf(f, "      \"sx_time\": %.6g,\n", r.sx_ns);
+                    fprintf(f, "      \"raw_time\": %.6g,\n", r.raw_ns);
+                    if (r.valarray_ns >= 0) {
+                        fprintf(f, "      \"valarray_time\": %.6g,\n", r.valarray_ns);
+                        fprintf(f, "      \"valarray_ratio\": %.6g,\n", r.sx_ns / r.valarray_ns);
+                    }
+                    fprintf(f, "      \"time_unit\": \"ns\",\n");
+                    fprintf(f, "      \"penalty\": %.6g,\n", r.penalty);
+                    fprintf(f, "      \"pass\": %s\n", r.penalty <= opts.threshold ? "true" : "false");
+                    fprintf(f, "    }");
+                }
+                fprintf(f, "\n  ]\n}\n");
+            }
+        }
+
+        int register_penalty(const std::string &name, function sx_f, function raw_f, function valarray_f, ssize_t elem_size) {
+            static const ssize_t strides[] = {1, 4};
+            for (ssize_t bytes : sweep_bytes()) {
+                for (ssize_t stride : strides) {
+                    registered r;
+                    r.name = name + "/bytes:" + std::to_string(bytes) + "/stride:" + std::to_string(stride);
+                    r.sx_f = sx_f;
+                    r.raw_f = raw_f;
+                    r.valarray_f = valarray_f;
+                    r.size = bytes / (elem_size * stride);
+                    r.stride = stride;
+                    r.bytes = bytes;
+                    registry().push_back(r);
+                }
+            }
+            return 0;
+        }
+
+        int run_penalty(int argc, const char *argv[]) {
+            const options opts = parse_options(argc, argv);
+#ifndef __OPTIMIZE__
+            fprintf(stderr, "sx_penalty: built without optimization, penalties are not representative\n");
+#endif
+            std::vector<result> results;
+            int failed = 0;
+            for (const registered &b : registry()) {
+                if (!opts.filter.empty() && b.name.find(opts.filter) == std::string::npos)
+                    continue;
+                if (opts.max_bytes >= 0 && b.bytes > opts.max_bytes)
+                    continue;
+                if (opts.list) {
+                    printf("%s\n", b.name.c_str());
+                    continue;
+                }
+                results.push_back(run_checked(b, opts));
+                const result &r = results.back();
+                const bool pass = r.penalty <= opts.threshold;
+                failed += !pass;
+                fprintf(stderr, "%-50s sx %12.1f ns  raw %12.1f ns", b.name.c_str(), r.sx_ns, r.raw_ns);
+                if (r.valarray_ns >= 0)
+                    fprintf(stderr, "  valarray %12.1f ns", r.valarray_ns);
+                else
+                    fprintf(stderr, "  %-23s", "");
+                fprintf(stderr, "  penalty %5.2f%s\n", r.penalty, pass ? "" : "  FAIL");
+            }
+            if (opts.list)
+                return EXIT_SUCCESS;
+            FILE *f = opts.out.empty() ? stdout : fopen(opts.out.c_str(), "w");
+            if (!f)
+                throw std::runtime_error("sx_penalty: can't open " + opts.out);
+            write_json(f, results, opts);
+            if (f != stdout)
+                fclose(f);
+            if (failed) {
+                fprintf(stderr, "sx_penalty: %d of %zu above the threshold %.2f\n", failed, results.size(), opts.threshold);
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef PENALTY_INCLUDED_5180473
+#define PENALTY_INCLUDED_5180473
+
+#include <string>
+
+#include "bench.h"
+
+//abstraction penalty: each sx op timed next to the same computation as a raw pointer loop and with std::valarray
+//the penalty is the sx time over the raw loop time, a run fails if any penalty exceeds the threshold
+
+namespace sx {
+    namespace bench {
+
+        //registers name/bytes:B/stride:S like register_sweep
+        //valarray has no strided views, valarray_f only runs at stride 1 and may be null
+        int register_penalty(const std::string &name, function sx_f, function raw_f, function valarray_f, ssize_t elem_size);
+
+        //runs the registered comparisons, writes JSON, returns EXIT_FAILURE if a penalty is above the threshold
+        //  --filter=substring  --min_time=seconds  --max_bytes=n  --out=file  --list
+        //  --threshold=ratio (1.25)  --rounds=n (5), the median of the sx over raw ratios of the rounds counts
+        //  --retries=n (2), a comparison above the threshold is run again up to n times before it fails
+        int run_penalty(int argc, const char *argv[]);
+
+    }
+}
+
+//registers sx_f, raw_f and valarray_f for <int> and <double>
+#define SX_PENALTY_TYPED(name, sx_f, raw_f, valarray_f) \
+    static const int SX_BENCH_CONCAT(penalty_registered_, __LINE__) = \
+        (::sx::bench::register_penalty(#name "<int>", &sx_f<int>, &raw_f<int>, &valarray_f<int>, sizeof(int)), \
+         ::sx::bench::register_penalty(#name "<double>", &sx_f<double>, &raw_f<double>, &valarray_f<double>, sizeof(double)));
+
+#endif
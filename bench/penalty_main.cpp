@@ -0,0 +1,17 @@
+#include <cstdio>
+#include <stdlib.h>
+#include <exception>
+
+#include "penalty.h"
+
+int main(int argc, const char *argv[]) {
+    try {
+        return sx::bench::run_penalty(argc, argv);
+    } catch (std::exception &e) {
+        fprintf(stderr, "Exception caught: %s\n", e.what());
+        return EXIT_FAILURE;
+    } catch (...) {
+        fprintf(stderr, "Unknown exception caught\n");
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,306 @@
+#include <map>
+#include <valarray>
+#include <vector>
+
+#include "penalty.h"
+#include "sx/eager_ops.h"
+#include "sx/proxy_index_at.h"
+#include "sx/proxy_iota.h"
+
+//the sx ops behind array1, index_iterator, proxy_iota and index_at next to hand-written equivalents
+//the raw loops allocate zeroed results like darray1(n) in the sx ops, so only the abstraction differs
+
+namespace sx {
+    namespace bench {
+
+        namespace {
+            //the inputs of the comparison being timed, made once and read by all of its variants
+            //with buffers of their own the sx and raw loops run on different heap layouts, which alone can make
+            //the same instructions 1.5x slower for one of them
+            template<typename T>
+            const darray1<T> &shared_data(ssize_t n, uint32_t seed) {
+                static std::map<uint32_t, darray1<T>> cache;
+                darray1<T> &x = cache[seed];
+                if (x.size() != n)
+                    x = make_data<T>(n, seed);
+                return x;
+            }
+
+            const darray1<ssize_t> &shared_permutation(ssize_t n) {
+                static darray1<ssize_t> p;
+                if (p.size() != n)
+                    p = make_permutation(n);
+                return p;
+            }
+
+            //shared_data behind a strided view, the input of the sx ops
+            template<typename T>
+            array1<T> shared_view(const state &st, uint32_t seed = 1) {
+                return array1<T>(shared_data<T>(st.size() * st.stride(), seed)).step(st.stride());
+            }
+
+            //the input of the raw loops: shared_data behind a pointer and a stride
+            template<typename T>
+            struct raw_input {
+                explicit raw_input(const state &st, uint32_t seed = 1)
+                        : p(shared_data<T>(st.size() * st.stride(), seed).data()), s(st.stride()), n(st.size()) {
+                }
+
+                const T *p;
+                ssize_t s, n;
+            };
+
+            //the same elements as input<T> at stride 1
+            template<typename T>
+            std::valarray<T> make_valarray(const state &st, uint32_t seed = 1) {
+                const darray1<T> x = make_data<T>(st.size(), seed);
+                return std::valarray<T>(x.data(), x.size());
+            }
+
+            std::valarray<size_t> make_valarray_permutation(ssize_t n) {
+                const darray1<ssize_t> p = make_permutation(n);
+                std::valarray<size_t> r(n);
+                for (ssize_t i = 0; i < n; ++i)
+                    r[i] = size_t(p[i]);
+                return r;
+            }
+
+            // sum
+
+            template<typename T>
+            void sx_sum(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                while (st.keep_running()) {
+                    T r = sum(x);
+                    do_not_optimize(r);
+                }
+            }
+
+            template<typename T>
+            void raw_sum(state &st) {
+                const raw_input<T> in(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (ssize_t i = 0; i < in.n; ++i)
+                        r += in.p[i * in.s];
+                    do_not_optimize(r);
+                }
+            }
+
+            template<typename T>
+            void valarray_sum(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                while (st.keep_running()) {
+                    T r = x.sum();
+                    do_not_optimize(r);
+                }
+            }
+
+            // op+(list, list)
+
+            template<typename T>
+            void sx_add(state &st) {
+                const array1<T> x = shared_view<T>(st, 1), y = shared_view<T>(st, 2);
+                while (st.keep_running()) {
+                    darray1<T> r = x + y;
+                    do_not_optimize(r.data());
+                }
+            }
+
+            template<typename T>
+            void raw_add(state &st) {
+                const raw_input<T> in1(st, 1), in2(st, 2);
+                while (st.keep_running()) {
+                    std::vector<T> r(in1.n);
+                    for (ssize_t i = 0; i < in1.n; ++i)
+                        r[i] = in1.p[i * in1.s] + in2.p[i * in2.s];
+                    do_not_optimize(r[0]);
+                }
+            }
+
+            template<typename T>
+            void valarray_add(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st, 1), y = make_valarray<T>(st, 2);
+                while (st.keep_running()) {
+                    std::valarray<T> r = x + y;
+                    do_not_optimize(r[0]);
+                }
+            }
+
+            // op*(list, atom)
+
+            template<typename T>
+            void sx_mul_atom(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                while (st.keep_running()) {
+                    darray1<T> r = x * T(3);
+                    do_not_optimize(r.data());
+                }
+            }
+
+            template<typename T>
+            void raw_mul_atom(state &st) {
+                const raw_input<T> in(st);
+                while (st.keep_running()) {
+                    std::vector<T> r(in.n);
+                    for (ssize_t i = 0; i < in.n; ++i)
+                        r[i] = in.p[i * in.s] * T(3);
+                    do_not_optimize(r[0]);
+                }
+            }
+
+            template<typename T>
+            void valarray_mul_atom(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                while (st.keep_running()) {
+                    std::valarray<T> r = x * T(3);
+                    do_not_optimize(r[0]);
+                }
+            }
+
+            // array1::operator[], the raw and valarray versions are shared with iota below
+
+            template<typename T>
+            void sx_subscript(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (ssize_t i = 0; i < x.size(); ++i)
+                        r += x[i];
+                    do_not_optimize(r);
+                }
+            }
+
+            template<typename T>
+            void valarray_subscript(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (size_t i = 0; i < x.size(); ++i)
+                        r += x[i];
+                    do_not_optimize(r);
+                }
+            }
+
+            // range for over array1
+
+            template<typename T>
+            void sx_iterate(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (const T &a : x)
+                        r += a;
+                    do_not_optimize(r);
+                }
+            }
+
+            template<typename T>
+            void valarray_iterate(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (const T &a : x)
+                        r += a;
+                    do_not_optimize(r);
+                }
+            }
+
+            // IOTA
+
+            template<typename T>
+            void sx_iota(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (auto i : IOTA x.size())
+                        r += x[i];
+                    do_not_optimize(r);
+                }
+            }
+
+            // index_at, iterated through index_iterator
+
+            template<typename T>
+            void sx_index_at(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                const darray1<ssize_t> &idcs = shared_permutation(x.size());
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (const T &a : index_at(x, idcs))
+                        r += a;
+                    do_not_optimize(r);
+                }
+            }
+
+            template<typename T>
+            void raw_index_at(state &st) {
+                const raw_input<T> in(st);
+                const darray1<ssize_t> &idcs = shared_permutation(in.n);
+                const ssize_t *q = idcs.data();
+                while (st.keep_running()) {
+                    T r = 0;
+                    for (ssize_t i = 0; i < in.n; ++i)
+                        r += in.p[q[i] * in.s];
+                    do_not_optimize(r);
+                }
+            }
+
+            //valarray can only materialize an indirect_array
+            template<typename T>
+            void valarray_index_at(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                const std::valarray<size_t> idcs = make_valarray_permutation(st.size());
+                while (st.keep_running()) {
+                    T r = std::valarray<T>(x[idcs]).sum();
+                    do_not_optimize(r);
+                }
+            }
+
+            // gather(list, idxlist)
+
+            template<typename T>
+            void sx_gather(state &st) {
+                const array1<T> x = shared_view<T>(st);
+                const darray1<ssize_t> &idcs = shared_permutation(x.size());
+                while (st.keep_running()) {
+                    darray1<T> r = gather(x, idcs);
+                    do_not_optimize(r.data());
+                }
+            }
+
+            template<typename T>
+            void raw_gather(state &st) {
+                const raw_input<T> in(st);
+                const darray1<ssize_t> &idcs = shared_permutation(in.n);
+                const ssize_t *q = idcs.data();
+                while (st.keep_running()) {
+                    std::vector<T> r(in.n);
+                    for (ssize_t i = 0; i < in.n; ++i)
+                        r[i] = in.p[q[i] * in.s];
+                    do_not_optimize(r[0]);
+                }
+            }
+
+            template<typename T>
+            void valarray_gather(state &st) {
+                const std::valarray<T> x = make_valarray<T>(st);
+                const std::valarray<size_t> idcs = make_valarray_permutation(st.size());
+                while (st.keep_running()) {
+                    std::valarray<T> r = x[idcs];
+                    do_not_optimize(r[0]);
+                }
+            }
+        }
+
+        SX_PENALTY_TYPED(sum, sx_sum, raw_sum, valarray_sum)
+        SX_PENALTY_TYPED(add, sx_add, raw_add, valarray_add)
+        SX_PENALTY_TYPED(mul_atom, sx_mul_atom, raw_mul_atom, valarray_mul_atom)
+        SX_PENALTY_TYPED(subscript, sx_subscript, raw_sum, valarray_subscript)
+        SX_PENALTY_TYPED(iterate, sx_iterate, raw_sum, valarray_iterate)
+        SX_PENALTY_TYPED(iota, sx_iota, raw_sum, valarray_subscript)
+        SX_PENALTY_TYPED(index_at, sx_index_at, raw_index_at, valarray_index_at)
+        SX_PENALTY_TYPED(gather, sx_gather, raw_gather, valarray_gather)
+
+    }
+}
@@ -0,0 +1,115 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sx {
+    namespace bench {
+
+#ifdef __linux__
+        namespace {
+            int open_counter(uint64_t config, int group_fd) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = config;
+                attr.disabled = group_fd < 0 ? 1 : 0;
+                //perf_event_paranoid 2, the usual default, allows user space counting only
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+            }
+        }
+
+        perf_counters::perf_counters() : nopen_(0) {
+            static const uint64_t configs[ncounters] = {
+                    PERF_COUNT_HW_CPU_CYCLES,
+                    PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_MISSES,
+                    PERF_COUNT_HW_BRANCH_MISSES
+            };
+            for (int i = 0; i < ncounters; ++i) {
+                fds_[i] = -1;
+                slot_[i] = -1;
+            }
+            fds_[cycles] = open_counter(configs[cycles], -1);
+            if (fds_[cycles] < 0) {
+                error_ = std::string("perf_event_open: ") + strerror(errno);
+                return;
+            }
+            slot_[cycles] = nopen_++;
+            for (int i = cycles + 1; i < ncounters; ++i) {
+                fds_[i] = open_counter(configs[i], fds_[cycles]);
+                if (fds_[i] >= 0)
+                    slot_[i] = nopen_++;
+            }
+        }
+
+        perf_counters::~perf_counters() {
+            for (int i = 0; i < ncounters; ++i)
+                if (fds_[i] >= 0)
+                    close(fds_[i]);
+        }
+
+        void perf_counters::start() {
+            if (!available())
+                return;
+            ioctl(fds_[cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds_[cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        perf_counters::counts perf_counters::stop() {
+            counts result;
+            if (!available())
+                return result;
+            ioctl(fds_[cycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            //nr, time_enabled, time_running, then the values in the order the counters were opened
+            std::vector<uint64_t> buffer(3 + nopen_);
+            const ssize_t n = read(fds_[cycles], buffer.data(), buffer.size() * sizeof(uint64_t));
+            if (n != (ssize_t) (buffer.size() * sizeof(uint64_t)) || buffer[2] == 0)
+                return result;
+            const double scale = double(buffer[1]) / double(buffer[2]);
+            for (int i = 0; i < ncounters; ++i) {
+                if (slot_[i] < 0)
+                    continue;
+                result.value[i] = double(buffer[3 + slot_[i]]) * scale;
+                result.valid[i] = true;
+            }
+            return result;
+        }
+#else
+        perf_counters::perf_counters() : nopen_(0), error_("perf_event_open: not supported on this platform") {
+            for (int i = 0; i < ncounters; ++i) {
+                fds_[i] = -1;
+                slot_[i] = -1;
+            }
+        }
+
+        perf_counters::~perf_counters() {
+        }
+
+        void perf_counters::start() {
+        }
+
+        perf_counters::counts perf_counters::stop() {
+            return counts();
+        }
+#endif
+
+        const char *perf_counters::name(counter c) {
+            static const char *names[ncounters] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+            return names[c];
+        }
+
+    }
+}
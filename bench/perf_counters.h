@@ -0,0 +1,68 @@
+#ifndef PERF_COUNTERS_INCLUDED_4418207
+#define PERF_COUNTERS_INCLUDED_4418207
+
+#include <cstdint>
+#include <string>
+
+namespace sx {
+    namespace bench {
+
+        //hardware counters of the calling thread through perf_event_open, user space only
+        //when the kernel, the container or the platform doesn't allow them available() is false and
+        //stop() returns no valid counts; counters the PMU lacks are left out individually
+        class perf_counters {
+        public:
+            enum counter {
+                cycles,
+                instructions,
+                cache_misses,   //last level cache
+                branch_misses,
+                ncounters
+            };
+
+            struct counts {
+                double value[ncounters];    //scaled up if the kernel had to multiplex the counters
+                bool valid[ncounters];
+
+                counts() {
+                    for (int i = 0; i < ncounters; ++i) {
+                        value[i] = 0;
+                        valid[i] = false;
+                    }
+                }
+            };
+
+            perf_counters();
+
+            perf_counters(const perf_counters &) = delete;
+
+            perf_counters &operator=(const perf_counters &) = delete;
+
+            ~perf_counters();
+
+            bool available() const {
+                return fds_[cycles] >= 0;
+            }
+
+            //why they are not available
+            const std::string &error() const {
+                return error_;
+            }
+
+            void start();
+
+            counts stop();
+
+            static const char *name(counter c);
+
+        private:
+            int fds_[ncounters];
+            int slot_[ncounters];   //position in the group read, -1 if not opened
+            int nopen_;
+            std::string error_;
+        };
+
+    }
+}
+
+#endif
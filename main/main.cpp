@@ -12,7 +12,7 @@ int main(int argc, const char *argv[]) {
         double q = over(std::plus<double>(), a);
         printf("sum: %f\n", sum(a));
 
-        for(int i: iota(SIZE a)) {
+        for(int i: iota((int) a.size())) {
             printf("%d\n", i);
         }
         return EXIT_SUCCESS;
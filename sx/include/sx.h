@@ -5,6 +5,27 @@
 
 #include "sx/array1.h"
 #include "sx/array2.h"
+#include "sx/broadcast.h"
+#include "sx/tiled_array2.h"
+#include "sx/alloc_stats.h"
+#include "sx/array_file.h"
+#include "sx/arrow.h"
+#include "sx/block_codec.h"
+#include "sx/huge_page_allocator.h"
+#include "sx/kernels.h"
+#include "sx/memory_resource.h"
+#include "sx/mapped_file.h"
+#include "sx/chunk_stream.h"
+#include "sx/csv.h"
+#include "sx/prefetch_reader.h"
+#include "sx/scratch_allocator.h"
+#include "sx/segmented_array.h"
+#include "sx/small_array.h"
+#include "sx/sparse_array2.h"
+#include "sx/stencil.h"
+#include "sx/tokenize.h"
+#include "sx/trace.h"
+#include "sx/tuning.h"
 #include "sx/index_iterator.h"
 #include "sx/eager_ops.h"
 #include "sx/proxy_iota.h"
@@ -0,0 +1,180 @@
+#include "sx/alloc_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace sx {
+
+    namespace {
+        int histogram_bin(int64_t nbytes) {
+            int k = 0;
+            while (k + 1 < alloc_histogram_bins && (nbytes >> (k + 1)) != 0)
+                ++k;
+            return k;
+        }
+
+        std::vector<alloc_scope *> &thread_scopes() {
+            static thread_local std::vector<alloc_scope *> scopes;
+            return scopes;
+        }
+
+        struct global_counters {
+            std::atomic<int64_t> allocations, deallocations, bytes, live_bytes, peak_bytes;
+            std::atomic<int64_t> histogram[alloc_histogram_bins];
+
+            global_counters() : allocations(0), deallocations(0), bytes(0), live_bytes(0), peak_bytes(0) {
+                for (auto &h : histogram)
+                    h.store(0);
+            }
+        };
+
+        global_counters &global() {
+            static global_counters g;
+            return g;
+        }
+
+        std::string demangle(const char *name) {
+#ifdef __GNUG__
+            int status = 0;
+            char *d = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+            if (d) {
+                std::string r(d);
+                free(d);
+                return r;
+            }
+#endif
+            return name;
+        }
+
+        void merge(alloc_stats &into, const alloc_stats &x) {
+            into.allocations += x.allocations;
+            into.deallocations += x.deallocations;
+            into.bytes += x.bytes;
+            into.live_bytes += x.live_bytes;
+            into.peak_bytes = std::max(into.peak_bytes, x.peak_bytes);
+            for (int i = 0; i < alloc_histogram_bins; ++i)
+                into.histogram[i] += x.histogram[i];
+        }
+
+        void append_row(std::string &r, const std::string &name, const alloc_stats &s, bool live) {
+            char buf[256];
+            if (live)
+                snprintf(buf, sizeof(buf), "  %-40s %10lld allocs %14lld bytes %14lld live %14lld peak\n", name.c_str(),
+                        (long long) s.allocations, (long long) s.bytes, (long long) s.live_bytes, (long long) s.peak_bytes);
+            else
+                snprintf(buf, sizeof(buf), "  %-40s %10lld allocs %14lld bytes\n", name.c_str(),
+                        (long long) s.allocations, (long long) s.bytes);
+            r += buf;
+        }
+    }
+
+    alloc_stats::alloc_stats() : allocations(0), deallocations(0), bytes(0), live_bytes(0), peak_bytes(0) {
+        std::fill(histogram, histogram + alloc_histogram_bins, int64_t(0));
+    }
+
+    void alloc_stats::add(int64_t nbytes) {
+        ++allocations;
+        bytes += nbytes;
+        live_bytes += nbytes;
+        peak_bytes = std::max(peak_bytes, live_bytes);
+        ++histogram[histogram_bin(nbytes)];
+    }
+
+    void alloc_stats::remove(int64_t nbytes) {
+        ++deallocations;
+        live_bytes -= nbytes;
+    }
+
+    std::string alloc_report::str() const {
+        std::string r;
+        append_row(r, "total", total, true);
+        r += "by element type:\n";
+        for (auto &x : by_type)
+            append_row(r, x.first, x.second, true);
+        r += "by op:\n";
+        for (auto &x : by_site)
+            append_row(r, x.first.empty() ? "(outside ops)" : x.first, x.second, false);
+        r += "sizes:\n";
+        for (int i = 0; i < alloc_histogram_bins; ++i) {
+            if (total.histogram[i] == 0)
+                continue;
+            char bin[32], buf[128];
+            snprintf(bin, sizeof(bin), "[2^%d, 2^%d)", i, i + 1);
+            snprintf(buf, sizeof(buf), "  %-16s %10lld\n", bin, (long long) total.histogram[i]);
+            r += buf;
+        }
+        return r;
+    }
+
+    alloc_scope::alloc_scope() {
+        thread_scopes().push_back(this);
+    }
+
+    alloc_scope::~alloc_scope() {
+        auto &scopes = thread_scopes();
+        scopes.erase(std::find(scopes.begin(), scopes.end(), this));
+    }
+
+    alloc_report alloc_scope::report() const {
+        alloc_report r;
+        r.total = total_;
+        for (auto &x : by_type_)
+            merge(r.by_type[demangle(x.first)], x.second);
+        for (auto &x : by_site_)
+            merge(r.by_site[x.first ? x.first : ""], x.second);
+        return r;
+    }
+
+    alloc_stats global_alloc_stats() {
+        global_counters &g = global();
+        alloc_stats s;
+        s.allocations = g.allocations.load(std::memory_order_relaxed);
+        s.deallocations = g.deallocations.load(std::memory_order_relaxed);
+        s.bytes = g.bytes.load(std::memory_order_relaxed);
+        s.live_bytes = g.live_bytes.load(std::memory_order_relaxed);
+        s.peak_bytes = g.peak_bytes.load(std::memory_order_relaxed);
+        for (int i = 0; i < alloc_histogram_bins; ++i)
+            s.histogram[i] = g.histogram[i].load(std::memory_order_relaxed);
+        return s;
+    }
+
+    namespace detail {
+
+        void alloc_record(size_t bytes, const char *type) {
+            const int64_t n = (int64_t) bytes;
+            global_counters &g = global();
+            g.allocations.fetch_add(1, std::memory_order_relaxed);
+            g.bytes.fetch_add(n, std::memory_order_relaxed);
+            g.histogram[histogram_bin(n)].fetch_add(1, std::memory_order_relaxed);
+            const int64_t live = g.live_bytes.fetch_add(n, std::memory_order_relaxed) + n;
+            int64_t peak = g.peak_bytes.load(std::memory_order_relaxed);
+            while (live > peak && !g.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+            }
+            for (alloc_scope *s : thread_scopes()) {
+                s->total_.add(n);
+                s->by_type_[type].add(n);
+                s->by_site_[alloc_site()].add(n);
+            }
+        }
+
+        void dealloc_record(size_t bytes, const char *type) {
+            const int64_t n = (int64_t) bytes;
+            global_counters &g = global();
+            g.deallocations.fetch_add(1, std::memory_order_relaxed);
+            g.live_bytes.fetch_sub(n, std::memory_order_relaxed);
+            for (alloc_scope *s : thread_scopes()) {
+                s->total_.remove(n);
+                s->by_type_[type].remove(n);
+            }
+        }
+
+    }
+
+}
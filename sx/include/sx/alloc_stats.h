@@ -0,0 +1,73 @@
+#ifndef ALLOC_STATS_INCLUDED_6129734
+#define ALLOC_STATS_INCLUDED_6129734
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "allocator.h"
+
+//allocation accounting of the containers using sx::allocator, the default of darray1 and darray2, and of heap_resource(),
+//the default memory_resource of dynamic_bitset
+//everything reads zero unless built with SX_ALLOC_STATS
+
+namespace sx {
+
+    //log2 buckets: histogram[k] counts allocations of [2^k, 2^(k+1)) bytes
+    const int alloc_histogram_bins = 48;
+
+    struct alloc_stats {
+        int64_t allocations;
+        int64_t deallocations;
+        int64_t bytes;          //allocated in total
+        int64_t live_bytes;     //allocated minus freed, can be negative in a scope that frees older memory
+        int64_t peak_bytes;     //the maximum of live_bytes
+        int64_t histogram[alloc_histogram_bins];
+
+        alloc_stats();
+
+        void add(int64_t nbytes);
+
+        void remove(int64_t nbytes);
+    };
+
+    //by_site is keyed by the op an allocation happened in (SX_TRACE_OP or SX_ALLOC_SITE), "" outside of ops
+    //deallocations are not attributed to sites, their live and peak bytes stay zero
+    struct alloc_report {
+        alloc_stats total;
+        std::map<std::string, alloc_stats> by_type;
+        std::map<std::string, alloc_stats> by_site;
+
+        //human readable table
+        std::string str() const;
+    };
+
+    //what the calling thread allocated while it was alive, nested scopes all see the allocations
+    class alloc_scope {
+    public:
+        alloc_scope();
+
+        alloc_scope(const alloc_scope &) = delete;
+
+        alloc_scope &operator=(const alloc_scope &) = delete;
+
+        ~alloc_scope();
+
+        //so far
+        alloc_report report() const;
+
+    private:
+        friend void detail::alloc_record(size_t, const char *);
+
+        friend void detail::dealloc_record(size_t, const char *);
+
+        alloc_stats total_;
+        std::map<const char *, alloc_stats> by_type_, by_site_;
+    };
+
+    //all threads since the start of the process, totals and histogram only
+    alloc_stats global_alloc_stats();
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ALLOCATOR_INCLUDED_8802461
+#define ALLOCATOR_INCLUDED_8802461
+
+#include <cstddef>
+#include <memory>
+#include <typeinfo>
+
+//the default allocator of the sx containers, std::allocator with optional accounting
+//accounting is compiled out unless SX_ALLOC_STATS is defined to 1 (cmake -DSX_ALLOC_STATS=ON), see alloc_stats.h
+
+#ifndef SX_ALLOC_STATS
+#define SX_ALLOC_STATS 0
+#endif
+
+namespace sx {
+
+    namespace detail {
+        //type is typeid(T).name() of the element type
+        void alloc_record(size_t bytes, const char *type);
+
+        void dealloc_record(size_t bytes, const char *type);
+
+        //the op allocations are attributed to, nullptr outside of ops
+        inline const char *&alloc_site() {
+            static thread_local const char *site = nullptr;
+            return site;
+        }
+
+        //names the allocations of its lifetime unless an enclosing one already did
+        class alloc_site_scope {
+        public:
+            explicit alloc_site_scope(const char *name) : outer_(alloc_site() != nullptr) {
+                if (!outer_)
+                    alloc_site() = name;
+            }
+
+            alloc_site_scope(const alloc_site_scope &) = delete;
+
+            alloc_site_scope &operator=(const alloc_site_scope &) = delete;
+
+            ~alloc_site_scope() {
+                if (!outer_)
+                    alloc_site() = nullptr;
+            }
+
+        private:
+            bool outer_;
+        };
+    }
+
+    template<typename T>
+    class allocator {
+    public:
+        typedef T value_type;
+
+        allocator() {
+        }
+
+        template<typename U>
+        allocator(const allocator<U> &) {
+        }
+
+        T *allocate(size_t n) {
+            T *p = std::allocator<T>().allocate(n);
+#if SX_ALLOC_STATS
+            detail::alloc_record(n * sizeof(T), typeid(T).name());
+#endif
+            return p;
+        }
+
+        void deallocate(T *p, size_t n) {
+#if SX_ALLOC_STATS
+            detail::dealloc_record(n * sizeof(T), typeid(T).name());
+#endif
+            std::allocator<T>().deallocate(p, n);
+        }
+    };
+
+    template<typename T, typename U>
+    bool operator==(const allocator<T> &, const allocator<U> &) {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const allocator<T> &, const allocator<U> &) {
+        return false;
+    }
+
+}
+
+#define SX_ALLOC_CONCAT2(a, b) a##b
+#define SX_ALLOC_CONCAT(a, b) SX_ALLOC_CONCAT2(a, b)
+
+//SX_ALLOC_SITE("name") attributes the allocations until the end of the enclosing block to name
+#if SX_ALLOC_STATS
+#define SX_ALLOC_SITE(name) const ::sx::detail::alloc_site_scope SX_ALLOC_CONCAT(sx_alloc_site_, __LINE__)(name)
+#else
+#define SX_ALLOC_SITE(name) ((void) 0)
+#endif
+
+#endif
@@ -16,9 +16,12 @@
 
 namespace sx {
 
-    template<typename T>
+    template<typename T, typename Alloc>
     class darray1;
 
+    template<typename T, bool Mutable>
+    class array2;
+
     template<typename T, bool Mutable = false>
     class array1
             : public container_traits_tags::indexable,
@@ -53,7 +56,21 @@ namespace sx {
         }
 
         //construct from darray1 intentionally non-explicit
-        array1(typename std::conditional<Mutable, darray1<value_type>, const darray1<value_type>>::type &v);
+        template<typename Alloc, bool M = Mutable, typename std::enable_if<!M>::type * = nullptr>
+        array1(const darray1<value_type, Alloc> &v) : array1(v.data(), v.size()) {
+        }
+
+        template<typename Alloc, bool M = Mutable, typename std::enable_if<M>::type * = nullptr>
+        array1(darray1<value_type, Alloc> &v) : array1(v.data(), v.size()) {
+        }
+
+        template<ssize_t N, typename Alloc, bool M = Mutable, typename std::enable_if<!M>::type * = nullptr>
+        array1(const small_darray1<value_type, N, Alloc> &v) : array1(v.data(), v.size()) {
+        }
+
+        template<ssize_t N, typename Alloc, bool M = Mutable, typename std::enable_if<M>::type * = nullptr>
+        array1(small_darray1<value_type, N, Alloc> &v) : array1(v.data(), v.size()) {
+        }
 
         //construct from std::basic_string: intentionally non-explicit
         //compile-time error if Mutable
@@ -123,6 +140,27 @@ namespace sx {
             return slice(lower, lower + n);
         }
 
+        //view of the same elements in reverse order (negative stride)
+        this_type reverse() const {
+            if (size_ == 0)
+                return this_type();
+            return this_type(data_ + (size_ - 1) * stride_, size_, -stride_);
+        }
+
+        //view of every n-th element starting with the first one, n < 0 starts from the last one
+        this_type step(ssize_t n) const {
+            assert(n != 0);
+            if (n < 0)
+                return reverse().step(-n);
+            if (size_ == 0)
+                return this_type();
+            return this_type(data_, (size_ + n - 1) / n, stride_ * n);
+        }
+
+        //row-major nr x nc view of the elements, always possible without copying
+        //defined in array2.h
+        array2<T, Mutable> reshape(ssize_t nr, ssize_t nc) const;
+
     private:
         pointer data_;
         ssize_t size_;
@@ -131,11 +169,12 @@ namespace sx {
 
     template<typename T> using marray1 = array1<T, true>;
 
-    template<typename T>
+    template<typename T, typename Alloc>
     class darray1
             : public container_traits_tags::indexable {
     public:
-        typedef std::vector<T> container_type;
+        typedef std::vector<T, Alloc> container_type;
+        typedef Alloc allocator_type;
         typedef typename container_type::value_type value_type;
         typedef typename container_type::reference reference;
         typedef typename container_type::const_reference const_reference;
@@ -145,11 +184,14 @@ namespace sx {
         typedef typename container_type::const_iterator const_iterator;
         typedef ssize_t size_type;
 
-        typedef darray1<T> this_type;
+        typedef darray1<T, Alloc> this_type;
 
         darray1() {
         }
 
+        explicit darray1(const allocator_type &alloc) : v_(alloc) {
+        }
+
         darray1(const this_type &x) : v_(x.v_) {
         }
 
@@ -185,6 +227,9 @@ namespace sx {
         darray1(ssize_t count, const T &value) : v_(count, value) {
         }
 
+        darray1(ssize_t count, const T &value, const allocator_type &alloc) : v_(count, value, alloc) {
+        }
+
         template<typename S>
         darray1(std::initializer_list<S> il) : darray1(il.begin(), il.end()) {
         }
@@ -250,6 +295,27 @@ namespace sx {
             return slicen(lower, lower + n);
         }
 
+        marray1<T> reverse() {
+            return marray1<T>(*this).reverse();
+        }
+
+        array1<T> reverse() const {
+            return array1<T>(*this).reverse();
+        }
+
+        marray1<T> step(ssize_t n) {
+            return marray1<T>(*this).step(n);
+        }
+
+        array1<T> step(ssize_t n) const {
+            return array1<T>(*this).step(n);
+        }
+
+        //defined in array2.h
+        array2<T, true> reshape(ssize_t nr, ssize_t nc);
+
+        array2<T, false> reshape(ssize_t nr, ssize_t nc) const;
+
         iterator push_back(const T &x) {
             v_.push_back(x);
             return v_.end() - 1;
@@ -275,6 +341,14 @@ namespace sx {
             v_.reserve(x);
         }
 
+        void resize(ssize_t count) {
+            v_.resize(count);
+        }
+
+        void resize(ssize_t count, const T &value) {
+            v_.resize(count, value);
+        }
+
         template<typename InputIt>
         void push_back(InputIt first, InputIt last) {
             v_.insert(v_.end(), first, last);
@@ -294,35 +368,34 @@ namespace sx {
             return *this;
         }
 
+        allocator_type get_allocator() const {
+            return v_.get_allocator();
+        }
+
     private:
         container_type v_;
     };
 
-    template<typename T, bool Mutable>
-    array1<T, Mutable>::array1(typename std::conditional<Mutable, darray1<value_type>, const darray1<value_type>>::type &v)
-            : array1(v.data(), v.size()) {
-    }
+    template<typename T, typename A>
+    const_index_iterator<const darray1<T, A>>
 
-    template<typename T>
-    const_index_iterator<const darray1<T>>
-
-    begin(const darray1<T> &that) {
-        return const_index_iterator<const darray1<T>>(&that, 0);
+    begin(const darray1<T, A> &that) {
+        return const_index_iterator<const darray1<T, A>>(&that, 0);
     }
 
-    template<typename T>
-    const_index_iterator<const darray1<T>> end(const darray1<T> &that) {
-        return const_index_iterator<const darray1<T>>(&that, that.size());
+    template<typename T, typename A>
+    const_index_iterator<const darray1<T, A>> end(const darray1<T, A> &that) {
+        return const_index_iterator<const darray1<T, A>>(&that, that.size());
     }
 
-    template<typename T>
-    mutable_index_iterator<darray1<T>> begin(darray1<T> &that) {
-        return mutable_index_iterator<darray1<T>>(&that, 0);
+    template<typename T, typename A>
+    mutable_index_iterator<darray1<T, A>> begin(darray1<T, A> &that) {
+        return mutable_index_iterator<darray1<T, A>>(&that, 0);
     }
 
-    template<typename T>
-    mutable_index_iterator<darray1<T>> end(darray1<T> &that) {
-        return mutable_index_iterator<darray1<T>>(&that, that.size());
+    template<typename T, typename A>
+    mutable_index_iterator<darray1<T, A>> end(darray1<T, A> &that) {
+        return mutable_index_iterator<darray1<T, A>>(&that, that.size());
     }
 
     template<typename T>
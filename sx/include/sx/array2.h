@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cassert>
 #include <utility>
+#include <stdexcept>
 
 #include "smart_index.h"
 #include "index_iterator.h"
@@ -13,12 +14,14 @@
 
 namespace sx {
 
-    template<typename T>
+    //Alloc is the allocator of the underlying std::vector, see allocator.h and huge_page_allocator.h
+    template<typename T, typename Alloc = allocator<T>>
     class darray2;
 
     template<typename T, bool Mutable = false>
     class array2
             : public container_traits_tags::indexable,
+              public container_traits_tags::two_dimensional,
               public std::conditional<Mutable, container_traits_tags::use_mutable_index_iterator, container_traits_tags::use_const_index_iterator>::type {
     public:
         typedef typename std::remove_const<T>::type value_type;
@@ -63,13 +66,24 @@ namespace sx {
         };
 
         //intentionally not explicit
-        array2(typename std::conditional<Mutable, darray2<value_type>, const darray2<value_type>>::type &v);
+        template<typename Alloc, bool M = Mutable, typename std::enable_if<!M>::type * = nullptr>
+        array2(const darray2<value_type, Alloc> &v) : array2(v.data(), v.nr(), v.nc()) {
+        }
+
+        template<typename Alloc, bool M = Mutable, typename std::enable_if<M>::type * = nullptr>
+        array2(darray2<value_type, Alloc> &v) : array2(v.data(), v.nr(), v.nc()) {
+        }
+
+        //convert mutable array to const array
+        operator array2<T, false>() const {
+            return array2<T, false>(data_, sizes_[0], sizes_[1], strides_[0], strides_[1]);
+        }
 
         //op[] is always const, just like char*const p is const
         //linear index, row-major
         reference operator[](ssize_t idx) const {
             assert(0 <= idx && idx < size());
-            return data_[idx / nc(), idx % nc()];
+            return (*this)(idx / nc(), idx % nc());
         }
 
         reference operator()(ssize_t row, ssize_t col) const {
@@ -107,7 +121,7 @@ namespace sx {
             return sizes_[0] * sizes_[1];
         }
 
-        std::array<int, 2> strides() const {
+        std::array<ssize_t, 2> strides() const {
             return strides_;
         }
 
@@ -118,7 +132,7 @@ namespace sx {
             ssize_t C0 = c0.effective_idx_unchecked(sizes_[1]);
             ssize_t C1 = c1.effective_idx_unchecked(sizes_[1]);
             assert(0 <= R0 && R0 < sizes_[0] && 0 <= R1 && R1 <= sizes_[0] && R0 <= R1);
-            assert(0 <= C0 && C0 < sizes_[0] && 0 <= C1 && C1 <= sizes_[0] && C0 <= C1);
+            assert(0 <= C0 && C0 < sizes_[1] && 0 <= C1 && C1 <= sizes_[1] && C0 <= C1);
             if (R0 == R1 || C0 == C1)
                 return this_type();
             return this_type(&at(R0, C0), R1 - R0, C1 - C0, strides_[0], strides_[1]);
@@ -153,6 +167,36 @@ namespace sx {
             return block(0, nr(), c0, c0 + n);
         }
 
+        this_type transpose() const {
+            return this_type(data_, sizes_[1], sizes_[0], strides_[1], strides_[0]);
+        }
+
+        //true if the elements in row-major order are evenly spaced in memory
+        bool can_ravel() const {
+            return sizes_[0] <= 1 || sizes_[1] <= 1 || strides_[0] == sizes_[1] * strides_[1];
+        }
+
+        //row-major view of all elements, throws if can_ravel() is false
+        array1<T, Mutable> ravel() const {
+            if (!can_ravel())
+                throw std::runtime_error("array2::ravel: strides don't allow a view");
+            if (size() == 0)
+                return array1<T, Mutable>();
+            return array1<T, Mutable>(data_, size(), sizes_[1] == 1 ? strides_[0] : strides_[1]);
+        }
+
+        //row-major view of all elements, copies them into storage only if can_ravel() is false
+        array1<T> ravel(darray1<value_type> &storage) const {
+            if (can_ravel())
+                return ravel();
+            storage.clear();
+            storage.reserve(size());
+            for (ssize_t r = 0; r < nr(); ++r)
+                for (ssize_t c = 0; c < nc(); ++c)
+                    storage.push_back((*this)(r, c));
+            return storage;
+        }
+
     private:
         pointer data_;
         std::array<ssize_t, 2> sizes_;
@@ -161,22 +205,27 @@ namespace sx {
 
     template<typename T> using marray2 = array2<T, true>;
 
-    template<typename T>
+    template<typename T, typename Alloc>
     class darray2
-            : public container_traits_tags::indexable {
+            : public container_traits_tags::indexable,
+              public container_traits_tags::two_dimensional {
     public:
-        typedef std::vector<T> container_type;
+        typedef std::vector<T, Alloc> container_type;
+        typedef Alloc allocator_type;
         typedef typename container_type::value_type value_type;
         typedef typename container_type::reference reference;
         typedef typename container_type::const_reference const_reference;
         typedef typename container_type::pointer pointer;
         typedef typename container_type::const_pointer const_pointer;
-        typedef darray2<T> this_type;
+        typedef darray2<T, Alloc> this_type;
         typedef ssize_t size_type;
 
         darray2() : nr_(0), nc_(0) {
         }
 
+        explicit darray2(const allocator_type &alloc) : v_(alloc), nr_(0), nc_(0) {
+        }
+
         darray2(const this_type &x) : v_(x.v_), nr_(x.nr_), nc_(x.nc_) {
         }
 
@@ -211,6 +260,10 @@ namespace sx {
                 v_(nrows * ncols, x), nr_(nrows), nc_(ncols) {
         }
 
+        darray2(ssize_t nrows, ssize_t ncols, const value_type &x, const allocator_type &alloc) :
+                v_(nrows * ncols, x, alloc), nr_(nrows), nc_(ncols) {
+        }
+
         void resize(ssize_t nrows, ssize_t ncols) {
             v_.resize(nrows * ncols);
             nr_ = nrows;
@@ -381,6 +434,15 @@ namespace sx {
             return *this;
         }
 
+        //contiguous, so always a view
+        array1<T> ravel() const {
+            return array1<T>(data(), size());
+        }
+
+        marray1<T> ravel() {
+            return marray1<T>(data(), size());
+        }
+
         void append_row(array1<T> v) {
             if (nr_ == 0) {
                 if (v.size() == 0)
@@ -395,34 +457,50 @@ namespace sx {
             ++nr_;
         }
 
+        allocator_type get_allocator() const {
+            return v_.get_allocator();
+        }
+
     private:
         container_type v_;
         ssize_t nr_, nc_;
     };
 
     template<typename T, bool Mutable>
-    array2<T, Mutable>::array2(typename std::conditional<Mutable, darray2<value_type>, const darray2<value_type>>::type &v)
-            : array2<T, Mutable>(v.data(), v.nr(), v.nc()) {
+    array2<T, Mutable> array1<T, Mutable>::reshape(ssize_t nr, ssize_t nc) const {
+        if (nr * nc != size_)
+            throw std::runtime_error("array1::reshape: invalid size");
+        return array2<T, Mutable>(data_, nr, nc, nc * stride_, stride_);
+    }
+
+    template<typename T, typename A>
+    marray2<T> darray1<T, A>::reshape(ssize_t nr, ssize_t nc) {
+        return marray1<T>(*this).reshape(nr, nc);
+    }
+
+    template<typename T, typename A>
+    array2<T> darray1<T, A>::reshape(ssize_t nr, ssize_t nc) const {
+        return array1<T>(*this).reshape(nr, nc);
     }
 
-    template<typename T>
-    const_index_iterator<const darray2<T>> begin(const darray2<T> &that) {
-        return const_index_iterator<const darray2<T>>(&that, 0);
+    template<typename T, typename A>
+    const_index_iterator<const darray2<T, A>> begin(const darray2<T, A> &that) {
+        return const_index_iterator<const darray2<T, A>>(&that, 0);
     }
 
-    template<typename T>
-    const_index_iterator<const darray2<T>> end(const darray2<T> &that) {
-        return const_index_iterator<const darray2<T>>(&that, that.size());
+    template<typename T, typename A>
+    const_index_iterator<const darray2<T, A>> end(const darray2<T, A> &that) {
+        return const_index_iterator<const darray2<T, A>>(&that, that.size());
     }
 
-    template<typename T>
-    mutable_index_iterator<darray2<T>> begin(darray2<T> &that) {
-        return mutable_index_iterator<darray2<T>>(&that, 0);
+    template<typename T, typename A>
+    mutable_index_iterator<darray2<T, A>> begin(darray2<T, A> &that) {
+        return mutable_index_iterator<darray2<T, A>>(&that, 0);
     }
 
-    template<typename T>
-    mutable_index_iterator<darray2<T>> end(darray2<T> &that) {
-        return mutable_index_iterator<darray2<T>>(&that, that.size());
+    template<typename T, typename A>
+    mutable_index_iterator<darray2<T, A>> end(darray2<T, A> &that) {
+        return mutable_index_iterator<darray2<T, A>>(&that, that.size());
     }
 
 }
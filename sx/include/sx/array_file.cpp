@@ -0,0 +1,254 @@
+#include "sx/array_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+namespace sx {
+
+    const size_t array_file_entry::max_name_length;
+
+    namespace {
+        const char array_file_magic[8] = {'S', 'X', 'A', 'R', 'R', 'A', 'Y', 0};
+        const uint32_t array_file_bom = 0x01020304;
+    }
+
+    size_t array_dtype_size(array_dtype d) {
+        switch (d) {
+            case array_dtype::int8:
+            case array_dtype::uint8:
+            case array_dtype::character:
+                return 1;
+            case array_dtype::int16:
+            case array_dtype::uint16:
+                return 2;
+            case array_dtype::int32:
+            case array_dtype::uint32:
+            case array_dtype::float32:
+                return 4;
+            case array_dtype::int64:
+            case array_dtype::uint64:
+            case array_dtype::float64:
+            case array_dtype::bits:
+                return 8;
+        }
+        throw std::runtime_error("array_dtype_size: invalid dtype");
+    }
+
+    uint64_t array_file_checksum(const void *data, size_t nbytes) {
+        const uint64_t prime = 0x100000001b3ULL;
+        uint64_t h = 0xcbf29ce484222325ULL;
+        const char *p = static_cast<const char *>(data);
+        for (; nbytes >= 8; nbytes -= 8, p += 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h = (h ^ w) * prime;
+        }
+        if (nbytes > 0) {
+            uint64_t w = 0;
+            memcpy(&w, p, nbytes);
+            h = (h ^ w) * prime;
+        }
+        return h;
+    }
+
+    //-----------------------------------------------------------------------------
+    // writer
+
+    array_file_writer::array_file_writer(const std::string &path, bool checksums)
+            : path_(path), f_(fopen(path.c_str(), "wb")), checksums_(checksums), pos_(0) {
+        if (!f_)
+            throw std::runtime_error("array_file_writer: can't create '" + path + "': " + strerror(errno));
+        //placeholder, rewritten in close()
+        array_file_header h;
+        memset(&h, 0, sizeof(h));
+        write_bytes(&h, sizeof(h));
+    }
+
+    array_file_writer::~array_file_writer() {
+        if (f_) {
+            try {
+                close();
+            } catch (...) {
+            }
+        }
+    }
+
+    void array_file_writer::write_bytes(const void *data, size_t nbytes) {
+        if (nbytes > 0 && fwrite(data, 1, nbytes, f_) != nbytes)
+            throw std::runtime_error("array_file_writer: can't write '" + path_ + "': " + strerror(errno));
+        pos_ += nbytes;
+    }
+
+    void array_file_writer::pad_to_alignment() {
+        static const char zeros[array_file_alignment] = {};
+        const size_t rem = pos_ % array_file_alignment;
+        if (rem != 0)
+            write_bytes(zeros, array_file_alignment - rem);
+    }
+
+    void array_file_writer::write_raw(const std::string &name, array_dtype dtype, uint32_t ndim, ssize_t n0, ssize_t n1,
+            const void *data) {
+        if (!f_)
+            throw std::runtime_error("array_file_writer: file already closed");
+        if (name.empty() || name.size() > array_file_entry::max_name_length)
+            throw std::runtime_error("array_file_writer: invalid array name '" + name + "'");
+        for (auto &e : entries_)
+            if (name == e.name)
+                throw std::runtime_error("array_file_writer: duplicate array name '" + name + "'");
+
+        array_file_entry e;
+        memset(&e, 0, sizeof(e));
+        memcpy(e.name, name.data(), name.size());
+        e.dtype = (uint32_t) dtype;
+        e.ndim = ndim;
+        if (ndim == 1) {
+            e.shape[0] = n0;
+            e.strides[0] = 1;
+        } else {
+            e.shape[0] = n0;
+            e.shape[1] = n1;
+            e.strides[0] = n1;
+            e.strides[1] = 1;
+        }
+        const size_t nelems = dtype == array_dtype::bits
+                ? (n0 + 63) / 64
+                : (size_t) n0 * (ndim == 2 ? n1 : 1);
+        e.nbytes = nelems * array_dtype_size(dtype);
+
+        pad_to_alignment();
+        e.offset = pos_;
+        if (checksums_) {
+            e.checksum = array_file_checksum(data, e.nbytes);
+            e.flags |= array_file_has_checksum;
+        }
+        write_bytes(data, e.nbytes);
+        entries_.push_back(e);
+    }
+
+    void array_file_writer::write(const std::string &name, const dynamic_bitset &x) {
+        std::vector<dynamic_bitset::block_type> blocks(x.num_blocks());
+        to_block_range(x, blocks.begin());
+        write_raw(name, array_dtype::bits, 1, x.size(), 1, blocks.data());
+    }
+
+    void array_file_writer::close() {
+        if (!f_)
+            return;
+        pad_to_alignment();
+        array_file_header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, array_file_magic, sizeof(h.magic));
+        h.byte_order_mark = array_file_bom;
+        h.version = array_file_version;
+        h.array_count = entries_.size();
+        h.directory_offset = pos_;
+        if (!entries_.empty())
+            write_bytes(entries_.data(), entries_.size() * sizeof(array_file_entry));
+        const bool ok = fseek(f_, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f_) == 1;
+        const bool closed = fclose(f_) == 0;
+        f_ = nullptr;
+        if (!ok || !closed)
+            throw std::runtime_error("array_file_writer: can't finish '" + path_ + "': " + strerror(errno));
+    }
+
+    //-----------------------------------------------------------------------------
+    // reader
+
+    namespace {
+        //non-negative shape, the contiguous strides the writer emits and nbytes matching them, without overflow
+        bool consistent_layout(const array_file_entry &e) {
+            const int64_t n0 = e.shape[0], n1 = e.ndim == 2 ? e.shape[1] : 1;
+            if (n0 < 0 || n1 < 0)
+                return false;
+            if (e.ndim == 1 ? e.strides[0] != 1 : e.strides[0] != n1 || e.strides[1] != 1)
+                return false;
+            const array_dtype dtype = (array_dtype) e.dtype;
+            if (dtype < array_dtype::int8 || dtype > array_dtype::bits)
+                return false;
+            const uint64_t max = std::numeric_limits<uint64_t>::max();
+            const uint64_t size = array_dtype_size(dtype);
+            uint64_t nelems;
+            if (dtype == array_dtype::bits)
+                nelems = ((uint64_t) n0 + 63) / 64;
+            else {
+                if (n1 != 0 && (uint64_t) n0 > max / (uint64_t) n1)
+                    return false;
+                nelems = (uint64_t) n0 * (uint64_t) n1;
+            }
+            return nelems <= max / size && nelems * size == e.nbytes;
+        }
+    }
+
+    array_file_reader::array_file_reader(const std::string &path)
+            : file_(path, mapped_file::mode::read_only) {
+        const ssize_t n = file_.size();
+        if (n < (ssize_t) sizeof(array_file_header))
+            throw std::runtime_error("array_file_reader: '" + path + "' is too short");
+        array_file_header h;
+        memcpy(&h, file_.data(), sizeof(h));
+        if (memcmp(h.magic, array_file_magic, sizeof(h.magic)) != 0)
+            throw std::runtime_error("array_file_reader: '" + path + "' is not an sx array file");
+        if (h.byte_order_mark != array_file_bom)
+            throw std::runtime_error("array_file_reader: '" + path + "' was written with a different byte order");
+        if (h.version != array_file_version)
+            throw std::runtime_error("array_file_reader: '" + path + "' has unsupported version");
+        if (h.directory_offset > (uint64_t) n
+                || h.array_count > ((uint64_t) n - h.directory_offset) / sizeof(array_file_entry))
+            throw std::runtime_error("array_file_reader: '" + path + "' has a corrupt directory");
+        entries_.resize(h.array_count);
+        if (h.array_count > 0)
+            memcpy(entries_.data(), file_.data() + h.directory_offset, h.array_count * sizeof(array_file_entry));
+        for (auto &e : entries_) {
+            e.name[sizeof(e.name) - 1] = 0;
+            if (e.offset % array_file_alignment != 0 || e.offset > (uint64_t) n || e.nbytes > (uint64_t) n - e.offset
+                    || (e.ndim != 1 && e.ndim != 2))
+                throw std::runtime_error("array_file_reader: '" + path + "' has a corrupt entry '" + e.name + "'");
+        }
+    }
+
+    bool array_file_reader::contains(const std::string &name) const {
+        for (auto &e : entries_)
+            if (name == e.name)
+                return true;
+        return false;
+    }
+
+    const array_file_entry &array_file_reader::entry(const std::string &name) const {
+        for (auto &e : entries_)
+            if (name == e.name)
+                return e;
+        throw std::runtime_error("array_file_reader: no array named '" + name + "'");
+    }
+
+    bool array_file_reader::verify(const std::string &name) const {
+        const array_file_entry &e = entry(name);
+        if (!(e.flags & array_file_has_checksum))
+            return true;
+        return array_file_checksum(payload(e), e.nbytes) == e.checksum;
+    }
+
+    const array_file_entry &array_file_reader::checked_entry(const std::string &name, array_dtype dtype, uint32_t ndim) const {
+        const array_file_entry &e = entry(name);
+        if (e.dtype != (uint32_t) dtype)
+            throw std::runtime_error("array_file_reader: '" + name + "' has a different element type");
+        if (e.ndim != ndim)
+            throw std::runtime_error("array_file_reader: '" + name + "' has a different number of dimensions");
+        //the views index the mapping with shape and strides, so they must describe exactly the payload
+        if (!consistent_layout(e))
+            throw std::runtime_error("array_file_reader: '" + name + "' has a corrupt shape");
+        return e;
+    }
+
+    dynamic_bitset array_file_reader::bitset(const std::string &name) const {
+        const array_file_entry &e = checked_entry(name, array_dtype::bits, 1);
+        dynamic_bitset result(e.shape[0]);
+        //checked_entry() already matched nbytes to shape[0], from_block_range only asserts the fit
+        if (e.nbytes != result.num_blocks() * sizeof(dynamic_bitset::block_type))
+            throw std::runtime_error("array_file_reader: '" + name + "' has a corrupt shape");
+        const dynamic_bitset::block_type *p = reinterpret_cast<const dynamic_bitset::block_type *>(payload(e));
+        from_block_range(p, p + e.nbytes / sizeof(dynamic_bitset::block_type), result);
+        return result;
+    }
+
+}
@@ -0,0 +1,209 @@
+#ifndef ARRAY_FILE_INCLUDED_9023517
+#define ARRAY_FILE_INCLUDED_9023517
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+#include "array1.h"
+#include "array2.h"
+#include "dynamic_bitset.h"
+#include "mapped_file.h"
+
+namespace sx {
+
+    //sx array file, version 1
+    //
+    //  offset 0:                   array_file_header
+    //  offsets multiple of 64:     payloads, row-major, contiguous
+    //  header.directory_offset:    header.array_count x array_file_entry
+    //
+    //all integers are in the byte order of the writer, readers reject files with a different one
+    //the directory is at the end so arrays can be written one by one without buffering them
+
+    enum class array_dtype : uint32_t {
+        int8 = 1, uint8, int16, uint16, int32, uint32, int64, uint64, float32, float64, character,
+        bits //dynamic_bitset, shape[0] bits stored in uint64 blocks
+    };
+
+    template<typename T>
+    struct array_dtype_of;
+
+#define SX_DEF_DTYPE(T, D) \
+    template<> struct array_dtype_of<T> { static const array_dtype value = array_dtype::D; };
+
+    SX_DEF_DTYPE(int8_t, int8)
+    SX_DEF_DTYPE(uint8_t, uint8)
+    SX_DEF_DTYPE(int16_t, int16)
+    SX_DEF_DTYPE(uint16_t, uint16)
+    SX_DEF_DTYPE(int32_t, int32)
+    SX_DEF_DTYPE(uint32_t, uint32)
+    SX_DEF_DTYPE(int64_t, int64)
+    SX_DEF_DTYPE(uint64_t, uint64)
+    SX_DEF_DTYPE(float, float32)
+    SX_DEF_DTYPE(double, float64)
+    SX_DEF_DTYPE(char, character)
+
+#undef SX_DEF_DTYPE
+
+    size_t array_dtype_size(array_dtype d);
+
+    struct array_file_header {
+        char magic[8];              //"SXARRAY\0"
+        uint32_t byte_order_mark;   //0x01020304 in the writer's byte order
+        uint32_t version;
+        uint64_t array_count;
+        uint64_t directory_offset;
+        uint8_t reserved[32];
+    };
+
+    struct array_file_entry {
+        static const size_t max_name_length = 55;
+
+        char name[56];              //NUL-terminated
+        uint32_t dtype;             //array_dtype
+        uint32_t ndim;              //1 or 2
+        int64_t shape[2];
+        int64_t strides[2];         //in elements
+        uint64_t offset;            //of the payload, multiple of array_file_alignment
+        uint64_t nbytes;
+        uint64_t checksum;          //array_file_checksum of the payload, 0 if not computed
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(array_file_header) == 64, "array_file_header layout");
+    static_assert(sizeof(array_file_entry) == 128, "array_file_entry layout");
+
+    const ssize_t array_file_alignment = 64;
+    const uint32_t array_file_version = 1;
+
+    enum array_file_flags : uint32_t {
+        array_file_has_checksum = 1
+    };
+
+    //64-bit FNV-1a over 8-byte words, the tail is zero padded
+    uint64_t array_file_checksum(const void *data, size_t nbytes);
+
+    //writes named arrays into a new file; the file is complete only after close()
+    class array_file_writer {
+    public:
+        explicit array_file_writer(const std::string &path, bool checksums = true);
+
+        array_file_writer(const array_file_writer &) = delete;
+
+        array_file_writer &operator=(const array_file_writer &) = delete;
+
+        ~array_file_writer();
+
+        //writes the directory and the final header
+        void close();
+
+        //strided views are written contiguously
+        template<typename T, bool Mutable>
+        void write(const std::string &name, const array1<T, Mutable> &x) {
+            typedef typename std::remove_const<T>::type value_type;
+            if (x.stride() == 1) {
+                write_raw(name, array_dtype_of<value_type>::value, 1, x.size(), 1, x.data());
+                return;
+            }
+            const darray1<value_type> c(BEGINEND(x));
+            write_raw(name, array_dtype_of<value_type>::value, 1, c.size(), 1, c.data());
+        }
+
+        template<typename T>
+        void write(const std::string &name, const darray1<T> &x) {
+            write(name, array1<T>(x));
+        }
+
+        template<typename T, bool Mutable>
+        void write(const std::string &name, const array2<T, Mutable> &x) {
+            typedef typename std::remove_const<T>::type value_type;
+            if (x.strides()[1] == 1 && (x.strides()[0] == x.nc() || x.nr() <= 1)) {
+                write_raw(name, array_dtype_of<value_type>::value, 2, x.nr(), x.nc(), x.data());
+                return;
+            }
+            const darray2<value_type> c(x);
+            write_raw(name, array_dtype_of<value_type>::value, 2, c.nr(), c.nc(), c.data());
+        }
+
+        template<typename T>
+        void write(const std::string &name, const darray2<T> &x) {
+            write(name, array2<T>(x));
+        }
+
+        void write(const std::string &name, const dynamic_bitset &x);
+
+    private:
+        void write_raw(const std::string &name, array_dtype dtype, uint32_t ndim, ssize_t n0, ssize_t n1, const void *data);
+
+        void write_bytes(const void *data, size_t nbytes);
+
+        void pad_to_alignment();
+
+        std::string path_;
+        FILE *f_;
+        bool checksums_;
+        uint64_t pos_;
+        std::vector<array_file_entry> entries_;
+    };
+
+    //maps an array file and returns views into the mapping; the views are valid while the reader is alive
+    class array_file_reader {
+    public:
+        explicit array_file_reader(const std::string &path);
+
+        ssize_t size() const {
+            return (ssize_t) entries_.size();
+        }
+
+        const array_file_entry &entry(ssize_t idx) const {
+            return entries_[idx];
+        }
+
+        //throws if there's no array with that name
+        const array_file_entry &entry(const std::string &name) const;
+
+        bool contains(const std::string &name) const;
+
+        //false if the entry has a checksum and the payload doesn't match it
+        bool verify(const std::string &name) const;
+
+        //zero-copy views, throw if dtype or ndim doesn't match
+        template<typename T>
+        array1<T> view1(const std::string &name) const {
+            const array_file_entry &e = checked_entry(name, array_dtype_of<T>::value, 1);
+            return array1<T>(reinterpret_cast<const T *>(payload(e)), e.shape[0], e.strides[0]);
+        }
+
+        template<typename T>
+        array2<T> view2(const std::string &name) const {
+            const array_file_entry &e = checked_entry(name, array_dtype_of<T>::value, 2);
+            return array2<T>(reinterpret_cast<const T *>(payload(e)), e.shape[0], e.shape[1], e.strides[0], e.strides[1]);
+        }
+
+        //dynamic_bitset owns its blocks, so this one copies
+        dynamic_bitset bitset(const std::string &name) const;
+
+        const mapped_file &file() const {
+            return file_;
+        }
+
+    private:
+        const array_file_entry &checked_entry(const std::string &name, array_dtype dtype, uint32_t ndim) const;
+
+        const char *payload(const array_file_entry &e) const {
+            return file_.data() + e.offset;
+        }
+
+        mapped_file file_;
+        std::vector<array_file_entry> entries_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef ARROW_INCLUDED_5561093
+#define ARROW_INCLUDED_5561093
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "traits.h"
+#include "index_iterator.h"
+#include "array1.h"
+#include "dynamic_bitset.h"
+
+//Apache Arrow C data interface, https://arrow.apache.org/docs/format/CDataInterface.html
+//the definitions are the ones from the specification, guarded the same way so they can coexist with arrow's own header
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+}
+
+#endif
+
+namespace sx {
+
+    //format string of the primitive arrow type matching T
+    template<typename T>
+    struct arrow_format_of;
+
+#define SX_DEF_ARROW_FORMAT(T, F) \
+    template<> struct arrow_format_of<T> { static const char *value() { return F; } };
+
+    SX_DEF_ARROW_FORMAT(int8_t, "c")
+    SX_DEF_ARROW_FORMAT(uint8_t, "C")
+    SX_DEF_ARROW_FORMAT(int16_t, "s")
+    SX_DEF_ARROW_FORMAT(uint16_t, "S")
+    SX_DEF_ARROW_FORMAT(int32_t, "i")
+    SX_DEF_ARROW_FORMAT(uint32_t, "I")
+    SX_DEF_ARROW_FORMAT(int64_t, "l")
+    SX_DEF_ARROW_FORMAT(uint64_t, "L")
+    SX_DEF_ARROW_FORMAT(float, "f")
+    SX_DEF_ARROW_FORMAT(double, "g")
+    SX_DEF_ARROW_FORMAT(char, std::is_signed<char>::value ? "c" : "C")
+
+#undef SX_DEF_ARROW_FORMAT
+
+    namespace detail {
+        //arrow bitmaps are little-endian bit order within bytes, dynamic_bitset blocks match that
+        //only when the blocks themselves are stored little-endian
+        inline bool arrow_little_endian_host() {
+            const uint16_t x = 1;
+            uint8_t b;
+            memcpy(&b, &x, 1);
+            return b == 1;
+        }
+
+        //owns everything an exported ArrowArray points to
+        template<typename T>
+        struct arrow_export_array {
+            darray1<T> values;
+            std::vector<dynamic_bitset::block_type> validity;
+            const void *buffers[2];
+        };
+
+        struct arrow_export_schema {
+            std::string format, name;
+        };
+
+        template<typename T>
+        void arrow_release_array(ArrowArray *a) {
+            delete static_cast<arrow_export_array<T> *>(a->private_data);
+            a->release = nullptr;
+        }
+
+        inline void arrow_release_schema(ArrowSchema *s) {
+            delete static_cast<arrow_export_schema *>(s->private_data);
+            s->release = nullptr;
+        }
+
+        inline void arrow_fill_schema(const char *format, const std::string &name, bool nullable, ArrowSchema *out) {
+            arrow_export_schema *p = new arrow_export_schema{format, name};
+            out->format = p->format.c_str();
+            out->name = p->name.c_str();
+            out->metadata = nullptr;
+            out->flags = nullable ? ARROW_FLAG_NULLABLE : 0;
+            out->n_children = 0;
+            out->children = nullptr;
+            out->dictionary = nullptr;
+            out->release = &arrow_release_schema;
+            out->private_data = p;
+        }
+
+        template<typename T>
+        void arrow_export(darray1<T> &&values, const dynamic_bitset *valid, const std::string &name,
+                ArrowArray *out, ArrowSchema *schema) {
+            if (valid && (ssize_t) valid->size() != values.size())
+                throw std::runtime_error("export_arrow: validity bitmap and values have different sizes");
+            if (valid && !arrow_little_endian_host())
+                throw std::runtime_error("export_arrow: validity bitmaps need a little-endian host");
+            //owned here until out->release takes over
+            std::unique_ptr<arrow_export_array<T>> p(new arrow_export_array<T>());
+            p->values = std::move(values);
+            int64_t null_count = 0;
+            if (valid) {
+                p->validity.resize(valid->num_blocks());
+                to_block_range(*valid, p->validity.begin());
+                null_count = (int64_t) (valid->size() - valid->count());
+            }
+            p->buffers[0] = valid ? p->validity.data() : nullptr;
+            p->buffers[1] = p->values.data();
+            out->length = p->values.size();
+            out->null_count = null_count;
+            out->offset = 0;
+            out->n_buffers = 2;
+            out->n_children = 0;
+            out->buffers = p->buffers;
+            out->children = nullptr;
+            out->dictionary = nullptr;
+            out->release = &arrow_release_array<T>;
+            out->private_data = p.release();
+            try {
+                arrow_fill_schema(arrow_format_of<T>::value(), name, valid != nullptr, schema);
+            } catch (...) {
+                out->release(out);
+                throw;
+            }
+        }
+    }
+
+    //exports a primitive array without copying: the values are moved into the exported array,
+    //which keeps them alive until the consumer calls out->release
+    //takes an rvalue so a copy is never silent, std::move the darray1 or pass a view to copy it
+    //schema receives the matching type description, it has its own release callback
+    template<typename T>
+    void export_arrow(darray1<T> &&values, ArrowArray *out, ArrowSchema *schema, const std::string &name = std::string()) {
+        detail::arrow_export(std::move(values), nullptr, name, out, schema);
+    }
+
+    //same with nulls: element i is null where valid[i] is false; the bitmap blocks are copied
+    template<typename T>
+    void export_arrow(darray1<T> &&values, const dynamic_bitset &valid, ArrowArray *out, ArrowSchema *schema,
+            const std::string &name = std::string()) {
+        detail::arrow_export(std::move(values), &valid, name, out, schema);
+    }
+
+    //views are copied, they don't own their elements
+    template<typename T, bool Mutable>
+    void export_arrow(const array1<T, Mutable> &values, ArrowArray *out, ArrowSchema *schema,
+            const std::string &name = std::string()) {
+        typedef typename std::remove_const<T>::type value_type;
+        detail::arrow_export(darray1<value_type>(BEGINEND(values)), nullptr, name, out, schema);
+    }
+
+    template<typename T, bool Mutable>
+    void export_arrow(const array1<T, Mutable> &values, const dynamic_bitset &valid, ArrowArray *out, ArrowSchema *schema,
+            const std::string &name = std::string()) {
+        typedef typename std::remove_const<T>::type value_type;
+        detail::arrow_export(darray1<value_type>(BEGINEND(values)), &valid, name, out, schema);
+    }
+
+    //takes over a primitive arrow array and exposes its values as a read-only darray1-like container
+    //there's no copying: the values stay in the producer's buffer, released when this is destroyed
+    //the ArrowArray and ArrowSchema are moved in, the caller's structs are marked released
+    template<typename T>
+    class arrow_array1
+            : public container_traits_tags::indexable {
+    public:
+        typedef T value_type;
+        typedef const T &reference;
+        typedef const T &const_reference;
+        typedef const T *pointer;
+        typedef const T *const_pointer;
+        typedef ssize_t size_type;
+        typedef arrow_array1<T> this_type;
+
+        arrow_array1() {
+            a_.release = nullptr;
+        }
+
+        arrow_array1(ArrowArray *array, ArrowSchema *schema) {
+            if (!array->release)
+                throw std::runtime_error("arrow_array1: array already released");
+            a_ = *array;
+            array->release = nullptr;
+            std::string format;
+            if (schema) {
+                format = schema->format ? schema->format : "";
+                if (schema->release)
+                    schema->release(schema);
+            }
+            if (format != arrow_format_of<T>::value()) {
+                reset();
+                throw std::runtime_error("arrow_array1: format '" + format + "' doesn't match the element type");
+            }
+            if (a_.n_buffers != 2 || a_.n_children != 0 || a_.dictionary || a_.length < 0 || a_.offset < 0) {
+                reset();
+                throw std::runtime_error("arrow_array1: not a primitive array");
+            }
+        }
+
+        arrow_array1(const this_type &) = delete;
+
+        this_type &operator=(const this_type &) = delete;
+
+        arrow_array1(this_type &&x) : a_(x.a_) {
+            x.a_.release = nullptr;
+        }
+
+        this_type &operator=(this_type &&x) {
+            if (this != &x) {
+                reset();
+                a_ = x.a_;
+                x.a_.release = nullptr;
+            }
+            return *this;
+        }
+
+        ~arrow_array1() {
+            reset();
+        }
+
+        //calls the producer's release callback, the views taken before become invalid
+        void reset() {
+            if (a_.release)
+                a_.release(&a_);
+            a_.release = nullptr;
+        }
+
+        ssize_t size() const {
+            return a_.release ? a_.length : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        ssize_t stride() const {
+            return 1;
+        }
+
+        const_pointer data() const {
+            return a_.release ? static_cast<const T *>(a_.buffers[1]) + a_.offset : nullptr;
+        }
+
+        const_reference operator[](ssize_t idx) const {
+            return data()[idx];
+        }
+
+        operator array1<T>() const {
+            return array1<T>(data(), size());
+        }
+
+        bool has_validity() const {
+            return a_.release && a_.buffers[0];
+        }
+
+        //false where the element is null, the value at a null is unspecified
+        bool valid(ssize_t idx) const {
+            if (!has_validity())
+                return true;
+            const ssize_t bit = a_.offset + idx;
+            return (static_cast<const uint8_t *>(a_.buffers[0])[bit >> 3] >> (bit & 7)) & 1;
+        }
+
+        //counted if the producer didn't provide it
+        ssize_t null_count() const {
+            if (!has_validity())
+                return 0;
+            if (a_.null_count >= 0)
+                return a_.null_count;
+            ssize_t n = 0;
+            for (ssize_t i = 0; i < size(); ++i)
+                if (!valid(i))
+                    ++n;
+            return n;
+        }
+
+        //copy of the validity as a dynamic_bitset, all ones if there's no bitmap
+        dynamic_bitset validity() const {
+            dynamic_bitset result(size());
+            for (ssize_t i = 0; i < size(); ++i)
+                if (valid(i))
+                    result.set(i);
+            return result;
+        }
+
+    private:
+        ArrowArray a_;
+    };
+
+    template<typename T>
+    const_index_iterator<const arrow_array1<T>> begin(const arrow_array1<T> &that) {
+        return const_index_iterator<const arrow_array1<T>>(&that, 0);
+    }
+
+    template<typename T>
+    const_index_iterator<const arrow_array1<T>> end(const arrow_array1<T> &that) {
+        return const_index_iterator<const arrow_array1<T>>(&that, that.size());
+    }
+
+}
+
+#endif
@@ -0,0 +1,404 @@
+#include "sx/block_codec.h"
+
+#include <limits>
+#include <vector>
+
+namespace sx {
+
+    namespace {
+        const char block_codec_magic[4] = {'S', 'X', 'B', 'C'};
+        const uint32_t block_codec_version = 1;
+        const ssize_t block_codec_padding = 16;
+
+        bool little_endian_host() {
+            const uint16_t x = 1;
+            uint8_t b;
+            memcpy(&b, &x, 1);
+            return b == 1;
+        }
+
+        inline uint64_t load64(const uint8_t *p) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            return w;
+        }
+
+        inline void store64(uint8_t *p, uint64_t w) {
+            memcpy(p, &w, 8);
+        }
+
+        inline ssize_t align8(ssize_t n) {
+            return (n + 7) & ~ssize_t(7);
+        }
+
+        //groups of 8 values take width bytes
+        inline ssize_t packed_bytes(ssize_t n, int width) {
+            return (n + 7) / 8 * width;
+        }
+
+        inline int bit_width(uint64_t x) {
+            int w = 0;
+            for (; x != 0; x >>= 1) ++w;
+            return w;
+        }
+
+        //out must be zeroed and have 8 bytes of slack
+        void pack(const uint64_t *v, ssize_t n, int width, uint8_t *out) {
+            if (width == 0)
+                return;
+            for (ssize_t i = 0; i < n; ++i) {
+                const uint64_t bit = (uint64_t) i * width;
+                const int shift = bit & 7;
+                uint8_t *p = out + (bit >> 3);
+                store64(p, load64(p) | (v[i] << shift));
+                if (shift + width > 64)
+                    p[8] |= (uint8_t) (v[i] >> (64 - shift));
+            }
+        }
+
+        //value J of a group of 8 packed with width W
+        template<int W, int J>
+        inline uint64_t unpack_one(const uint8_t *in) {
+            const uint64_t mask = W >= 64 ? ~uint64_t(0) : (uint64_t(1) << (W & 63)) - 1;
+            const int bit = J * W, s = bit & 7;
+            uint64_t v = load64(in + (bit >> 3)) >> s;
+            if (W > 57 && s + W > 64)
+                v |= load64(in + (bit >> 3) + 8) << ((64 - s) & 63);
+            return v & mask;
+        }
+
+        //out[i] = base + i-th packed value, modulo the width of T
+        //W and J are constants, so each group unrolls into fixed loads, shifts and masks
+        template<int W, typename T>
+        void unpack_add(const uint8_t *in, ssize_t n, uint64_t base, T *out) {
+            typedef typename std::make_unsigned<T>::type U;
+            ssize_t i = 0;
+            for (; i + 8 <= n; i += 8, in += W) {
+                out[i] = (T) (U) (base + unpack_one<W, 0>(in));
+                out[i + 1] = (T) (U) (base + unpack_one<W, 1>(in));
+                out[i + 2] = (T) (U) (base + unpack_one<W, 2>(in));
+                out[i + 3] = (T) (U) (base + unpack_one<W, 3>(in));
+                out[i + 4] = (T) (U) (base + unpack_one<W, 4>(in));
+                out[i + 5] = (T) (U) (base + unpack_one<W, 5>(in));
+                out[i + 6] = (T) (U) (base + unpack_one<W, 6>(in));
+                out[i + 7] = (T) (U) (base + unpack_one<W, 7>(in));
+            }
+            //last partial group, groups are always stored whole
+            if (i < n) {
+                T tail[8];
+                unpack_add<W>(in, 8, base, tail);
+                std::copy(tail, tail + (n - i), out + i);
+            }
+        }
+
+        template<typename T>
+        using unpack_function = void (*)(const uint8_t *, ssize_t, uint64_t, T *);
+
+        template<typename T, int W>
+        struct unpack_fill {
+            static void apply(unpack_function<T> *f) {
+                f[W] = &unpack_add<W, T>;
+                unpack_fill<T, W - 1>::apply(f);
+            }
+        };
+
+        template<typename T>
+        struct unpack_fill<T, -1> {
+            static void apply(unpack_function<T> *) {
+            }
+        };
+
+        //unpack_add instances by width
+        template<typename T>
+        struct unpacker {
+            unpack_function<T> f[65];
+
+            unpacker() {
+                unpack_fill<T, 64>::apply(f);
+            }
+
+            static unpack_function<T> get(int width) {
+                static const unpacker table;
+                return table.f[width];
+            }
+        };
+
+        template<typename T>
+        inline uint64_t to_u64(T x) {
+            return (uint64_t) (typename std::make_unsigned<T>::type) x;
+        }
+
+        //one encoded block, sizes computed up front so the automatic choice doesn't encode everything
+        template<typename T>
+        struct block_plan {
+            block_encoding enc;
+            ssize_t nbytes;
+            T min;
+            int for_width;
+            uint64_t min_delta;
+            int delta_width;
+            ssize_t nruns;
+        };
+
+        template<typename T>
+        block_plan<T> plan_block(const T *x, ssize_t n, block_encoding enc) {
+            typedef typename std::make_unsigned<T>::type U;
+            typedef typename std::make_signed<T>::type S;
+            block_plan<T> p;
+            p.min = *std::min_element(x, x + n);
+            const T mx = *std::max_element(x, x + n);
+            p.for_width = bit_width(to_u64(T(U(mx) - U(p.min))));
+            S min_d = n > 1 ? (S) (U) (U(x[1]) - U(x[0])) : 0, max_d = min_d;
+            p.nruns = 1;
+            for (ssize_t i = 1; i < n; ++i) {
+                const S d = (S) (U) (U(x[i]) - U(x[i - 1]));
+                min_d = std::min(min_d, d);
+                max_d = std::max(max_d, d);
+                if (x[i] != x[i - 1]) ++p.nruns;
+            }
+            p.min_delta = to_u64(min_d);
+            p.delta_width = bit_width(to_u64(T(U(max_d) - U(min_d))));
+
+            const ssize_t raw = n * (ssize_t) sizeof(T);
+            const ssize_t forb = 16 + packed_bytes(n, p.for_width);
+            const ssize_t delta = 24 + packed_bytes(n - 1, p.delta_width);
+            const ssize_t rle = 8 + p.nruns * (ssize_t) (sizeof(T) + 4);
+            if (enc == block_encoding::automatic) {
+                enc = block_encoding::raw;
+                ssize_t best = raw;
+                if (forb < best) best = forb, enc = block_encoding::frame_of_reference;
+                if (delta < best) best = delta, enc = block_encoding::delta;
+                if (rle < best) enc = block_encoding::rle;
+            }
+            p.enc = enc;
+            switch (enc) {
+                case block_encoding::raw:
+                    p.nbytes = raw;
+                    break;
+                case block_encoding::frame_of_reference:
+                    p.nbytes = forb;
+                    break;
+                case block_encoding::delta:
+                    p.nbytes = delta;
+                    break;
+                case block_encoding::rle:
+                    p.nbytes = rle;
+                    break;
+                default:
+                    throw std::runtime_error("compress: invalid block encoding");
+            }
+            return p;
+        }
+
+        //out is zeroed and has at least p.nbytes + 8 bytes
+        template<typename T>
+        void encode_block(const T *x, ssize_t n, const block_plan<T> &p, uint8_t *out, std::vector<uint64_t> &tmp) {
+            typedef typename std::make_unsigned<T>::type U;
+            switch (p.enc) {
+                case block_encoding::raw:
+                    memcpy(out, x, n * sizeof(T));
+                    break;
+                case block_encoding::frame_of_reference:
+                    store64(out, to_u64(p.min));
+                    store64(out + 8, p.for_width);
+                    tmp.resize(n);
+                    for (ssize_t i = 0; i < n; ++i)
+                        tmp[i] = to_u64(T(U(x[i]) - U(p.min)));
+                    pack(tmp.data(), n, p.for_width, out + 16);
+                    break;
+                case block_encoding::delta:
+                    store64(out, to_u64(x[0]));
+                    store64(out + 8, p.min_delta);
+                    store64(out + 16, p.delta_width);
+                    tmp.resize(n);
+                    for (ssize_t i = 1; i < n; ++i)
+                        tmp[i - 1] = to_u64(T(U(x[i]) - U(x[i - 1]) - U(p.min_delta)));
+                    pack(tmp.data(), n - 1, p.delta_width, out + 24);
+                    break;
+                case block_encoding::rle: {
+                    store64(out, p.nruns);
+                    uint8_t *values = out + 8, *lengths = values + p.nruns * sizeof(T);
+                    ssize_t r = 0, start = 0;
+                    for (ssize_t i = 1; i <= n; ++i) {
+                        if (i == n || x[i] != x[start]) {
+                            const uint32_t len = (uint32_t) (i - start);
+                            memcpy(values + r * sizeof(T), &x[start], sizeof(T));
+                            memcpy(lengths + r * 4, &len, 4);
+                            ++r;
+                            start = i;
+                        }
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        //width stored in a frame_of_reference or delta payload
+        inline int stored_width(const uint8_t *payload, block_encoding enc) {
+            return (int) load64(payload + (enc == block_encoding::delta ? 16 : 8));
+        }
+    }
+
+    namespace detail {
+        void block_codec_validate(const uint8_t *p, ssize_t nbytes, array_dtype dtype) {
+            if (!little_endian_host())
+                throw std::runtime_error("compressed_array1: needs a little-endian host");
+            block_codec_header h;
+            if (nbytes < (ssize_t) sizeof(h) + block_codec_padding)
+                throw std::runtime_error("compressed_array1: buffer is too short");
+            memcpy(&h, p, sizeof(h));
+            if (memcmp(h.magic, block_codec_magic, 4) != 0 || h.version != block_codec_version)
+                throw std::runtime_error("compressed_array1: not a block compressed array");
+            if (h.dtype != (uint32_t) dtype)
+                throw std::runtime_error("compressed_array1: different element type");
+            if (h.block_size == 0 || h.nblocks != (h.size + h.block_size - 1) / h.block_size
+                    || h.nblocks > (uint64_t) (nbytes - sizeof(h)) / sizeof(block_codec_entry))
+                throw std::runtime_error("compressed_array1: corrupt header");
+            const ssize_t elem = array_dtype_size(dtype);
+            const uint64_t limit = nbytes - block_codec_padding;
+            for (uint64_t b = 0; b < h.nblocks; ++b) {
+                block_codec_entry e;
+                memcpy(&e, p + sizeof(h) + b * sizeof(e), sizeof(e));
+                const ssize_t n = (ssize_t) std::min<uint64_t>(h.block_size, h.size - b * h.block_size);
+                const block_encoding enc = (block_encoding) e.encoding;
+                bool ok = e.offset % 8 == 0 && e.offset <= limit && e.nbytes <= limit - e.offset;
+                if (ok) {
+                    const uint8_t *q = p + e.offset;
+                    switch (enc) {
+                        case block_encoding::raw:
+                            ok = e.nbytes == n * elem;
+                            break;
+                        case block_encoding::frame_of_reference:
+                        case block_encoding::delta: {
+                            const ssize_t head = enc == block_encoding::delta ? 24 : 16;
+                            ok = e.nbytes >= head;
+                            if (ok) {
+                                const int w = stored_width(q, enc);
+                                const ssize_t count = enc == block_encoding::delta ? n - 1 : n;
+                                ok = w >= 0 && w <= 8 * elem && e.nbytes == head + packed_bytes(count, w);
+                            }
+                            break;
+                        }
+                        case block_encoding::rle: {
+                            ok = e.nbytes >= 8;
+                            if (!ok)
+                                break;
+                            const uint64_t nruns = load64(q);
+                            ok = nruns <= (uint64_t) n && e.nbytes == 8 + nruns * (elem + 4);
+                            uint64_t total = 0;
+                            for (uint64_t r = 0; ok && r < nruns; ++r) {
+                                uint32_t len;
+                                memcpy(&len, q + 8 + nruns * elem + r * 4, 4);
+                                total += len;
+                            }
+                            ok = ok && total == (uint64_t) n;
+                            break;
+                        }
+                        default:
+                            ok = false;
+                    }
+                }
+                if (!ok)
+                    throw std::runtime_error("compressed_array1: corrupt block " + std::to_string(b));
+            }
+        }
+
+        template<typename T>
+        darray1<uint8_t> block_encode(const T *x, ssize_t n, block_encoding enc, ssize_t block_size) {
+            if (!little_endian_host())
+                throw std::runtime_error("compress: needs a little-endian host");
+            if (block_size <= 0 || block_size > max_codec_block_size<T>())
+                throw std::runtime_error("compress: invalid block size");
+            const ssize_t nblocks = (n + block_size - 1) / block_size;
+            std::vector<block_plan<T>> plans(nblocks);
+            std::vector<block_codec_entry> entries(nblocks);
+            ssize_t pos = sizeof(block_codec_header) + nblocks * sizeof(block_codec_entry);
+            for (ssize_t b = 0; b < nblocks; ++b) {
+                const ssize_t b0 = b * block_size, bn = std::min(block_size, n - b0);
+                plans[b] = plan_block(x + b0, bn, enc);
+                pos = align8(pos);
+                entries[b].offset = pos;
+                entries[b].encoding = (uint32_t) plans[b].enc;
+                entries[b].nbytes = (uint32_t) plans[b].nbytes;
+                pos += plans[b].nbytes;
+            }
+
+            darray1<uint8_t> result(pos + block_codec_padding, uint8_t(0));
+            block_codec_header h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, block_codec_magic, 4);
+            h.version = block_codec_version;
+            h.dtype = (uint32_t) array_dtype_of<T>::value;
+            h.block_size = (uint32_t) block_size;
+            h.size = n;
+            h.nblocks = nblocks;
+            memcpy(result.data(), &h, sizeof(h));
+            if (nblocks > 0)
+                memcpy(result.data() + sizeof(h), entries.data(), nblocks * sizeof(block_codec_entry));
+            std::vector<uint64_t> tmp;
+            for (ssize_t b = 0; b < nblocks; ++b) {
+                const ssize_t b0 = b * block_size, bn = std::min(block_size, n - b0);
+                encode_block(x + b0, bn, plans[b], result.data() + entries[b].offset, tmp);
+            }
+            return result;
+        }
+
+        template<typename T>
+        void block_decode(const uint8_t *payload, block_encoding enc, ssize_t n, T *out) {
+            typedef typename std::make_unsigned<T>::type U;
+            switch (enc) {
+                case block_encoding::raw:
+                    memcpy(out, payload, n * sizeof(T));
+                    break;
+                case block_encoding::frame_of_reference:
+                    unpacker<T>::get(stored_width(payload, enc))(payload + 16, n, load64(payload), out);
+                    break;
+                case block_encoding::delta: {
+                    //deltas first, then a running sum over them
+                    out[0] = (T) (U) load64(payload);
+                    unpacker<T>::get(stored_width(payload, enc))(payload + 24, n - 1, load64(payload + 8), out + 1);
+                    U acc = U(out[0]);
+                    for (ssize_t i = 1; i < n; ++i) {
+                        acc = U(acc + U(out[i]));
+                        out[i] = (T) acc;
+                    }
+                    break;
+                }
+                case block_encoding::rle: {
+                    const uint64_t nruns = load64(payload);
+                    const uint8_t *values = payload + 8, *lengths = values + nruns * sizeof(T);
+                    for (uint64_t r = 0; r < nruns; ++r) {
+                        T v;
+                        uint32_t len;
+                        memcpy(&v, values + r * sizeof(T), sizeof(T));
+                        memcpy(&len, lengths + r * 4, 4);
+                        std::fill(out, out + len, v);
+                        out += len;
+                    }
+                    break;
+                }
+                default:
+                    throw std::runtime_error("compressed_array1: invalid block encoding");
+            }
+        }
+
+#define SX_INSTANTIATE_BLOCK_CODEC(T) \
+        template darray1<uint8_t> block_encode<T>(const T *, ssize_t, block_encoding, ssize_t); \
+        template void block_decode<T>(const uint8_t *, block_encoding, ssize_t, T *);
+
+        SX_INSTANTIATE_BLOCK_CODEC(int8_t)
+        SX_INSTANTIATE_BLOCK_CODEC(uint8_t)
+        SX_INSTANTIATE_BLOCK_CODEC(int16_t)
+        SX_INSTANTIATE_BLOCK_CODEC(uint16_t)
+        SX_INSTANTIATE_BLOCK_CODEC(int32_t)
+        SX_INSTANTIATE_BLOCK_CODEC(uint32_t)
+        SX_INSTANTIATE_BLOCK_CODEC(int64_t)
+        SX_INSTANTIATE_BLOCK_CODEC(uint64_t)
+        SX_INSTANTIATE_BLOCK_CODEC(char)
+
+#undef SX_INSTANTIATE_BLOCK_CODEC
+    }
+
+}
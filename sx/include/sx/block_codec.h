@@ -0,0 +1,247 @@
+#ifndef BLOCK_CODEC_INCLUDED_2290571
+#define BLOCK_CODEC_INCLUDED_2290571
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "types.h"
+#include "array1.h"
+#include "array_file.h"
+
+namespace sx {
+
+    //compressed integer arrays, split into blocks that are encoded independently
+    //
+    //  offset 0:   block_codec_header
+    //  then:       nblocks x block_codec_entry, the random-access block index
+    //  then:       block payloads, each 8-byte aligned
+    //  at the end: 16 zero bytes, so the decoder can always load 8 bytes at once
+    //
+    //payloads by encoding, n is the number of elements in the block:
+    //  raw:                n x T
+    //  frame_of_reference: uint64 min, uint64 width, (x - min) bitpacked
+    //  delta:              uint64 first, uint64 min_delta, uint64 width, (x[i] - x[i-1] - min_delta) bitpacked for i > 0
+    //  rle:                uint64 nruns, nruns x T values, nruns x uint32 run lengths
+    //bitpacking stores groups of 8 values in width bytes, least significant bits first
+
+    enum class block_encoding : uint32_t {
+        raw = 0,
+        frame_of_reference = 1, //small range of values
+        delta = 2,              //sorted or slowly changing values, e.g. timestamps
+        rle = 3,                //long runs of repeated values
+        automatic = 255         //compress() only: the smallest of the above, per block
+    };
+
+    struct block_codec_header {
+        char magic[4];      //"SXBC"
+        uint32_t version;
+        uint32_t dtype;     //array_dtype
+        uint32_t block_size;
+        uint64_t size;
+        uint64_t nblocks;
+    };
+
+    struct block_codec_entry {
+        uint64_t offset;    //of the payload from the start of the buffer
+        uint32_t encoding;  //block_encoding
+        uint32_t nbytes;
+    };
+
+    static_assert(sizeof(block_codec_header) == 32, "block_codec_header layout");
+    static_assert(sizeof(block_codec_entry) == 16, "block_codec_entry layout");
+
+    const ssize_t default_codec_block_size = 1024;
+
+    //the largest block_size of compress() for T, so the payload of a block fits the uint32 nbytes of its entry
+    //in every encoding: bitpacking takes up to 8 bytes per element plus 80 bytes of header and group padding,
+    //rle a T and a uint32 run length per element
+    template<typename T>
+    ssize_t max_codec_block_size() {
+        return ssize_t((uint64_t(std::numeric_limits<uint32_t>::max()) - 80) / std::max<uint64_t>(8, sizeof(T) + 4));
+    }
+
+    namespace detail {
+        //checks the header and the index against the buffer size, throws if they don't match
+        void block_codec_validate(const uint8_t *p, ssize_t nbytes, array_dtype dtype);
+
+        //encodes x (n elements) into a complete buffer
+        template<typename T>
+        darray1<uint8_t> block_encode(const T *x, ssize_t n, block_encoding enc, ssize_t block_size);
+
+        //decodes the n elements of one block into out
+        template<typename T>
+        void block_decode(const uint8_t *payload, block_encoding enc, ssize_t n, T *out);
+    }
+
+    template<typename T>
+    class dcompressed_array1;
+
+    //view of a block compressed array, e.g. in memory or in a mapped array file
+    //decodes into darray1s or any contiguous output, slices only decode the blocks they overlap
+    template<typename T>
+    class compressed_array1 {
+        static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                "compressed_array1: integer element type expected");
+    public:
+        typedef T value_type;
+
+        compressed_array1() : p_(nullptr), nbytes_(0) {
+        }
+
+        //bytes must be contiguous, as written by compress()
+        explicit compressed_array1(const array1<uint8_t> &bytes) : p_(bytes.data()), nbytes_(bytes.size()) {
+            if (bytes.stride() != 1 && bytes.size() > 1)
+                throw std::runtime_error("compressed_array1: bytes must be contiguous");
+            detail::block_codec_validate(p_, nbytes_, array_dtype_of<T>::value);
+        }
+
+        ssize_t size() const {
+            return p_ ? (ssize_t) header().size : 0;
+        }
+
+        ssize_t block_size() const {
+            return header().block_size;
+        }
+
+        ssize_t nblocks() const {
+            return p_ ? (ssize_t) header().nblocks : 0;
+        }
+
+        block_encoding encoding(ssize_t block) const {
+            return (block_encoding) entry(block).encoding;
+        }
+
+        //the serialized form, e.g. for array_file_writer
+        array1<uint8_t> bytes() const {
+            return array1<uint8_t>(p_, nbytes_);
+        }
+
+        //elements [lo, hi) into out[0, hi - lo)
+        void decode_into(ssize_t lo, ssize_t hi, T *out) const {
+            if (lo < 0 || hi > size() || lo > hi)
+                throw std::runtime_error("compressed_array1::decode: range out of bounds");
+            if (lo == hi)
+                return;
+            const ssize_t bs = block_size();
+            darray1<T> partial;
+            for (ssize_t b = lo / bs; b * bs < hi; ++b) {
+                const ssize_t b0 = b * bs, n = std::min(bs, size() - b0);
+                const block_codec_entry &e = entry(b);
+                if (b0 >= lo && b0 + n <= hi) {
+                    detail::block_decode(p_ + e.offset, (block_encoding) e.encoding, n, out + (b0 - lo));
+                    continue;
+                }
+                //first or last block of the slice
+                partial.resize(n);
+                detail::block_decode(p_ + e.offset, (block_encoding) e.encoding, n, partial.data());
+                const ssize_t l = std::max(lo, b0), h = std::min(hi, b0 + n);
+                std::copy(partial.data() + (l - b0), partial.data() + (h - b0), out + (l - lo));
+            }
+        }
+
+        void decode_into(ssize_t lo, ssize_t hi, const marray1<T> &out) const {
+            if (out.size() != hi - lo || (out.stride() != 1 && out.size() > 1))
+                throw std::runtime_error("compressed_array1::decode: output must be contiguous and of matching size");
+            decode_into(lo, hi, out.data());
+        }
+
+        darray1<T> decode(ssize_t lo, ssize_t hi) const {
+            darray1<T> result(hi - lo);
+            decode_into(lo, hi, result.data());
+            return result;
+        }
+
+        darray1<T> decode() const {
+            return decode(0, size());
+        }
+
+        //decodes the block holding it
+        T operator[](ssize_t idx) const {
+            T x;
+            decode_into(idx, idx + 1, &x);
+            return x;
+        }
+
+    private:
+        const block_codec_header &header() const {
+            return *reinterpret_cast<const block_codec_header *>(p_);
+        }
+
+        const block_codec_entry &entry(ssize_t block) const {
+            return reinterpret_cast<const block_codec_entry *>(p_ + sizeof(block_codec_header))[block];
+        }
+
+        const uint8_t *p_;
+        ssize_t nbytes_;
+    };
+
+    //owning block compressed array, see compress()
+    template<typename T>
+    class dcompressed_array1 {
+    public:
+        typedef T value_type;
+
+        dcompressed_array1() {
+        }
+
+        explicit dcompressed_array1(darray1<uint8_t> &&bytes) : bytes_(std::move(bytes)) {
+            detail::block_codec_validate(bytes_.data(), bytes_.size(), array_dtype_of<T>::value);
+        }
+
+        compressed_array1<T> view() const {
+            return bytes_.empty() ? compressed_array1<T>() : compressed_array1<T>(array1<uint8_t>(bytes_));
+        }
+
+        operator compressed_array1<T>() const {
+            return view();
+        }
+
+        ssize_t size() const {
+            return view().size();
+        }
+
+        //compressed size in bytes, header and index included
+        ssize_t nbytes() const {
+            return bytes_.size();
+        }
+
+        const darray1<uint8_t> &bytes() const {
+            return bytes_;
+        }
+
+        darray1<T> decode() const {
+            return view().decode();
+        }
+
+        darray1<T> decode(ssize_t lo, ssize_t hi) const {
+            return view().decode(lo, hi);
+        }
+
+    private:
+        darray1<uint8_t> bytes_;
+    };
+
+    //compresses x block by block with enc, or with the smallest encoding per block if enc is automatic
+    template<typename T, bool Mutable>
+    dcompressed_array1<T> compress(const array1<T, Mutable> &x, block_encoding enc = block_encoding::automatic,
+            ssize_t block_size = default_codec_block_size) {
+        typedef typename std::remove_const<T>::type value_type;
+        if (x.stride() == 1 || x.size() <= 1)
+            return dcompressed_array1<value_type>(detail::block_encode(x.data(), x.size(), enc, block_size));
+        const darray1<value_type> c(BEGINEND(x));
+        return dcompressed_array1<value_type>(detail::block_encode(c.data(), c.size(), enc, block_size));
+    }
+
+    template<typename T>
+    dcompressed_array1<T> compress(const darray1<T> &x, block_encoding enc = block_encoding::automatic,
+            ssize_t block_size = default_codec_block_size) {
+        return compress(array1<T>(x), enc, block_size);
+    }
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef BROADCAST_INCLUDED_3810452
+#define BROADCAST_INCLUDED_3810452
+
+#include <stdexcept>
+#include <type_traits>
+
+#include "array1.h"
+#include "array2.h"
+#include "traits.h"
+
+namespace sx {
+
+    //views of a vector as a 1 x n row or an n x 1 column
+    //the length-1 dimension gets stride 0 so broadcast_to can stretch it without copying
+    template<typename T, bool Mutable>
+    array2<T> as_row(const array1<T, Mutable> &v) {
+        return array2<T>(v.data(), 1, v.size(), 0, v.stride());
+    }
+
+    template<typename T>
+    array2<T> as_row(const darray1<T> &v) {
+        return array2<T>(v.data(), 1, v.size(), 0, 1);
+    }
+
+    template<typename T, bool Mutable>
+    array2<T> as_col(const array1<T, Mutable> &v) {
+        return array2<T>(v.data(), v.size(), 1, v.stride(), 0);
+    }
+
+    template<typename T>
+    array2<T> as_col(const darray1<T> &v) {
+        return array2<T>(v.data(), v.size(), 1, 1, 0);
+    }
+
+    //operand of a broadcasting op as a read-only 2D view
+    //a 1D operand is a row vector, like in NumPy; use as_col() for a column vector
+    template<typename T, bool Mutable>
+    array2<T> as_array2(const array2<T, Mutable> &x) {
+        return array2<T>(x.data(), x.nr(), x.nc(), x.strides()[0], x.strides()[1]);
+    }
+
+    template<typename T>
+    array2<T> as_array2(const darray2<T> &x) {
+        return array2<T>(x);
+    }
+
+    template<typename T, bool Mutable>
+    array2<T> as_array2(const array1<T, Mutable> &x) {
+        return as_row(x);
+    }
+
+    template<typename T>
+    array2<T> as_array2(const darray1<T> &x) {
+        return as_row(x);
+    }
+
+    //common extent of two broadcast dimensions, throws if they're incompatible
+    inline ssize_t broadcast_extent(ssize_t n1, ssize_t n2) {
+        if (n1 == n2 || n2 == 1)
+            return n1;
+        if (n1 == 1)
+            return n2;
+        throw std::runtime_error("broadcast: incompatible shapes");
+    }
+
+    //stretch length-1 dimensions of x to nr x nc by setting their strides to 0
+    template<typename T, bool Mutable>
+    array2<T, Mutable> broadcast_to(const array2<T, Mutable> &x, ssize_t nr, ssize_t nc) {
+        if (broadcast_extent(nr, x.nr()) != nr || broadcast_extent(nc, x.nc()) != nc)
+            throw std::runtime_error("broadcast_to: incompatible shapes");
+        return array2<T, Mutable>(x.data(), nr, nc,
+                x.nr() == nr ? x.strides()[0] : 0,
+                x.nc() == nc ? x.strides()[1] : 0);
+    }
+
+    //fused elementwise op over the broadcast shape of x and y
+    //walks the result in row-major order, nothing is materialized besides the result
+    template<typename T1, typename T2, typename BinaryOp>
+    darray2<typename std::result_of<BinaryOp(const T1 &, const T2 &)>::type>
+    broadcast_zip(const array2<T1> &x, const array2<T2> &y, BinaryOp &&op) {
+        typedef typename std::result_of<BinaryOp(const T1 &, const T2 &)>::type result_type;
+        const ssize_t nr = broadcast_extent(x.nr(), y.nr());
+        const ssize_t nc = broadcast_extent(x.nc(), y.nc());
+        const array2<T1> bx = broadcast_to(x, nr, nc);
+        const array2<T2> by = broadcast_to(y, nr, nc);
+        const ssize_t xs0 = bx.strides()[0], xs1 = bx.strides()[1];
+        const ssize_t ys0 = by.strides()[0], ys1 = by.strides()[1];
+
+        darray2<result_type> result(nr, nc);
+        result_type *out = result.data();
+        for (ssize_t r = 0; r < nr; ++r, out += nc) {
+            const T1 *px = bx.data() + r * xs0;
+            const T2 *py = by.data() + r * ys0;
+            //separate the common unit/zero stride cases so the inner loops vectorize
+            if (xs1 == 1 && ys1 == 1) {
+                for (ssize_t c = 0; c < nc; ++c) out[c] = op(px[c], py[c]);
+            } else if (xs1 == 1 && ys1 == 0) {
+                const T2 &yv = *py;
+                for (ssize_t c = 0; c < nc; ++c) out[c] = op(px[c], yv);
+            } else if (xs1 == 0 && ys1 == 1) {
+                const T1 &xv = *px;
+                for (ssize_t c = 0; c < nc; ++c) out[c] = op(xv, py[c]);
+            } else {
+                for (ssize_t c = 0; c < nc; ++c) out[c] = op(px[c * xs1], py[c * ys1]);
+            }
+        }
+        return result;
+    }
+
+    namespace detail {
+        //at least one operand is 2D, the other is 1D or 2D
+        template<typename E1, typename E2>
+        struct broadcastable {
+            static const bool value =
+                    container_traits<E1>::indexable && container_traits<E2>::indexable &&
+                    (container_traits<E1>::two_dimensional || container_traits<E2>::two_dimensional);
+        };
+
+        //2D operand with an atom
+        template<typename E1, typename T2>
+        struct broadcastable_atom {
+            static const bool value =
+                    container_traits<E1>::two_dimensional && !container_traits<T2>::indexable;
+        };
+
+        //as_array2(x) compiles, the operand has a strided view for broadcast_zip
+        template<typename E>
+        struct has_array2_view {
+            template<typename U>
+            static std::true_type test(decltype(as_array2(std::declval<const U &>())) *);
+
+            template<typename U>
+            static std::false_type test(...);
+
+            static const bool value = decltype(test<E>(nullptr))::value;
+        };
+
+        //shape and (row, col) access of any operand, a 1D one is a row vector
+        template<typename E>
+        ssize_t zip_nr(const E &e, std::true_type) {
+            return e.nr();
+        }
+
+        template<typename E>
+        ssize_t zip_nr(const E &, std::false_type) {
+            return 1;
+        }
+
+        template<typename E>
+        ssize_t zip_nc(const E &e, std::true_type) {
+            return e.nc();
+        }
+
+        template<typename E>
+        ssize_t zip_nc(const E &e, std::false_type) {
+            return e.size();
+        }
+
+        template<typename E>
+        typename E::const_reference zip_at(const E &e, ssize_t r, ssize_t c, std::true_type) {
+            return e(r, c);
+        }
+
+        template<typename E>
+        typename E::const_reference zip_at(const E &e, ssize_t, ssize_t c, std::false_type) {
+            return e[c];
+        }
+
+        //broadcast_zip through (row, col) access, for 2D containers without a strided view like
+        //tiled_darray2 and segmented_darray2
+        template<typename E1, typename E2, typename BinaryOp>
+        darray2<typename std::result_of<BinaryOp(const typename E1::value_type &, const typename E2::value_type &)>::type>
+        zip(const E1 &e1, const E2 &e2, BinaryOp &&op, std::false_type) {
+            typedef typename std::result_of<BinaryOp(const typename E1::value_type &, const typename E2::value_type &)>::type result_type;
+            typedef std::integral_constant<bool, container_traits<E1>::two_dimensional> two_d1;
+            typedef std::integral_constant<bool, container_traits<E2>::two_dimensional> two_d2;
+            const ssize_t nr1 = zip_nr(e1, two_d1()), nc1 = zip_nc(e1, two_d1());
+            const ssize_t nr2 = zip_nr(e2, two_d2()), nc2 = zip_nc(e2, two_d2());
+            const ssize_t nr = broadcast_extent(nr1, nr2);
+            const ssize_t nc = broadcast_extent(nc1, nc2);
+            darray2<result_type> result(nr, nc);
+            result_type *out = result.data();
+            for (ssize_t r = 0; r < nr; ++r, out += nc) {
+                const ssize_t r1 = nr1 == 1 ? 0 : r, r2 = nr2 == 1 ? 0 : r;
+                for (ssize_t c = 0; c < nc; ++c)
+                    out[c] = op(zip_at(e1, r1, nc1 == 1 ? 0 : c, two_d1()), zip_at(e2, r2, nc2 == 1 ? 0 : c, two_d2()));
+            }
+            return result;
+        }
+
+        template<typename E1, typename E2, typename BinaryOp>
+        darray2<typename std::result_of<BinaryOp(const typename E1::value_type &, const typename E2::value_type &)>::type>
+        zip(const E1 &e1, const E2 &e2, BinaryOp &&op, std::true_type) {
+            return broadcast_zip(as_array2(e1), as_array2(e2), std::forward<BinaryOp>(op));
+        }
+
+        //broadcast_zip of the views if both operands have one, element by element otherwise
+        template<typename E1, typename E2, typename BinaryOp>
+        darray2<typename std::result_of<BinaryOp(const typename E1::value_type &, const typename E2::value_type &)>::type>
+        zip(const E1 &e1, const E2 &e2, BinaryOp &&op) {
+            return zip(e1, e2, std::forward<BinaryOp>(op),
+                    std::integral_constant<bool, has_array2_view<E1>::value && has_array2_view<E2>::value>());
+        }
+    }
+
+    // op(list2, list2), op(list2, list), op(list, list2), op(list2, atom), op(atom, list2)
+    //an atom is a 1 x 1 view with zero strides
+#define SX_DEF_BROADCAST_OP(OP) \
+    template<typename E1, typename E2, typename std::enable_if<detail::broadcastable<E1, E2>::value>::type * = nullptr> \
+    darray2<decltype(std::declval<typename E1::value_type>() OP std::declval<typename E2::value_type>())> \
+    operator OP(const E1 &e1, const E2 &e2) { \
+        typedef typename E1::value_type t1; \
+        typedef typename E2::value_type t2; \
+        return detail::zip(e1, e2, [](const t1 &x, const t2 &y) { return x OP y; }); \
+    } \
+    template<typename E1, typename T2, typename std::enable_if<detail::broadcastable_atom<E1, T2>::value>::type * = nullptr> \
+    darray2<decltype(std::declval<typename E1::value_type>() OP std::declval<T2>())> \
+    operator OP(const E1 &e1, const T2 &t2) { \
+        typedef typename E1::value_type t1; \
+        return detail::zip(e1, array2<T2>(&t2, 1, 1, 0, 0), [](const t1 &x, const T2 &y) { return x OP y; }); \
+    } \
+    template<typename T1, typename E2, typename std::enable_if<detail::broadcastable_atom<E2, T1>::value>::type * = nullptr> \
+    darray2<decltype(std::declval<T1>() OP std::declval<typename E2::value_type>())> \
+    operator OP(const T1 &t1, const E2 &e2) { \
+        typedef typename E2::value_type t2; \
+        return detail::zip(array2<T1>(&t1, 1, 1, 0, 0), e2, [](const T1 &x, const t2 &y) { return x OP y; }); \
+    }
+
+    SX_DEF_BROADCAST_OP(+)
+
+    SX_DEF_BROADCAST_OP(-)
+
+    SX_DEF_BROADCAST_OP(*)
+
+    SX_DEF_BROADCAST_OP(/)
+
+#undef SX_DEF_BROADCAST_OP
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CHAR_SCAN_INCLUDED_5302871
+#define CHAR_SCAN_INCLUDED_5302871
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "integer/lowest_bit.h"
+
+namespace sx {
+
+    namespace detail {
+        //index of the lowest set bit, x != 0
+        inline int ctz32(unsigned x) {
+#if defined(__GNUC__)
+            return __builtin_ctz(x);
+#else
+            return lowest_bit(x);
+#endif
+        }
+    }
+
+    //first position in [p, end) holding a or b, end if there's none
+    //16 bytes per step with SSE2, bytewise otherwise
+    inline const char *scan_either(const char *p, const char *end, char a, char b) {
+#ifdef __SSE2__
+        const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+        for (; end - p >= 16; p += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const unsigned m = (unsigned) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)));
+            if (m != 0)
+                return p + detail::ctz32(m);
+        }
+#endif
+        for (; p != end; ++p)
+            if (*p == a || *p == b)
+                return p;
+        return end;
+    }
+
+    //first position in [p, end) holding c, end if there's none
+    inline const char *scan_char(const char *p, const char *end, char c) {
+        const void *r = p == end ? nullptr : memchr(p, c, end - p);
+        return r ? static_cast<const char *>(r) : end;
+    }
+
+}
+
+#endif
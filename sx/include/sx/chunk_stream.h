@@ -0,0 +1,388 @@
+#ifndef CHUNK_STREAM_INCLUDED_1184620
+#define CHUNK_STREAM_INCLUDED_1184620
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+#include "array1.h"
+
+namespace sx {
+
+    //lazily evaluated sequence delivered in chunks, for data that doesn't fit in memory
+    //next() returns the next chunk as a view that is valid until the following next() call,
+    //an empty view means the end of the stream
+    //each stage holds at most one chunk, so memory stays bounded by the chunk size times the number of stages
+    //copies share the underlying state: reading from one advances all of them
+    //so a stream can't be combined with itself or a stage of itself, e.g. s * s or each(f, s) + s throw,
+    //two sources over the same data can: stream_chunks(x) * stream_chunks(x)
+    template<typename T>
+    class chunk_stream {
+    public:
+        typedef T value_type;
+        typedef std::function<array1<T>()> next_function;
+        //identities of the sources a stream reads from, shared by its copies and the stages built on it
+        typedef std::vector<std::shared_ptr<const void>> source_list;
+
+        //a new source
+        explicit chunk_stream(next_function next)
+                : next_(std::move(next)), sources_(1, std::make_shared<char>()) {
+        }
+
+        //a stage reading from sources
+        chunk_stream(next_function next, source_list sources) : next_(std::move(next)), sources_(std::move(sources)) {
+        }
+
+        array1<T> next() const {
+            return next_();
+        }
+
+        const source_list &sources() const {
+            return sources_;
+        }
+
+    private:
+        next_function next_;
+        source_list sources_;
+    };
+
+    template<typename T>
+    struct is_chunk_stream : std::false_type {
+    };
+
+    template<typename T>
+    struct is_chunk_stream<chunk_stream<T>> : std::true_type {
+    };
+
+    //default number of elements per chunk for the sources below
+    const ssize_t default_chunk_size = ssize_t(1) << 16;
+
+    namespace detail {
+        template<typename T1, typename T2>
+        bool share_source(const chunk_stream<T1> &x, const chunk_stream<T2> &y) {
+            for (const auto &a : x.sources())
+                for (const auto &b : y.sources())
+                    if (a == b)
+                        return true;
+            return false;
+        }
+
+        //output buffer of a stream stage, only grows
+        template<typename T>
+        class chunk_buffer {
+        public:
+            chunk_buffer() : capacity_(0) {
+            }
+
+            T *get(ssize_t n) {
+                if (n > capacity_) {
+                    p_.reset(new T[n]);
+                    capacity_ = n;
+                }
+                return p_.get();
+            }
+
+        private:
+            std::unique_ptr<T[]> p_;
+            ssize_t capacity_;
+        };
+    }
+
+    //-----------------------------------------------------------------------------
+    // sources
+
+    //chunks of an array already in memory or mapped (see mapped_darray1), no copying
+    template<typename T, bool Mutable>
+    chunk_stream<T> stream_chunks(const array1<T, Mutable> &x, ssize_t chunk_size = default_chunk_size) {
+        struct state {
+            array1<T> x;
+            ssize_t pos;
+        };
+        auto s = std::make_shared<state>(state{x, 0});
+        return chunk_stream<T>([s, chunk_size]() -> array1<T> {
+            const ssize_t n = std::min(chunk_size, s->x.size() - s->pos);
+            if (n <= 0)
+                return array1<T>();
+            array1<T> r = s->x.slicen(s->pos, n);
+            s->pos += n;
+            return r;
+        });
+    }
+
+    template<typename T>
+    chunk_stream<T> stream_chunks(const darray1<T> &x, ssize_t chunk_size = default_chunk_size) {
+        return stream_chunks(array1<T>(x), chunk_size);
+    }
+
+    //raw T elements read from a file with fread, one chunk at a time
+    template<typename T>
+    chunk_stream<T> stream_file(const std::string &path, ssize_t chunk_size = default_chunk_size) {
+        struct state {
+            std::shared_ptr<FILE> f;
+            detail::chunk_buffer<T> buf;
+        };
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+            throw std::runtime_error("stream_file: can't open '" + path + "': " + strerror(errno));
+        auto s = std::make_shared<state>();
+        s->f.reset(f, fclose);
+        return chunk_stream<T>([s, chunk_size, path]() -> array1<T> {
+            T *p = s->buf.get(chunk_size);
+            const size_t n = fread(p, sizeof(T), chunk_size, s->f.get());
+            if (n == 0 && ferror(s->f.get()))
+                throw std::runtime_error("stream_file: can't read '" + path + "'");
+            return array1<T>(p, (ssize_t) n);
+        });
+    }
+
+    //n elements, element i is gen(i)
+    template<typename T, typename F>
+    chunk_stream<T> stream_generate(ssize_t n, F gen, ssize_t chunk_size = default_chunk_size) {
+        struct state {
+            ssize_t pos;
+            detail::chunk_buffer<T> buf;
+        };
+        auto s = std::make_shared<state>();
+        s->pos = 0;
+        return chunk_stream<T>([s, n, gen, chunk_size]() mutable -> array1<T> {
+            const ssize_t m = std::min(chunk_size, n - s->pos);
+            if (m <= 0)
+                return array1<T>();
+            T *p = s->buf.get(m);
+            for (ssize_t i = 0; i < m; ++i)
+                p[i] = gen(s->pos + i);
+            s->pos += m;
+            return array1<T>(p, m);
+        });
+    }
+
+    //-----------------------------------------------------------------------------
+    // stages
+
+    // each(Fx, stream)
+    template<typename UnaryPr, typename T>
+    chunk_stream<typename std::result_of<UnaryPr(const T &)>::type> each(UnaryPr fun, const chunk_stream<T> &x) {
+        typedef typename std::result_of<UnaryPr(const T &)>::type result_type;
+        auto buf = std::make_shared<detail::chunk_buffer<result_type>>();
+        return chunk_stream<result_type>([fun, x, buf]() mutable -> array1<result_type> {
+            array1<T> in = x.next();
+            const ssize_t n = in.size();
+            result_type *out = buf->get(n);
+            for (ssize_t i = 0; i < n; ++i)
+                out[i] = fun(in[i]);
+            return array1<result_type>(out, n);
+        }, x.sources());
+    }
+
+    //elementwise fun over two streams of the same length, chunk boundaries don't need to match
+    //x and y must not read from the same source, they would take turns pulling its chunks
+    template<typename BinaryOp, typename T1, typename T2>
+    chunk_stream<typename std::result_of<BinaryOp(const T1 &, const T2 &)>::type>
+    zip_with(BinaryOp fun, const chunk_stream<T1> &x, const chunk_stream<T2> &y) {
+        typedef typename std::result_of<BinaryOp(const T1 &, const T2 &)>::type result_type;
+        if (detail::share_source(x, y))
+            throw std::runtime_error("zip_with: both streams read from the same source, copies of a stream share its position");
+        typename chunk_stream<result_type>::source_list sources = x.sources();
+        sources.insert(sources.end(), y.sources().begin(), y.sources().end());
+        struct state {
+            chunk_stream<T1> x;
+            chunk_stream<T2> y;
+            array1<T1> cx;
+            array1<T2> cy;
+            ssize_t ox, oy;
+            detail::chunk_buffer<result_type> buf;
+        };
+        auto s = std::make_shared<state>(state{x, y, array1<T1>(), array1<T2>(), 0, 0, detail::chunk_buffer<result_type>()});
+        return chunk_stream<result_type>([fun, s]() mutable -> array1<result_type> {
+            if (s->ox == s->cx.size()) {
+                s->cx = s->x.next();
+                s->ox = 0;
+            }
+            if (s->oy == s->cy.size()) {
+                s->cy = s->y.next();
+                s->oy = 0;
+            }
+            const ssize_t n = std::min(s->cx.size() - s->ox, s->cy.size() - s->oy);
+            if (n == 0) {
+                if (s->cx.size() != s->cy.size())
+                    throw std::runtime_error("zip_with: streams of different lengths");
+                return array1<result_type>();
+            }
+            result_type *out = s->buf.get(n);
+            for (ssize_t i = 0; i < n; ++i)
+                out[i] = fun(s->cx[s->ox + i], s->cy[s->oy + i]);
+            s->ox += n;
+            s->oy += n;
+            return array1<result_type>(out, n);
+        }, std::move(sources));
+    }
+
+    // op(stream, stream), op(stream, atom), op(atom, stream)
+#define SX_DEF_STREAM_OP(OP) \
+    template<typename T1, typename T2> \
+    chunk_stream<decltype(std::declval<T1>() OP std::declval<T2>())> \
+    operator OP(const chunk_stream<T1> &x, const chunk_stream<T2> &y) { \
+        return zip_with([](const T1 &a, const T2 &b) { return a OP b; }, x, y); \
+    } \
+    template<typename T1, typename T2, typename std::enable_if<!is_chunk_stream<T2>::value>::type * = nullptr> \
+    chunk_stream<decltype(std::declval<T1>() OP std::declval<T2>())> \
+    operator OP(const chunk_stream<T1> &x, const T2 &t2) { \
+        return each([t2](const T1 &a) { return a OP t2; }, x); \
+    } \
+    template<typename T1, typename T2, typename std::enable_if<!is_chunk_stream<T1>::value>::type * = nullptr> \
+    chunk_stream<decltype(std::declval<T1>() OP std::declval<T2>())> \
+    operator OP(const T1 &t1, const chunk_stream<T2> &y) { \
+        return each([t1](const T2 &b) { return t1 OP b; }, y); \
+    }
+
+    SX_DEF_STREAM_OP(+)
+
+    SX_DEF_STREAM_OP(-)
+
+    SX_DEF_STREAM_OP(*)
+
+    SX_DEF_STREAM_OP(/)
+
+    SX_DEF_STREAM_OP(==)
+
+    SX_DEF_STREAM_OP(!=)
+
+    SX_DEF_STREAM_OP(<)
+
+    SX_DEF_STREAM_OP(<=)
+
+    SX_DEF_STREAM_OP(>)
+
+    SX_DEF_STREAM_OP(>=)
+
+#undef SX_DEF_STREAM_OP
+
+    // where(stream): positions of the true elements, counted from the start of the stream
+    template<typename T>
+    chunk_stream<ssize_t> where(const chunk_stream<T> &x) {
+        struct state {
+            chunk_stream<T> x;
+            ssize_t base;
+            detail::chunk_buffer<ssize_t> buf;
+        };
+        auto s = std::make_shared<state>(state{x, 0, detail::chunk_buffer<ssize_t>()});
+        return chunk_stream<ssize_t>([s]() -> array1<ssize_t> {
+            //skip chunks without any hit, an empty result means the end
+            for (;;) {
+                array1<T> in = s->x.next();
+                const ssize_t n = in.size();
+                if (n == 0)
+                    return array1<ssize_t>();
+                ssize_t *out = s->buf.get(n);
+                ssize_t count = 0;
+                for (ssize_t i = 0; i < n; ++i)
+                    if (in[i])
+                        out[count++] = s->base + i;
+                s->base += n;
+                if (count > 0)
+                    return array1<ssize_t>(out, count);
+            }
+        }, x.sources());
+    }
+
+    //-----------------------------------------------------------------------------
+    // sinks, these consume the stream
+
+    //calls f(chunk) for each chunk, returns the number of elements
+    template<typename T, typename F>
+    ssize_t for_each_chunk(const chunk_stream<T> &x, F &&f) {
+        ssize_t total = 0;
+        for (array1<T> c = x.next(); c.size() > 0; c = x.next()) {
+            f(c);
+            total += c.size();
+        }
+        return total;
+    }
+
+    // over(atom, Fxy, stream), the state is carried across chunks
+    template<typename X, typename Fxy, typename T>
+    X over(const X &x0, Fxy &&f, const chunk_stream<T> &x) {
+        X result = x0;
+        for_each_chunk(x, [&result, &f](const array1<T> &c) {
+            for (ssize_t i = 0; i < c.size(); ++i)
+                result = f(result, c[i]);
+        });
+        return result;
+    }
+
+    // sum(stream)
+    template<typename T>
+    T sum(const chunk_stream<T> &x) {
+        T result = T(0);
+        for_each_chunk(x, [&result](const array1<T> &c) {
+            for (ssize_t i = 0; i < c.size(); ++i)
+                result += c[i];
+        });
+        return result;
+    }
+
+    // min(stream)
+    template<typename T>
+    T min(const chunk_stream<T> &x) {
+        array1<T> c = x.next();
+        if (c.size() == 0)
+            throw std::runtime_error("min: stream cannot be empty");
+        T result = c[0];
+        do {
+            for (ssize_t i = 0; i < c.size(); ++i)
+                if (c[i] < result)
+                    result = c[i];
+            c = x.next();
+        } while (c.size() > 0);
+        return result;
+    }
+
+    // max(stream)
+    template<typename T>
+    T max(const chunk_stream<T> &x) {
+        array1<T> c = x.next();
+        if (c.size() == 0)
+            throw std::runtime_error("max: stream cannot be empty");
+        T result = c[0];
+        do {
+            for (ssize_t i = 0; i < c.size(); ++i)
+                if (result < c[i])
+                    result = c[i];
+            c = x.next();
+        } while (c.size() > 0);
+        return result;
+    }
+
+    //number of true elements
+    template<typename T>
+    ssize_t count(const chunk_stream<T> &x) {
+        ssize_t result = 0;
+        for_each_chunk(x, [&result](const array1<T> &c) {
+            for (ssize_t i = 0; i < c.size(); ++i)
+                if (c[i])
+                    ++result;
+        });
+        return result;
+    }
+
+    //the rest of the stream in memory, for results known to be small (e.g. where() of rare events)
+    template<typename T>
+    darray1<T> collect(const chunk_stream<T> &x) {
+        darray1<T> result;
+        for_each_chunk(x, [&result](const array1<T> &c) {
+            result.push_back(BEGINEND(c));
+        });
+        return result;
+    }
+
+}
+
+#endif
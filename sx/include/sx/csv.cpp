@@ -0,0 +1,238 @@
+#include "sx/csv.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "sx/char_scan.h"
+#include "sx/parallel.h"
+
+namespace sx {
+
+    namespace detail {
+        bool csv_parse(const char *b, const char *e, double &x) {
+            while (b != e && *b == ' ') ++b;
+            while (e != b && e[-1] == ' ') --e;
+            if (b == e) {
+                x = std::numeric_limits<double>::quiet_NaN();
+                return true;
+            }
+
+            //exact powers of ten representable in a double
+            static const double pow10[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            const char *p = b;
+            bool neg = false;
+            if (*p == '-' || *p == '+') {
+                neg = *p == '-';
+                ++p;
+            }
+            uint64_t m = 0;
+            int digits = 0, exp10 = 0;
+            bool any = false, exact = true;
+            for (; p != e && unsigned(*p - '0') <= 9; ++p) {
+                any = true;
+                if (digits < 19) {
+                    m = m * 10 + unsigned(*p - '0');
+                    if (m != 0) ++digits;
+                } else {
+                    exact = false;
+                }
+            }
+            if (p != e && *p == '.') {
+                ++p;
+                for (; p != e && unsigned(*p - '0') <= 9; ++p) {
+                    any = true;
+                    if (digits < 19) {
+                        m = m * 10 + unsigned(*p - '0');
+                        if (m != 0) ++digits;
+                        --exp10;
+                    } else {
+                        exact = false;
+                    }
+                }
+            }
+            if (any && p != e && (*p == 'e' || *p == 'E')) {
+                ++p;
+                bool eneg = false;
+                if (p != e && (*p == '-' || *p == '+')) {
+                    eneg = *p == '-';
+                    ++p;
+                }
+                if (p == e)
+                    return false;
+                int ev = 0;
+                for (; p != e && unsigned(*p - '0') <= 9; ++p)
+                    if (ev < 100000) ev = ev * 10 + (*p - '0');
+                exp10 += eneg ? -ev : ev;
+            }
+
+            if (any && p == e && exact) {
+                if (m == 0) {
+                    x = neg ? -0.0 : 0.0;
+                    return true;
+                }
+                if (m <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+                    const double d = exp10 < 0 ? double(m) / pow10[-exp10] : double(m) * pow10[exp10];
+                    x = neg ? -d : d;
+                    return true;
+                }
+            }
+
+            //long mantissas, large exponents, inf, nan and syntax errors
+            char buf[128];
+            const size_t n = e - b;
+            if (n >= sizeof(buf))
+                return false;
+            memcpy(buf, b, n);
+            buf[n] = 0;
+            char *end;
+            x = strtod(buf, &end);
+            return end == buf + n;
+        }
+    }
+
+    namespace {
+        //chunks smaller than this are not worth a thread
+        const ssize_t csv_min_chunk_bytes = ssize_t(1) << 20;
+
+        //end of the line content starting at p, without the '\r' before the newline
+        const char *line_content_end(const char *p, const char *newline) {
+            return newline != p && newline[-1] == '\r' ? newline - 1 : newline;
+        }
+    }
+
+    csv_reader::csv_reader(const std::string &path, const csv_options &options)
+            : file_(path, mapped_file::mode::read_only), options_(options), nrows_(0), ncols_(0) {
+        file_.advise(mapped_file::advice::sequential);
+        init(file_.data(), file_.data() + file_.size());
+    }
+
+    csv_reader::csv_reader(const array1<char> &text, const csv_options &options)
+            : options_(options), nrows_(0), ncols_(0) {
+        if (text.stride() != 1 && text.size() > 1)
+            throw std::runtime_error("csv_reader: text must be contiguous");
+        init(text.data(), text.data() + text.size());
+    }
+
+    void csv_reader::init(const char *b, const char *e) {
+        const char delim = options_.delimiter;
+
+        //column names, or the number of fields in the first record
+        if (options_.header) {
+            const char *nl = scan_char(b, e, '\n');
+            const char *le = line_content_end(b, nl);
+            for (const char *p = b;;) {
+                const char *q = scan_char(p, le, delim);
+                names_.emplace_back(p, q);
+                if (q == le)
+                    break;
+                p = q + 1;
+            }
+            ncols_ = names_.size();
+            b = nl == e ? e : nl + 1;
+        } else {
+            for (const char *p = b; p != e;) {
+                const char *nl = scan_char(p, e, '\n');
+                const char *le = line_content_end(p, nl);
+                if (le != p) {
+                    ncols_ = 1;
+                    for (const char *q = scan_char(p, le, delim); q != le; q = scan_char(q + 1, le, delim))
+                        ++ncols_;
+                    break;
+                }
+                p = nl == e ? e : nl + 1;
+            }
+        }
+
+        //split at line boundaries: chunk k starts after the first newline at or after b + size * k / nthreads - 1
+        const ssize_t size = e - b;
+        ssize_t nthreads = options_.nthreads > 0 ? options_.nthreads : default_thread_count();
+        nthreads = std::max<ssize_t>(1, std::min(nthreads, size / csv_min_chunk_bytes));
+        chunk_begin_.push_back(b);
+        for (ssize_t k = 1; k < nthreads; ++k) {
+            const char *target = std::max(b + size * k / nthreads - 1, chunk_begin_.back());
+            const char *nl = scan_char(target, e, '\n');
+            if (nl == e)
+                break;
+            chunk_begin_.push_back(nl + 1);
+        }
+        chunk_begin_.push_back(e);
+
+        //non-empty lines per chunk, then the first row of each chunk
+        const ssize_t nchunks = chunk_begin_.size() - 1;
+        chunk_row_.assign(nchunks + 1, 0);
+        parallel_for_bands(nchunks, 1, [this](ssize_t lo, ssize_t hi) {
+            for (ssize_t k = lo; k < hi; ++k) {
+                const char *p = chunk_begin_[k], *end = chunk_begin_[k + 1];
+                ssize_t n = 0;
+                while (p != end) {
+                    const char *nl = scan_char(p, end, '\n');
+                    if (line_content_end(p, nl) != p)
+                        ++n;
+                    p = nl == end ? end : nl + 1;
+                }
+                chunk_row_[k + 1] = n;
+            }
+        }, nchunks);
+        for (ssize_t k = 0; k < nchunks; ++k)
+            chunk_row_[k + 1] += chunk_row_[k];
+        nrows_ = chunk_row_[nchunks];
+
+        bindings_.assign(ncols_, binding{nullptr, 0, nullptr});
+    }
+
+    ssize_t csv_reader::column(const std::string &name) const {
+        for (ssize_t j = 0; j < (ssize_t) names_.size(); ++j)
+            if (names_[j] == name)
+                return j;
+        throw std::runtime_error("csv_reader: no column named '" + name + "'");
+    }
+
+    void csv_reader::parse(const std::vector<binding> &bindings) const {
+        const ssize_t nchunks = chunk_begin_.size() - 1;
+        parallel_for_bands(nchunks, 1, [this, &bindings](ssize_t lo, ssize_t hi) {
+            for (ssize_t k = lo; k < hi; ++k)
+                parse_chunk(k, bindings);
+        }, nchunks);
+    }
+
+    void csv_reader::parse_chunk(ssize_t k, const std::vector<binding> &bindings) const {
+        const char delim = options_.delimiter;
+        const char *p = chunk_begin_[k], *const end = chunk_begin_[k + 1];
+        for (ssize_t row = chunk_row_[k]; p != end;) {
+            //same notion of empty line as in the counting pass
+            if (*p == '\n') {
+                ++p;
+                continue;
+            }
+            if (*p == '\r' && (p + 1 == end || p[1] == '\n')) {
+                p = p + 1 == end ? end : p + 2;
+                continue;
+            }
+            for (ssize_t col = 0;; ++col) {
+                const char *q = scan_either(p, end, delim, '\n');
+                const bool last = q == end || *q == '\n';
+                const char *fe = last ? line_content_end(p, q) : q;
+                if (col < ncols_) {
+                    const binding &b = bindings[col];
+                    if (b.parse && !b.parse(p, fe, b.base + row * b.stride))
+                        throw std::runtime_error("csv_reader: can't parse '" + std::string(p, fe) + "' in row "
+                                + std::to_string(row) + ", column " + std::to_string(col));
+                }
+                p = q == end ? end : q + 1;
+                if (last) {
+                    if (col + 1 != ncols_)
+                        throw std::runtime_error("csv_reader: row " + std::to_string(row) + " has "
+                                + std::to_string(col + 1) + " fields instead of " + std::to_string(ncols_));
+                    break;
+                }
+            }
+            ++row;
+        }
+    }
+
+}
@@ -0,0 +1,167 @@
+#ifndef CSV_INCLUDED_7730412
+#define CSV_INCLUDED_7730412
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+#include "array1.h"
+#include "array2.h"
+#include "mapped_file.h"
+
+namespace sx {
+
+    struct csv_options {
+        char delimiter;
+        bool header;        //the first line holds the column names
+        ssize_t nthreads;   //0 means default_thread_count()
+
+        csv_options() : delimiter(','), header(false), nthreads(0) {
+        }
+    };
+
+    namespace detail {
+        //parses the whole of [b, e) into x, surrounding spaces are allowed
+        //false on syntax error or if the value doesn't fit in T
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value, bool>::type
+        csv_parse(const char *b, const char *e, T &x) {
+            while (b != e && *b == ' ') ++b;
+            while (e != b && e[-1] == ' ') --e;
+            bool neg = false;
+            if (b != e && (*b == '-' || *b == '+')) {
+                neg = *b == '-';
+                ++b;
+            }
+            if (b == e)
+                return false;
+            const uint64_t limit = neg
+                    ? (std::is_signed<T>::value ? uint64_t(std::numeric_limits<T>::max()) + 1 : 0)
+                    : uint64_t(std::numeric_limits<T>::max());
+            uint64_t v = 0;
+            for (; b != e; ++b) {
+                const unsigned d = unsigned(*b - '0');
+                if (d > 9 || v > limit / 10 || (v == limit / 10 && d > limit % 10))
+                    return false;
+                v = v * 10 + d;
+            }
+            if (neg)
+                x = v == 0 ? T(0) : T(-(long long) (v - 1) - 1);
+            else
+                x = T(v);
+            return true;
+        }
+
+        //empty fields are NaN; up to 19 significant digits and |exponent| <= 22 are converted exactly
+        //without strtod, anything else falls back to it
+        bool csv_parse(const char *b, const char *e, double &x);
+
+        inline bool csv_parse(const char *b, const char *e, float &x) {
+            double d;
+            if (!csv_parse(b, e, d))
+                return false;
+            x = (float) d;
+            return true;
+        }
+    }
+
+    //numeric delimited text, one record per line
+    //the input is split at line boundaries into one chunk per thread; the lines of each chunk are counted first,
+    //so every thread knows its first row and parses its fields straight into the preallocated outputs
+    //there's no quoting: a delimiter or newline always ends a field, a '\r' before the newline is ignored
+    //and empty lines are skipped
+    class csv_reader {
+    public:
+        explicit csv_reader(const std::string &path, const csv_options &options = csv_options());
+
+        //text must be contiguous and outlive the reader
+        explicit csv_reader(const array1<char> &text, const csv_options &options = csv_options());
+
+        ssize_t nrows() const {
+            return nrows_;
+        }
+
+        //from the header if there's one, from the first record otherwise
+        ssize_t ncols() const {
+            return ncols_;
+        }
+
+        //empty without a header
+        const std::vector<std::string> &column_names() const {
+            return names_;
+        }
+
+        //throws if there's no such column
+        ssize_t column(const std::string &name) const;
+
+        //resizes out to nrows(), read() fills it
+        template<typename T>
+        void bind(ssize_t col, darray1<T> &out) {
+            static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                    "csv_reader::bind: numeric element type expected");
+            if (col < 0 || col >= ncols_)
+                throw std::runtime_error("csv_reader::bind: column index out of range");
+            out.resize(nrows_);
+            bindings_[col] = binding{reinterpret_cast<char *>(out.data()), (ssize_t) sizeof(T), &parse_field<T>};
+        }
+
+        template<typename T>
+        void bind(const std::string &name, darray1<T> &out) {
+            bind(column(name), out);
+        }
+
+        //parses the bound columns, the others are only scanned over
+        void read() const {
+            parse(bindings_);
+        }
+
+        //all columns into an nrows() x ncols() matrix, the bindings are ignored
+        template<typename T>
+        darray2<T> read_matrix() const {
+            static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                    "csv_reader::read_matrix: numeric element type expected");
+            darray2<T> result(nrows_, ncols_);
+            std::vector<binding> b(ncols_);
+            for (ssize_t j = 0; j < ncols_; ++j)
+                b[j] = binding{reinterpret_cast<char *>(result.data() + j), ncols_ * (ssize_t) sizeof(T), &parse_field<T>};
+            parse(b);
+            return result;
+        }
+
+    private:
+        typedef bool (*parse_function)(const char *b, const char *e, void *dst);
+
+        //field of row r goes to base + r * stride, unbound columns have no parse function
+        struct binding {
+            char *base;
+            ssize_t stride;
+            parse_function parse;
+        };
+
+        template<typename T>
+        static bool parse_field(const char *b, const char *e, void *dst) {
+            return detail::csv_parse(b, e, *static_cast<T *>(dst));
+        }
+
+        void init(const char *b, const char *e);
+
+        void parse(const std::vector<binding> &bindings) const;
+
+        void parse_chunk(ssize_t k, const std::vector<binding> &bindings) const;
+
+        mapped_file file_;
+        csv_options options_;
+        ssize_t nrows_, ncols_;
+        std::vector<std::string> names_;
+        std::vector<const char *> chunk_begin_; //chunk k is [chunk_begin_[k], chunk_begin_[k + 1])
+        std::vector<ssize_t> chunk_row_;        //first row of each chunk
+        std::vector<binding> bindings_;
+    };
+
+}
+
+#endif
@@ -1,7 +1,14 @@
 #include "sx/dynamic_bitset.h"
 
+#include <climits>
+#include <type_traits>
+
+#include "sx/kernels.h"
+
 namespace sx {
 
+    static_assert(std::is_same<dynamic_bitset::block_type, uint64_t>::value, "the bitset kernels work on uint64_t blocks");
+
     const dynamic_bitset::block_width_type
         dynamic_bitset::bits_per_block;
 
@@ -21,23 +28,23 @@ namespace sx {
     // constructors, etc.
 
 
-    dynamic_bitset::dynamic_bitset()
-        : m_num_bits(0)
+    dynamic_bitset::dynamic_bitset(const allocator_type& alloc)
+        : m_bits(alloc), m_num_bits(0)
     {
 
     }
 
 
     dynamic_bitset::
-        dynamic_bitset(size_type num_bits, unsigned long value)
-        : m_num_bits(0)
+        dynamic_bitset(size_type num_bits, unsigned long value, const allocator_type& alloc)
+        : m_bits(alloc), m_num_bits(0)
     {
         init_from_unsigned_long(num_bits, value);
     }
 
     // copy constructor
 
-    inline dynamic_bitset::
+    dynamic_bitset::
         dynamic_bitset(const dynamic_bitset& b)
         : m_bits(b.m_bits), m_num_bits(b.m_num_bits)
     {
@@ -45,8 +52,8 @@ namespace sx {
     }
 
     dynamic_bitset::
-        dynamic_bitset(std::initializer_list<bool> il)
-        : m_bits(calc_num_blocks(il.size()), 0), m_num_bits(il.size())
+        dynamic_bitset(std::initializer_list<bool> il, const allocator_type& alloc)
+        : m_bits(calc_num_blocks(il.size()), 0, alloc), m_num_bits(il.size())
     {
         size_type counter = 0;
         for (auto b : il)
@@ -56,7 +63,7 @@ namespace sx {
         }
     }
 
-    inline dynamic_bitset::
+    dynamic_bitset::
         ~dynamic_bitset()
     {
         assert(m_check_invariants());
@@ -80,7 +87,7 @@ namespace sx {
     }
 
 
-    inline dynamic_bitset::
+    dynamic_bitset::
         dynamic_bitset(dynamic_bitset&& b) noexcept
         : m_bits(std::move(b.m_bits)), m_num_bits(std::move(b.m_num_bits))
     {
@@ -90,7 +97,7 @@ namespace sx {
     }
 
 
-    inline dynamic_bitset& dynamic_bitset::
+    dynamic_bitset& dynamic_bitset::
         operator=(dynamic_bitset&& b) noexcept
     {
         if (std::addressof(b) == this) { return *this; }
@@ -197,8 +204,7 @@ namespace sx {
         dynamic_bitset::operator&=(const dynamic_bitset& rhs)
     {
         assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            m_bits[i] &= rhs.m_bits[i];
+        detail::kernels().and_blocks(m_bits.data(), rhs.m_bits.data(), num_blocks());
         return *this;
     }
 
@@ -207,8 +213,7 @@ namespace sx {
         dynamic_bitset::operator|=(const dynamic_bitset& rhs)
     {
         assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            m_bits[i] |= rhs.m_bits[i];
+        detail::kernels().or_blocks(m_bits.data(), rhs.m_bits.data(), num_blocks());
         //m_zero_unused_bits();
         return *this;
     }
@@ -218,8 +223,7 @@ namespace sx {
         dynamic_bitset::operator^=(const dynamic_bitset& rhs)
     {
         assert(size() == rhs.size());
-        for (size_type i = 0; i < this->num_blocks(); ++i)
-            m_bits[i] ^= rhs.m_bits[i];
+        detail::kernels().xor_blocks(m_bits.data(), rhs.m_bits.data(), num_blocks());
         //m_zero_unused_bits();
         return *this;
     }
@@ -229,8 +233,7 @@ namespace sx {
         dynamic_bitset::operator-=(const dynamic_bitset& rhs)
     {
         assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            m_bits[i] &= ~rhs.m_bits[i];
+        detail::kernels().andnot_blocks(m_bits.data(), rhs.m_bits.data(), num_blocks());
         //m_zero_unused_bits();
         return *this;
     }
@@ -476,7 +479,7 @@ namespace sx {
     }
 
 
-    inline bool dynamic_bitset::none() const
+    bool dynamic_bitset::none() const
     {
         return !any();
     }
@@ -494,54 +497,38 @@ namespace sx {
     dynamic_bitset::size_type
         dynamic_bitset::count() const noexcept
     {
-        using detail::dynamic_bitset_impl::table_width;
-        using detail::dynamic_bitset_impl::access_by_bytes;
-        using detail::dynamic_bitset_impl::access_by_blocks;
-        using detail::dynamic_bitset_impl::value_to_type;
-
-        // NOTE: Explicitly qualifying "bits_per_block" to workaround
-        //       regressions of gcc 3.4.x
-        enum {
-            no_padding =
-            dynamic_bitset::bits_per_block
-            == CHAR_BIT * sizeof(Block)
-        };
-
-        enum { enough_table_width = table_width >= CHAR_BIT };
-
-        enum {
-            mode = (no_padding && enough_table_width)
-            ? access_by_bytes
-            : access_by_blocks
-        };
-
-        return do_count(m_bits.begin(), num_blocks(), Block(0),
-            static_cast<value_to_type<(bool)mode> *>(0));
+        return size_type(detail::kernels().popcount(m_bits.data(), num_blocks()));
     }
 
 
         //-----------------------------------------------------------------------------
         // conversions
 
-        inline dynamic_bitset::size_type
+        dynamic_bitset::size_type
         dynamic_bitset::size() const noexcept
     {
         return m_num_bits;
     }
 
 
-        inline dynamic_bitset::size_type
+        dynamic_bitset::size_type
         dynamic_bitset::num_blocks() const noexcept
     {
         return m_bits.size();
     }
 
-        inline bool dynamic_bitset::empty() const noexcept
+        bool dynamic_bitset::empty() const noexcept
     {
         return size() == 0;
     }
 
 
+        dynamic_bitset::allocator_type dynamic_bitset::get_allocator() const
+    {
+        return m_bits.get_allocator();
+    }
+
+
         bool dynamic_bitset::
         is_subset_of(const dynamic_bitset& a) const
     {
@@ -656,7 +643,7 @@ namespace sx {
     }
 
 
-    inline bool operator!=(const dynamic_bitset& a,
+    bool operator!=(const dynamic_bitset& a,
         const dynamic_bitset& b)
     {
         return !(a == b);
@@ -686,21 +673,21 @@ namespace sx {
     }
 
 
-    inline bool operator<=(const dynamic_bitset& a,
+    bool operator<=(const dynamic_bitset& a,
         const dynamic_bitset& b)
     {
         return !(a > b);
     }
 
 
-    inline bool operator>(const dynamic_bitset& a,
+    bool operator>(const dynamic_bitset& a,
         const dynamic_bitset& b)
     {
         return b < a;
     }
 
 
-    inline bool operator>=(const dynamic_bitset& a,
+    bool operator>=(const dynamic_bitset& a,
         const dynamic_bitset& b)
     {
         return !(a < b);
@@ -763,7 +750,7 @@ namespace sx {
 
 
 
-    inline dynamic_bitset::size_type
+    dynamic_bitset::size_type
         dynamic_bitset::calc_num_blocks(size_type num_bits)
     {
         return num_bits / bits_per_block
@@ -773,7 +760,7 @@ namespace sx {
     // gives a reference to the highest block
     //
 
-    inline dynamic_bitset::Block& dynamic_bitset::m_highest_block()
+    dynamic_bitset::Block& dynamic_bitset::m_highest_block()
     {
         return const_cast<Block &>
             (static_cast<const dynamic_bitset *>(this)->m_highest_block());
@@ -782,7 +769,7 @@ namespace sx {
     // gives a const-reference to the highest block
     //
 
-    inline const dynamic_bitset::Block& dynamic_bitset::m_highest_block() const
+    const dynamic_bitset::Block& dynamic_bitset::m_highest_block() const
     {
         assert(size() > 0 && num_blocks() > 0);
         return m_bits.back();
@@ -795,7 +782,7 @@ namespace sx {
     // for the implementation of many member functions)
     //
 
-    inline void dynamic_bitset::m_zero_unused_bits()
+    void dynamic_bitset::m_zero_unused_bits()
     {
         assert(num_blocks() == calc_num_blocks(m_num_bits));
 
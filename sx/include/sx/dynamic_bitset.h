@@ -17,6 +17,7 @@
 #ifndef STDAUX_DYNAMIC_BITSET_INCLUDED
 #define STDAUX_DYNAMIC_BITSET_INCLUDED
 
+#include <algorithm>
 #include <vector>
 #include <cstdint>
 #include <limits>
@@ -24,6 +25,7 @@
 #include <utility>
 #include <initializer_list>
 
+#include "sx/memory_resource.h"
 #include "sx/dynamic_bitset/dynamic_bitset_impl.h"
 #include "sx/integer/lowest_bit.h"
 
@@ -36,10 +38,11 @@ namespace sx {
 class dynamic_bitset
 {
     typedef uint64_t Block; //this was template par
-    typedef std::vector<Block> buffer_type;
+    typedef std::vector<Block, polymorphic_allocator<Block>> buffer_type; //so was the allocator, see memory_resource.h
 
 public:
     typedef Block block_type;
+    typedef polymorphic_allocator<Block> allocator_type;
     typedef std::size_t size_type;
     typedef buffer_type::size_type block_width_type;
 
@@ -96,14 +99,17 @@ public:
     typedef bool const_reference;
 
     // constructors, etc.
+    // the blocks come from alloc, default_resource() unless given, copies allocate from the resource of their source
     explicit
-    dynamic_bitset();
+    dynamic_bitset(const allocator_type& alloc = allocator_type());
 
     explicit
-    dynamic_bitset(size_type num_bits, unsigned long value = 0);
+    dynamic_bitset(size_type num_bits, unsigned long value = 0,
+                   const allocator_type& alloc = allocator_type());
 
     explicit
-    dynamic_bitset(std::initializer_list<bool> il);
+    dynamic_bitset(std::initializer_list<bool> il,
+                   const allocator_type& alloc = allocator_type());
 
     // copy constructor
     dynamic_bitset(const dynamic_bitset& b);
@@ -159,6 +165,7 @@ public:
     size_type num_blocks() const noexcept;
     size_type max_size() const noexcept;
     bool empty() const noexcept;
+    allocator_type get_allocator() const;
 
     bool is_subset_of(const dynamic_bitset& a) const;
     bool is_proper_subset_of(const dynamic_bitset& a) const;
@@ -179,11 +186,11 @@ public:
                           const dynamic_bitset& b);
 
 
-    template <typename B, typename A, typename BlockOutputIterator>
+    template <typename BlockOutputIterator>
     friend void to_block_range(const dynamic_bitset& b,
                                BlockOutputIterator result);
 
-    template <typename BlockIterator, typename B, typename A>
+    template <typename BlockIterator>
     friend void from_block_range(BlockIterator first, BlockIterator last,
                                  dynamic_bitset& result);
 
@@ -197,8 +204,7 @@ public:
 
 
     void init_from_unsigned_long(size_type num_bits,
-        unsigned long value/*,
-                           const Allocator& alloc*/)
+        unsigned long value)
     {
 
         assert(m_bits.size() == 0);
@@ -354,6 +360,29 @@ operator-(const dynamic_bitset& b1,
 void swap(dynamic_bitset& b1,
           dynamic_bitset& b2);
 
+// block range conversions
+
+// copies the num_blocks() blocks of b to result, bit 0 is the lowest bit of the first block
+template <typename BlockOutputIterator>
+void to_block_range(const dynamic_bitset& b, BlockOutputIterator result)
+{
+    std::copy(b.m_bits.begin(), b.m_bits.end(), result);
+}
+
+// overwrites the lowest blocks of result with [first, last); result must be large enough,
+// bits beyond result.size() are dropped
+template <typename BlockIterator>
+void from_block_range(BlockIterator first, BlockIterator last,
+                      dynamic_bitset& result)
+{
+    typedef dynamic_bitset::size_type size_type;
+    size_type i = 0;
+    for (; first != last; ++first, ++i) {
+        assert(i < result.num_blocks());
+        result.m_bits[i] = *first;
+    }
+    result.m_zero_unused_bits();
+}
 
 
 
@@ -4,21 +4,76 @@
 #include "array1.h"
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
 #include <numeric>
 #include "macros.h"
 #include "sx/proxy_iota.h"
+#include "sx/trace.h"
+#include "sx/kernels.h"
 #include "array1.h"
 
 namespace sx {
+    namespace detail {
+        //the elements if they are contiguous, nullptr otherwise
+        template<typename E>
+        const typename E::value_type *contiguous_data(const E &) {
+            return nullptr;
+        }
+
+        template<typename T, bool Mutable>
+        const typename array1<T, Mutable>::value_type *contiguous_data(const array1<T, Mutable> &x) {
+            return x.stride() == 1 || x.size() <= 1 ? x.data() : nullptr;
+        }
+
+        template<typename T, typename Alloc>
+        const T *contiguous_data(const darray1<T, Alloc> &x) {
+            return x.data();
+        }
+
+        template<typename T, ssize_t N, typename Alloc>
+        const T *contiguous_data(const small_darray1<T, N, Alloc> &x) {
+            return x.data();
+        }
+
+        template<typename T, typename Alloc>
+        const T *contiguous_data(const std::vector<T, Alloc> &x) {
+            return x.data();
+        }
+
+        //has_kernels<value_type> of both, as a type for tag dispatch
+        template<typename E1, typename E2>
+        using same_kernel_type = std::integral_constant<bool,
+                std::is_same<typename E1::value_type, typename E2::value_type>::value && has_kernels<typename E1::value_type>::value>;
+
+        template<typename E1, typename E2>
+        bool equal_impl(const E1 &e1, const E2 &e2, std::false_type) {
+            for (auto i: IOTA e1.size()) if (e1[i] != e2[i]) return false;
+            return true;
+        }
+
+        template<typename E1, typename E2>
+        bool equal_impl(const E1 &e1, const E2 &e2, std::true_type) {
+            const auto *p1 = contiguous_data(e1);
+            const auto *p2 = contiguous_data(e2);
+            if (p1 && p2)
+                return kernels_for<typename E1::value_type>().equal(p1, p2, e1.size());
+            return equal_impl(e1, e2, std::false_type());
+        }
+    }
+
+    //where, grade_up, grade_down, cut and horzcat allocate their results with Alloc, e.g. where<scratch_allocator>(x)
+    //takes the result from the scratch arena inside a scratch_scope, see scratch_allocator.h
+
     // where
-    template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
-    darray1<ssize_t> where(const E &e) {
+    template<template<typename> class Alloc = allocator, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+    darray1<ssize_t, Alloc<ssize_t>> where(const E &e) {
         const ssize_t N = e.size();
+        SX_TRACE_OP("where", N, N * sizeof(typename E::value_type));
         ssize_t count = 0;
         for (ssize_t i = 0; i < N; ++i)
             if (e[i])
                 ++count;
-        darray1<ssize_t> result;
+        darray1<ssize_t, Alloc<ssize_t>> result;
         result.reserve(count);
         for (ssize_t i = 0; i < N; ++i)
             if (e[i])
@@ -30,17 +85,21 @@ namespace sx {
     template<typename E1, typename E2, typename std::enable_if<container_traits<E1>::indexable && container_traits<E2>::indexable>::type * = nullptr>
     bool operator==(const E1 &e1, const E2 &e2) {
         const ssize_t N = e1.size();
+        SX_TRACE_OP("operator==", N, N * (sizeof(typename E1::value_type) + sizeof(typename E2::value_type)));
         if (N != e2.size())return false;
 
-        for (auto i: IOTA N) if (e1[i] != e2[i]) return false;
-
-        return true;
+        return detail::equal_impl(e1, e2, detail::same_kernel_type<E1, E2>());
     }
 
     // op+(list, list)
-    template<typename E1, typename E2, typename std::enable_if<container_traits<E1>::indexable && container_traits<E2>::indexable>::type * = nullptr>
+    //2D operands are handled by the broadcasting ops in broadcast.h
+    template<typename E1, typename E2, typename std::enable_if<
+            container_traits<E1>::indexable && container_traits<E2>::indexable &&
+                    !container_traits<E1>::two_dimensional && !container_traits<E2>::two_dimensional
+    >::type * = nullptr>
     darray1<decltype(std::declval<typename E1::value_type>() + std::declval<typename E1::value_type>())> operator+(const E1 &e1, const E2 &e2) {
         const ssize_t N = e1.size();
+        SX_TRACE_OP("operator+", N, 3 * N * sizeof(typename E1::value_type));
         if (N != e2.size()) throw std::runtime_error("op+(list,list) different sizes");
         darray1<decltype(std::declval<typename E1::value_type>() + std::declval<typename E1::value_type>())> r(N);
 
@@ -50,9 +109,12 @@ namespace sx {
     }
 
     // op*(list, atom)
-    template<typename E1, typename T2, typename std::enable_if<container_traits<E1>::indexable && !container_traits<T2>::indexable>::type * = nullptr>
+    template<typename E1, typename T2, typename std::enable_if<
+            container_traits<E1>::indexable && !container_traits<E1>::two_dimensional && !container_traits<T2>::indexable
+    >::type * = nullptr>
     darray1<decltype(std::declval<typename E1::value_type>() * std::declval<T2>())> operator*(const E1 &e1, const T2 &t2) {
         const ssize_t N = e1.size();
+        SX_TRACE_OP("operator*", N, 2 * N * sizeof(typename E1::value_type));
 
         darray1<decltype(std::declval<typename E1::value_type>() * std::declval<T2>())> r(N);
 
@@ -62,9 +124,12 @@ namespace sx {
     }
 
     // op/(list, atom)
-    template<typename E1, typename T2, typename std::enable_if<container_traits<E1>::indexable && !container_traits<T2>::indexable>::type * = nullptr>
+    template<typename E1, typename T2, typename std::enable_if<
+            container_traits<E1>::indexable && !container_traits<E1>::two_dimensional && !container_traits<T2>::indexable
+    >::type * = nullptr>
     darray1<decltype(std::declval<typename E1::value_type>() / std::declval<T2>())> operator/(const E1 &e1, const T2 &t2) {
         const ssize_t N = e1.size();
+        SX_TRACE_OP("operator/", N, 2 * N * sizeof(typename E1::value_type));
 
         darray1<decltype(std::declval<typename E1::value_type>() / std::declval<T2>())> r(N);
 
@@ -77,6 +142,7 @@ namespace sx {
     template<typename E1, typename T2, typename std::enable_if<container_traits<E1>::indexable && !container_traits<T2>::indexable>::type * = nullptr>
     darray1<bool> operator==(const E1 &e1, const T2 &t2) {
         const ssize_t N = e1.size();
+        SX_TRACE_OP("operator==", N, N * (sizeof(typename E1::value_type) + sizeof(bool)));
 
         darray1<bool> result(N);
         for (ssize_t i = 0; i < N; ++i)
@@ -92,16 +158,19 @@ namespace sx {
     }
 
     // horzcat(list, atom)
-    template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
-    darray1<typename E::value_type> horzcat(const E &e, const typename E::value_type &t) {
-        darray1<typename E::value_type> result(BEGINEND(e));
+    template<template<typename> class Alloc = allocator, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+    darray1<typename E::value_type, Alloc<typename E::value_type>> horzcat(const E &e, const typename E::value_type &t) {
+        SX_TRACE_OP("horzcat", e.size() + 1, 2 * e.size() * sizeof(typename E::value_type));
+        darray1<typename E::value_type, Alloc<typename E::value_type>> result(BEGINEND(e));
         result.push_back(t);
+        return result;
     }
 
     // horzcat(atom, list)
-    template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
-    darray1<typename E::value_type> horzcat(const typename E::value_type &t, const E &e) {
-        darray1<typename E::value_type> result;
+    template<template<typename> class Alloc = allocator, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+    darray1<typename E::value_type, Alloc<typename E::value_type>> horzcat(const typename E::value_type &t, const E &e) {
+        SX_TRACE_OP("horzcat", e.size() + 1, 2 * e.size() * sizeof(typename E::value_type));
+        darray1<typename E::value_type, Alloc<typename E::value_type>> result;
         result.reserve(e.size() + 1);
         result.push_back(t);
         result.push_back(BEGINEND(e));
@@ -109,10 +178,11 @@ namespace sx {
     }
 
     // grade_down(list)
-    template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
-    darray1<typename E::size_type> grade_down(const E &e) {
+    template<template<typename> class Alloc = allocator, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+    darray1<typename E::size_type, Alloc<typename E::size_type>> grade_down(const E &e) {
+        SX_TRACE_OP("grade_down", e.size(), e.size() * (sizeof(typename E::value_type) + sizeof(typename E::size_type)));
         typedef typename E::size_type e_size_type;
-        darray1<typename E::size_type> result;
+        darray1<typename E::size_type, Alloc<typename E::size_type>> result;
         result.reserve(e.size());
         for (auto i:iota(e.size()))
             result.push_back(i);
@@ -123,10 +193,11 @@ namespace sx {
     }
 
     // grade_down(list)
-    template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
-    darray1<typename E::size_type> grade_up(const E &e) {
+    template<template<typename> class Alloc = allocator, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+    darray1<typename E::size_type, Alloc<typename E::size_type>> grade_up(const E &e) {
+        SX_TRACE_OP("grade_up", e.size(), e.size() * (sizeof(typename E::value_type) + sizeof(typename E::size_type)));
         typedef typename E::size_type e_size_type;
-        darray1<typename E::size_type> result;
+        darray1<typename E::size_type, Alloc<typename E::size_type>> result;
         result.reserve(e.size());
         for (auto i : iota(e.size()))
             result.push_back(i);
@@ -151,14 +222,15 @@ namespace sx {
     };
 
     // return function object drop(n, list) with n bound
-    drop_bound1st drop(ssize_t x) {
+    inline drop_bound1st drop(ssize_t x) {
         return drop_bound1st(x);
     }
 
     // cut(idxlist, list)
-    template<typename E1, typename E2, typename std::enable_if<container_traits<E1>::indexable && container_traits<E2>::indexable>::type * = nullptr>
-    sx::darray1<sx::array1<typename E2::value_type>> cut(const E1 &idcs, const E2 &y) {
-        darray1<array1<typename E2::value_type>> result;
+    template<template<typename> class Alloc = allocator, typename E1, typename E2, typename std::enable_if<container_traits<E1>::indexable && container_traits<E2>::indexable>::type * = nullptr>
+    sx::darray1<sx::array1<typename E2::value_type>, Alloc<sx::array1<typename E2::value_type>>> cut(const E1 &idcs, const E2 &y) {
+        SX_TRACE_OP("cut", idcs.size(), idcs.size() * (sizeof(typename E1::value_type) + sizeof(array1<typename E2::value_type>)));
+        darray1<array1<typename E2::value_type>, Alloc<array1<typename E2::value_type>>> result;
         const ssize_t N = idcs.size();
         result.reserve(N);
         for (ssize_t i = 0; i < N; ++i) {
@@ -169,10 +241,44 @@ namespace sx {
         return result;
     }
 
+    namespace detail {
+        template<typename E1, typename E2, typename R>
+        void gather_impl(const E1 &x, const E2 &idcs, R &result, std::false_type) {
+            for (auto i : IOTA idcs.size()) result[i] = x[idcs[i]];
+        }
+
+        template<typename E1, typename E2, typename R>
+        void gather_impl(const E1 &x, const E2 &idcs, R &result, std::true_type) {
+            const auto *p = contiguous_data(x);
+            const auto *q = contiguous_data(idcs);
+            if (p && q)
+                kernels_for<typename E1::value_type>().gather(p, q, idcs.size(), result.data());
+            else
+                gather_impl(x, idcs, result, std::false_type());
+        }
+    }
+
+    // gather(list, idxlist)
+    //index_at(list, idxlist) copied into a new list
+    template<typename E1, typename E2, typename std::enable_if<
+            container_traits<E1>::indexable && container_traits<E2>::indexable &&
+                    std::is_integral<typename E2::value_type>::value
+    >::type * = nullptr>
+    darray1<typename E1::value_type> gather(const E1 &x, const E2 &idcs) {
+        const ssize_t N = idcs.size();
+        SX_TRACE_OP("gather", N, N * (2 * sizeof(typename E1::value_type) + sizeof(typename E2::value_type)));
+        darray1<typename E1::value_type> result(N);
+        detail::gather_impl(x, idcs, result, std::integral_constant<bool,
+                detail::has_kernels<typename E1::value_type>::value && std::is_same<typename E2::value_type, ssize_t>::value>());
+        return result;
+    }
+
     // each(Fx, list)
     template<typename UnaryPr, typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
     darray1<typename std::result_of<UnaryPr(typename E::const_reference)>::type> each(UnaryPr &&fun, const E &x) {
         const ssize_t N = x.size();
+        SX_TRACE_OP("each", N, N * (sizeof(typename E::value_type) +
+                sizeof(typename std::result_of<UnaryPr(typename E::const_reference)>::type)));
         darray1<typename std::result_of<UnaryPr(typename E::const_reference)>::type> result;
         result.reserve(N);
         for (ssize_t i = 0; i < N; ++i)
@@ -183,6 +289,7 @@ namespace sx {
     // over(atom, Fxy, list)
     template<typename X, typename Fxy, typename V>
     X over(const X &x0, const Fxy &&f, const V &v) {
+        SX_TRACE_OP("over", v.size(), v.size() * sizeof(typename V::value_type));
         auto result = x0;
         for (auto &&x: v) {
             result = f(result, x);
@@ -193,6 +300,7 @@ namespace sx {
     // over(Fxy, list)
     template<typename Fxy, typename V>
     int over(const Fxy &&f, const V &v) {
+        SX_TRACE_OP("over", v.size(), v.size() * sizeof(typename V::value_type));
         if (v.size() == 0) {
             throw std::runtime_error("over: input cannot be empty");
         } else {
@@ -206,28 +314,73 @@ namespace sx {
         }
     }
 
+    namespace detail {
+        template<typename V>
+        typename V::value_type sum_impl(const V &v, std::false_type) {
+            return std::accumulate(BEGINEND(v), typename V::value_type(0));
+        }
+
+        template<typename V>
+        typename V::value_type sum_impl(const V &v, std::true_type) {
+            if (const auto *p = contiguous_data(v))
+                return kernels_for<typename V::value_type>().sum(p, v.size());
+            return sum_impl(v, std::false_type());
+        }
+
+        template<typename V>
+        typename V::const_reference min_impl(const V &v, std::false_type) {
+            return *std::min_element(BEGINEND(v));
+        }
+
+        template<typename V>
+        typename V::const_reference min_impl(const V &v, std::true_type) {
+            const auto *p = contiguous_data(v);
+            if (p && v.size() > 0)
+                return p[kernels_for<typename V::value_type>().argmin(p, v.size())];
+            return min_impl(v, std::false_type());
+        }
+
+        template<typename V>
+        typename V::const_reference max_impl(const V &v, std::false_type) {
+            return *std::max_element(BEGINEND(v));
+        }
+
+        template<typename V>
+        typename V::const_reference max_impl(const V &v, std::true_type) {
+            const auto *p = contiguous_data(v);
+            if (p && v.size() > 0)
+                return p[kernels_for<typename V::value_type>().argmax(p, v.size())];
+            return max_impl(v, std::false_type());
+        }
+    }
+
     // sum(list)
+    //contiguous double, float, int32_t and int64_t lists are summed by the kernels of kernels.h
     template<typename V>
     typename V::value_type sum(const V &v) {
-        return std::accumulate(BEGINEND(v), typename V::value_type(0));
+        SX_TRACE_OP("sum", v.size(), v.size() * sizeof(typename V::value_type));
+        return detail::sum_impl(v, detail::has_kernels<typename V::value_type>());
     }
 
     // prod(list)
     template<typename V>
     typename V::value_type prod(const V &v) {
+        SX_TRACE_OP("prod", v.size(), v.size() * sizeof(typename V::value_type));
         return std::accumulate(BEGINEND(v), typename V::value_type(1));
     }
 
     //min list
     template<typename V>
     typename V::const_reference min(const V &v) {
-        return *std::min_element(BEGINEND(v));
+        SX_TRACE_OP("min", v.size(), v.size() * sizeof(typename V::value_type));
+        return detail::min_impl(v, detail::has_kernels<typename V::value_type>());
     }
 
     //max list
     template<typename V>
     typename V::const_reference max(const V &v) {
-        return *std::max_element(BEGINEND(v));
+        SX_TRACE_OP("max", v.size(), v.size() * sizeof(typename V::value_type));
+        return detail::max_impl(v, detail::has_kernels<typename V::value_type>());
     }
 
 
@@ -243,6 +396,7 @@ namespace sx {
         //op=(atom)
         template<typename T, typename std::enable_if<!container_traits<T>::indexable>::type * = nullptr>
         const this_type &operator=(const T &t) const {
+            SX_TRACE_OP("at=", e.size(), e.size() * sizeof(typename E::value_type));
             for (auto i : iota(e.size())) e[i] = t;
             return *this;
         }
@@ -250,6 +404,7 @@ namespace sx {
         //op=(indexable)
         template<typename T, typename std::enable_if<container_traits<T>::indexable>::type * = nullptr>
         const this_type &operator=(const T &x) const {
+            SX_TRACE_OP("at=", e.size(), 2 * e.size() * sizeof(typename E::value_type));
             if (e.size() != x.size()) throw std::runtime_error("at::op= different sizes");
             for (auto i : iota(e.size())) e[i] = x[i];
             return *this;
@@ -280,6 +435,7 @@ namespace sx {
     //should accept only iterable, one dimensional containers (vector<vector<>> is okay, dmat is not)
     template<typename C>
     typename C::value_type norm(const C &v) {
+        SX_TRACE_OP("norm", v.size(), v.size() * sizeof(typename C::value_type));
         typename C::value_type sum = 0;
         for (auto &x:v) sum += x * x;
         return sqrt(sum);
@@ -0,0 +1,113 @@
+#include "sx/huge_page_allocator.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "sx/parallel.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace sx {
+
+    namespace {
+        size_t round_up(size_t n, size_t m) {
+            return (n + m - 1) / m * m;
+        }
+
+#ifndef _WIN32
+        //cleared after the first failed MAP_HUGETLB, the pool is usually empty unless configured
+        std::atomic<bool> try_hugetlb(true);
+
+        void *map_hugetlb(size_t len) {
+#ifdef MAP_HUGETLB
+            if (!try_hugetlb.load(std::memory_order_relaxed))
+                return nullptr;
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+            flags |= MAP_HUGE_2MB;
+#endif
+            void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (p != MAP_FAILED)
+                return p;
+            try_hugetlb.store(false, std::memory_order_relaxed);
+#endif
+            (void) len;
+            return nullptr;
+        }
+
+        //maps len + huge_page_size and unmaps the unaligned head and the tail,
+        //transparent huge pages can only back whole aligned huge pages
+        void *map_aligned(size_t len) {
+            const size_t hp = huge_page_size;
+            void *p = mmap(nullptr, len + hp, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return nullptr;
+            char *const base = static_cast<char *>(p);
+            char *const aligned = reinterpret_cast<char *>(round_up(reinterpret_cast<uintptr_t>(base), hp));
+            if (aligned != base)
+                munmap(base, aligned - base);
+            munmap(aligned + len, base + hp - aligned);
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+            return aligned;
+        }
+#endif
+    }
+
+    void first_touch(void *p, ssize_t nbytes, ssize_t nthreads) {
+        if (!p || nbytes <= 0)
+            return;
+#ifndef _WIN32
+        const ssize_t page = sysconf(_SC_PAGESIZE);
+#else
+        const ssize_t page = 4096;
+#endif
+        char *const base = static_cast<char *>(p);
+        const ssize_t npages = (nbytes + page - 1) / page;
+        //a band of at least one huge page, smaller ones aren't worth a thread
+        parallel_for_bands(npages, std::max<ssize_t>(1, huge_page_size / page), [base, page](ssize_t lo, ssize_t hi) {
+            for (ssize_t i = lo; i < hi; ++i)
+                *static_cast<volatile char *>(base + i * page) = 0;
+        }, nthreads);
+    }
+
+    namespace detail {
+
+        void *huge_page_allocate(size_t nbytes, ssize_t nthreads) {
+            if (nbytes == 0)
+                return nullptr;
+#ifndef _WIN32
+            if (nbytes >= (size_t) huge_page_size) {
+                const size_t len = round_up(nbytes, huge_page_size);
+                void *p = map_hugetlb(len);
+                if (!p)
+                    p = map_aligned(len);
+                if (!p)
+                    throw std::bad_alloc();
+                first_touch(p, len, nthreads);
+                return p;
+            }
+#endif
+            (void) nthreads;
+            return ::operator new(nbytes);
+        }
+
+        void huge_page_deallocate(void *p, size_t nbytes) {
+            if (!p)
+                return;
+#ifndef _WIN32
+            if (nbytes >= (size_t) huge_page_size) {
+                munmap(p, round_up(nbytes, huge_page_size));
+                return;
+            }
+#endif
+            ::operator delete(p);
+        }
+
+    }
+
+}
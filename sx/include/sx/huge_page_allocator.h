@@ -0,0 +1,90 @@
+#ifndef HUGE_PAGE_ALLOCATOR_INCLUDED_5630182
+#define HUGE_PAGE_ALLOCATOR_INCLUDED_5630182
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#include "types.h"
+#include "allocator.h"
+#include "array1.h"
+#include "array2.h"
+
+namespace sx {
+
+    //allocations of at least this many bytes are mapped directly, in multiples of it
+    const ssize_t huge_page_size = ssize_t(1) << 21;
+
+    //touches every page of [p, p + nbytes) from the threads of parallel_for_bands(..., nthreads), band by band,
+    //so under the kernel's default first-touch policy each band is placed on the NUMA node of the thread
+    //that also gets that band when a parallel kernel splits the array the same way
+    void first_touch(void *p, ssize_t nbytes, ssize_t nthreads = 0);
+
+    namespace detail {
+        //nbytes >= huge_page_size: anonymous mapping aligned to huge_page_size, explicit huge pages (MAP_HUGETLB)
+        //if the system has them reserved, transparent huge pages (madvise) otherwise, first touched in parallel
+        //smaller sizes: operator new
+        void *huge_page_allocate(size_t nbytes, ssize_t nthreads);
+
+        void huge_page_deallocate(void *p, size_t nbytes);
+    }
+
+    //allocator for large buffers: huge pages to cut TLB misses, NUMA placement by parallel first touch
+    //nthreads is passed to first_touch(), 0 means default_thread_count()
+    template<typename T>
+    class huge_page_allocator {
+    public:
+        typedef T value_type;
+
+        huge_page_allocator() : nthreads_(0) {
+        }
+
+        explicit huge_page_allocator(ssize_t nthreads) : nthreads_(nthreads) {
+        }
+
+        template<typename U>
+        huge_page_allocator(const huge_page_allocator<U> &x) : nthreads_(x.nthreads()) {
+        }
+
+        T *allocate(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_alloc();
+            T *p = static_cast<T *>(detail::huge_page_allocate(n * sizeof(T), nthreads_));
+#if SX_ALLOC_STATS
+            detail::alloc_record(n * sizeof(T), typeid(T).name());
+#endif
+            return p;
+        }
+
+        void deallocate(T *p, size_t n) {
+#if SX_ALLOC_STATS
+            detail::dealloc_record(n * sizeof(T), typeid(T).name());
+#endif
+            detail::huge_page_deallocate(p, n * sizeof(T));
+        }
+
+        ssize_t nthreads() const {
+            return nthreads_;
+        }
+
+    private:
+        ssize_t nthreads_;
+    };
+
+    //memory from any of them can be freed by any other
+    template<typename T, typename U>
+    bool operator==(const huge_page_allocator<T> &, const huge_page_allocator<U> &) {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const huge_page_allocator<T> &, const huge_page_allocator<U> &) {
+        return false;
+    }
+
+    template<typename T> using huge_darray1 = darray1<T, huge_page_allocator<T>>;
+    template<typename T> using huge_darray2 = darray2<T, huge_page_allocator<T>>;
+
+}
+
+#endif
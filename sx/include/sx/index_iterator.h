@@ -125,12 +125,12 @@ namespace sx {
     }
 
     template<typename E, typename std::enable_if<container_traits<E>::use_mutable_index_iterator>::type * = nullptr>
-    mutable_index_iterator<E> begin(const E &c) {
+    mutable_index_iterator<const E> begin(const E &c) {
         return mutable_index_iterator<const E> {&c, 0};
     }
 
     template<typename E, typename std::enable_if<container_traits<E>::use_mutable_index_iterator>::type * = nullptr>
-    mutable_index_iterator<E> end(const E &c) {
+    mutable_index_iterator<const E> end(const E &c) {
         return mutable_index_iterator<const E> {&c, c.size()};
     }
 
@@ -12,6 +12,7 @@
 // -----------------------------------------------------------
 
 #ifndef STDAUX_LOWEST_BIT_HPP_GP_20030301
+#define STDAUX_LOWEST_BIT_HPP_GP_20030301
 
 #include <assert.h>
 #include "integer_log2.h"
@@ -0,0 +1,75 @@
+#ifndef KERNEL_TABLE_INCLUDED_4408163
+#define KERNEL_TABLE_INCLUDED_4408163
+
+#include <cstdint>
+
+#include "types.h"
+
+//the function tables of the per-isa kernel translation units
+//also included by the units compiled with -mavx2 etc., so it must not define any function: an inline
+//function emitted there could be the copy the linker keeps for the whole program
+
+namespace sx {
+
+    //ordered, each one implies the ones before it
+    enum class isa {
+        baseline,   //whatever the compiler targets by default
+        sse42,      //sse4.2, popcnt
+        avx2,       //avx2, popcnt
+        avx512      //avx-512f, popcnt
+    };
+
+    namespace detail {
+
+        //kernels on contiguous arrays of T
+        template<typename T>
+        struct typed_kernels {
+            //integers wrap around, floating point sums are reassociated across the vector lanes
+            T (*sum)(const T *x, ssize_t n);
+
+            //index of the first minimum/maximum, nans are skipped unless x[0] is one, like std::min_element
+            ssize_t (*argmin)(const T *x, ssize_t n);
+
+            ssize_t (*argmax)(const T *x, ssize_t n);
+
+            //x[i] == y[i] for all i
+            bool (*equal)(const T *x, const T *y, ssize_t n);
+
+            //out[i] = x[idcs[i]]
+            void (*gather)(const T *x, const ssize_t *idcs, ssize_t n, T *out);
+        };
+
+        struct kernel_table {
+            isa target;
+            typed_kernels<double> f64;
+            typed_kernels<float> f32;
+            typed_kernels<int32_t> i32;
+            typed_kernels<int64_t> i64;
+
+            //bitset blocks
+            int64_t (*popcount)(const uint64_t *x, ssize_t n);
+
+            //x[i] op= y[i]
+            void (*and_blocks)(uint64_t *x, const uint64_t *y, ssize_t n);
+
+            void (*or_blocks)(uint64_t *x, const uint64_t *y, ssize_t n);
+
+            void (*xor_blocks)(uint64_t *x, const uint64_t *y, ssize_t n);
+
+            //x[i] &= ~y[i]
+            void (*andnot_blocks)(uint64_t *x, const uint64_t *y, ssize_t n);
+        };
+
+        //nullptr if the library was built without the kernels of that isa
+        const kernel_table *kernel_table_baseline();
+
+        const kernel_table *kernel_table_sse42();
+
+        const kernel_table *kernel_table_avx2();
+
+        const kernel_table *kernel_table_avx512();
+    }
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "sx/kernels.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SX_KERNELS_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace sx {
+
+    using detail::kernel_table;
+
+    namespace {
+#ifdef SX_KERNELS_X86
+        void cpuid(unsigned leaf, unsigned subleaf, unsigned r[4]) {
+#if defined(_MSC_VER)
+            int x[4];
+            __cpuidex(x, int(leaf), int(subleaf));
+            for (int i = 0; i < 4; ++i)
+                r[i] = unsigned(x[i]);
+#else
+            r[0] = r[1] = r[2] = r[3] = 0;
+            __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+        }
+
+        //the register state the os saves on context switches
+        uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            unsigned lo, hi;
+            __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            return (uint64_t(hi) << 32) | lo;
+#endif
+        }
+
+        isa detect() {
+            unsigned r[4];
+            cpuid(0, 0, r);
+            const unsigned max_leaf = r[0];
+            if (max_leaf < 1)
+                return isa::baseline;
+            cpuid(1, 0, r);
+            const bool sse42 = (r[2] >> 20) & 1, popcnt = (r[2] >> 23) & 1;
+            const bool osxsave = (r[2] >> 27) & 1, avx = (r[2] >> 28) & 1;
+            if (!sse42 || !popcnt)
+                return isa::baseline;
+            if (!osxsave || !avx || max_leaf < 7)
+                return isa::sse42;
+            const uint64_t xcr0 = xgetbv0();
+            if ((xcr0 & 0x6) != 0x6)    //xmm, ymm
+                return isa::sse42;
+            cpuid(7, 0, r);
+            const bool avx2 = (r[1] >> 5) & 1, avx512f = (r[1] >> 16) & 1;
+            if (!avx2)
+                return isa::sse42;
+            if (!avx512f || (xcr0 & 0xe0) != 0xe0)  //opmask, zmm
+                return isa::avx2;
+            return isa::avx512;
+        }
+#else
+        isa detect() {
+            return isa::baseline;
+        }
+#endif
+
+        const kernel_table *table_of(isa x) {
+            switch (x) {
+                case isa::avx512:
+                    return detail::kernel_table_avx512();
+                case isa::avx2:
+                    return detail::kernel_table_avx2();
+                case isa::sse42:
+                    return detail::kernel_table_sse42();
+                default:
+                    return detail::kernel_table_baseline();
+            }
+        }
+
+        //the best table not above x and the detected isa, the baseline one always exists
+        const kernel_table *resolve(isa x) {
+            if (detected_isa() < x)
+                x = detected_isa();
+            for (;; x = isa(int(x) - 1)) {
+                if (const kernel_table *t = table_of(x))
+                    return t;
+            }
+        }
+
+        //SX_ISA, no cap if unset or unknown: kernels() runs inside noexcept functions, it must not throw
+        isa env_isa() {
+            const char *env = getenv("SX_ISA");
+            for (isa x : {isa::baseline, isa::sse42, isa::avx2})
+                if (env && strcmp(env, isa_name(x)) == 0)
+                    return x;
+            return isa::avx512;
+        }
+
+        std::atomic<const kernel_table *> active(nullptr);
+        std::mutex active_mutex;
+    }
+
+    isa detected_isa() {
+        static const isa x = detect();
+        return x;
+    }
+
+    isa active_isa() {
+        return detail::kernels().target;
+    }
+
+    void force_isa(isa x) {
+        std::lock_guard<std::mutex> lock(active_mutex);
+        active.store(resolve(x), std::memory_order_release);
+    }
+
+    const char *isa_name(isa x) {
+        switch (x) {
+            case isa::baseline:
+                return "baseline";
+            case isa::sse42:
+                return "sse42";
+            case isa::avx2:
+                return "avx2";
+            case isa::avx512:
+                return "avx512";
+        }
+        return "?";
+    }
+
+    isa parse_isa(const char *name) {
+        for (isa x : {isa::baseline, isa::sse42, isa::avx2, isa::avx512})
+            if (strcmp(name, isa_name(x)) == 0)
+                return x;
+        throw std::runtime_error(std::string("parse_isa: unknown isa '") + name + "'");
+    }
+
+    namespace detail {
+
+        const kernel_table &kernels() {
+            const kernel_table *t = active.load(std::memory_order_acquire);
+            if (t)
+                return *t;
+            std::lock_guard<std::mutex> lock(active_mutex);
+            t = active.load(std::memory_order_relaxed);
+            if (!t) {
+                t = resolve(env_isa());
+                active.store(t, std::memory_order_release);
+            }
+            return *t;
+        }
+
+    }
+
+}
@@ -0,0 +1,64 @@
+#ifndef KERNELS_INCLUDED_7720394
+#define KERNELS_INCLUDED_7720394
+
+#include <cstdint>
+#include <type_traits>
+
+#include "kernel_table.h"
+
+//runtime dispatch of the vectorized kernels behind sum, min, max, op==(list, list), gather and dynamic_bitset
+//the library carries one copy of them per isa (kernels_<isa>.cpp) and the first call picks the best one
+//the cpu and the os support, SX_ISA=baseline|sse42|avx2|avx512 in the environment caps it, other values are ignored
+
+namespace sx {
+
+    //the best isa of the cpu the os also saves the registers of
+    isa detected_isa();
+
+    //the isa of the kernels in use
+    isa active_isa();
+
+    //switches the kernels to the best available isa not above x, for tests and benchmarks
+    //not meant to race with running kernels
+    void force_isa(isa x);
+
+    const char *isa_name(isa x);
+
+    //"baseline", "sse42", "avx2" or "avx512", throws for anything else
+    isa parse_isa(const char *name);
+
+    namespace detail {
+        //resolved at the first call
+        const kernel_table &kernels();
+
+        template<typename T>
+        struct has_kernels : std::integral_constant<bool,
+                std::is_same<T, double>::value || std::is_same<T, float>::value ||
+                std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value> {
+        };
+
+        inline const typed_kernels<double> &typed(const kernel_table &k, const double *) {
+            return k.f64;
+        }
+
+        inline const typed_kernels<float> &typed(const kernel_table &k, const float *) {
+            return k.f32;
+        }
+
+        inline const typed_kernels<int32_t> &typed(const kernel_table &k, const int32_t *) {
+            return k.i32;
+        }
+
+        inline const typed_kernels<int64_t> &typed(const kernel_table &k, const int64_t *) {
+            return k.i64;
+        }
+
+        template<typename T>
+        const typed_kernels<T> &kernels_for() {
+            return typed(kernels(), static_cast<const T *>(nullptr));
+        }
+    }
+
+}
+
+#endif
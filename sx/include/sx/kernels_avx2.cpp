@@ -0,0 +1,37 @@
+//compiled with -mavx2 -mpopcnt where the compiler supports it, see sx/CMakeLists.txt
+//only called after the cpu has been checked, see kernels.cpp
+
+#include "sx/kernel_table.h"
+
+#if defined(__GNUC__) && defined(__AVX2__) && defined(__POPCNT__)
+
+#include <immintrin.h>
+
+#define SX_KERNEL_WIDTH 32
+
+#include "sx/kernels_impl.h"
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_avx2() {
+            static const kernel_table t = make_kernel_table(isa::avx2);
+            return &t;
+        }
+
+    }
+}
+
+#else
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_avx2() {
+            return nullptr;
+        }
+
+    }
+}
+
+#endif
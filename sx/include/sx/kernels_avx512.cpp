@@ -0,0 +1,37 @@
+//compiled with -mavx512f -mpopcnt where the compiler supports it, see sx/CMakeLists.txt
+//only called after the cpu has been checked, see kernels.cpp
+
+#include "sx/kernel_table.h"
+
+#if defined(__GNUC__) && defined(__AVX512F__) && defined(__POPCNT__)
+
+#include <immintrin.h>
+
+#define SX_KERNEL_WIDTH 64
+
+#include "sx/kernels_impl.h"
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_avx512() {
+            static const kernel_table t = make_kernel_table(isa::avx512);
+            return &t;
+        }
+
+    }
+}
+
+#else
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_avx512() {
+            return nullptr;
+        }
+
+    }
+}
+
+#endif
@@ -0,0 +1,16 @@
+//plain loops, no vector extensions, so this unit also builds where the per-isa ones are empty
+
+#define SX_KERNEL_WIDTH 0
+
+#include "sx/kernels_impl.h"
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_baseline() {
+            static const kernel_table t = make_kernel_table(isa::baseline);
+            return &t;
+        }
+
+    }
+}
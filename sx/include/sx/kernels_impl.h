@@ -0,0 +1,273 @@
+//the kernel bodies, included by kernels_baseline.cpp and kernels_<isa>.cpp after defining SX_KERNEL_WIDTH,
+//the vector width in bytes of the target isa or 0 for plain loops (no include guard, one copy per unit)
+//everything here has internal linkage and calls no inline library function, so nothing compiled for one isa
+//can be merged into code running on another
+
+#ifndef SX_KERNEL_WIDTH
+#error "define SX_KERNEL_WIDTH before including kernels_impl.h"
+#endif
+
+#include "sx/kernel_table.h"
+
+namespace sx {
+    namespace detail {
+        namespace {
+
+            template<typename T> struct unsigned_of { typedef T type; };
+            template<> struct unsigned_of<int32_t> { typedef uint32_t type; };
+            template<> struct unsigned_of<int64_t> { typedef uint64_t type; };
+
+            //lane type of the comparison masks
+            template<typename T> struct mask_of { typedef T type; };
+            template<> struct mask_of<double> { typedef int64_t type; };
+            template<> struct mask_of<float> { typedef int32_t type; };
+            template<> struct mask_of<uint32_t> { typedef int32_t type; };
+            template<> struct mask_of<uint64_t> { typedef int64_t type; };
+
+            template<typename T>
+            bool is_nan(T x) {
+                return !(x == x);
+            }
+
+            int popcount64(uint64_t x) {
+#if defined(__GNUC__)
+                return __builtin_popcountll(x);
+#else
+                x = x - ((x >> 1) & 0x5555555555555555ull);
+                x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+                x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+                return int((x * 0x0101010101010101ull) >> 56);
+#endif
+            }
+
+#if SX_KERNEL_WIDTH
+            //gcc/clang vector extensions, compiled to the instructions of the unit's isa
+            template<typename T>
+            struct vec {
+                typedef T type __attribute__((vector_size(SX_KERNEL_WIDTH)));
+                typedef typename mask_of<T>::type mask_lane;
+                typedef mask_lane mask __attribute__((vector_size(SX_KERNEL_WIDTH)));
+                static const ssize_t lanes = SX_KERNEL_WIDTH / sizeof(T);
+            };
+
+            template<typename V, typename T>
+            V load(const T *p) {
+                V v;
+                __builtin_memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            template<typename V, typename T>
+            void store(T *p, const V &v) {
+                __builtin_memcpy(p, &v, sizeof(v));
+            }
+
+            template<typename V, typename T>
+            V broadcast(T x) {
+                const V zero = {};
+                return zero + x;
+            }
+
+            //m ? x : y lane by lane
+            template<typename V, typename M>
+            V select(const M &m, const V &x, const V &y) {
+                return (V) (((M) x & m) | ((M) y & ~m));
+            }
+
+            template<typename M>
+            bool any(const M &m) {
+                for (ssize_t j = 0; j < ssize_t(sizeof(M) / sizeof(m[0])); ++j)
+                    if (m[j])
+                        return true;
+                return false;
+            }
+#endif
+
+            template<typename T>
+            T sum(const T *x, ssize_t n) {
+                typedef typename unsigned_of<T>::type U;
+                const U *p = reinterpret_cast<const U *>(x);
+                U s = 0;
+                ssize_t i = 0;
+#if SX_KERNEL_WIDTH
+                typedef typename vec<U>::type V;
+                const ssize_t L = vec<U>::lanes;
+                if (n >= 4 * L) {
+                    //four accumulators to hide the add latency
+                    V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+                    for (; i + 4 * L <= n; i += 4 * L) {
+                        a0 += load<V>(p + i);
+                        a1 += load<V>(p + i + L);
+                        a2 += load<V>(p + i + 2 * L);
+                        a3 += load<V>(p + i + 3 * L);
+                    }
+                    const V a = (a0 + a1) + (a2 + a3);
+                    for (ssize_t j = 0; j < L; ++j)
+                        s += a[j];
+                }
+#endif
+                for (; i < n; ++i)
+                    s += p[i];
+                return T(s);
+            }
+
+            template<bool Max, typename T>
+            bool better(T x, T y) {
+                return Max ? y < x : x < y;
+            }
+
+            template<typename T, bool Max>
+            ssize_t argext(const T *x, ssize_t n) {
+                if (n <= 0 || is_nan(x[0]))
+                    return 0;
+                T m = x[0];
+                ssize_t i = 1;
+#if SX_KERNEL_WIDTH
+                typedef typename vec<T>::type V;
+                typedef typename vec<T>::mask M;
+                const ssize_t L = vec<T>::lanes;
+                if (n > 4 * L) {
+                    //a nan never compares better, so it never gets into the accumulators
+                    V a = broadcast<V>(m), b = a;
+                    for (; i + 2 * L <= n; i += 2 * L) {
+                        const V v = load<V>(x + i), w = load<V>(x + i + L);
+                        a = select((M) (Max ? a < v : v < a), v, a);
+                        b = select((M) (Max ? b < w : w < b), w, b);
+                    }
+                    for (ssize_t j = 0; j < L; ++j) {
+                        if (better<Max>(a[j], m))
+                            m = a[j];
+                        if (better<Max>(b[j], m))
+                            m = b[j];
+                    }
+                }
+#endif
+                for (; i < n; ++i)
+                    if (better<Max>(x[i], m))
+                        m = x[i];
+                for (i = 0; i < n; ++i)
+                    if (x[i] == m)
+                        break;
+                return i;
+            }
+
+            template<typename T>
+            bool equal(const T *x, const T *y, ssize_t n) {
+                ssize_t i = 0;
+#if SX_KERNEL_WIDTH
+                typedef typename vec<T>::type V;
+                typedef typename vec<T>::mask M;
+                const ssize_t L = vec<T>::lanes;
+                for (; i + 2 * L <= n; i += 2 * L) {
+                    const M m = (M) (load<V>(x + i) != load<V>(y + i)) | (M) (load<V>(x + i + L) != load<V>(y + i + L));
+                    if (any(m))
+                        return false;
+                }
+#endif
+                for (; i < n; ++i)
+                    if (x[i] != y[i])
+                        return false;
+                return true;
+            }
+
+            template<typename T>
+            void gather(const T *x, const ssize_t *idcs, ssize_t n, T *out) {
+                ssize_t i = 0;
+                //the hardware gathers move bits, the element type only selects the width, indices are 64-bit
+#if defined(__AVX512F__) && defined(__x86_64__)
+                for (; i + 8 <= n; i += 8) {
+                    const __m512i ix = _mm512_loadu_si512(idcs + i);
+                    if (sizeof(T) == 8)
+                        _mm512_storeu_pd(out + i, _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xff, ix, x, 8));
+                    else
+                        _mm256_storeu_ps(reinterpret_cast<float *>(out + i),
+                                _mm512_mask_i64gather_ps(_mm256_setzero_ps(), 0xff, ix, x, 4));
+                }
+#elif defined(__AVX2__) && defined(__x86_64__)
+                for (; i + 4 <= n; i += 4) {
+                    const __m256i ix = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idcs + i));
+                    if (sizeof(T) == 8)
+                        _mm256_storeu_pd(reinterpret_cast<double *>(out + i),
+                                _mm256_i64gather_pd(reinterpret_cast<const double *>(x), ix, 8));
+                    else
+                        _mm_storeu_ps(reinterpret_cast<float *>(out + i),
+                                _mm256_i64gather_ps(reinterpret_cast<const float *>(x), ix, 4));
+                }
+#endif
+                for (; i + 4 <= n; i += 4) {
+                    const T a = x[idcs[i]], b = x[idcs[i + 1]], c = x[idcs[i + 2]], d = x[idcs[i + 3]];
+                    out[i] = a;
+                    out[i + 1] = b;
+                    out[i + 2] = c;
+                    out[i + 3] = d;
+                }
+                for (; i < n; ++i)
+                    out[i] = x[idcs[i]];
+            }
+
+            int64_t popcount(const uint64_t *x, ssize_t n) {
+                //independent counts, popcnt has a false dependency on its destination on some cpus
+                int64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+                ssize_t i = 0;
+                for (; i + 4 <= n; i += 4) {
+                    c0 += popcount64(x[i]);
+                    c1 += popcount64(x[i + 1]);
+                    c2 += popcount64(x[i + 2]);
+                    c3 += popcount64(x[i + 3]);
+                }
+                for (; i < n; ++i)
+                    c0 += popcount64(x[i]);
+                return (c0 + c1) + (c2 + c3);
+            }
+
+            enum block_op {
+                op_and, op_or, op_xor, op_andnot
+            };
+
+            template<block_op Op, typename T>
+            T apply(T x, T y) {
+                return Op == op_and ? x & y : Op == op_or ? x | y : Op == op_xor ? x ^ y : x & ~y;
+            }
+
+            template<block_op Op>
+            void blocks(uint64_t *x, const uint64_t *y, ssize_t n) {
+                ssize_t i = 0;
+#if SX_KERNEL_WIDTH
+                typedef vec<uint64_t>::type V;
+                const ssize_t L = vec<uint64_t>::lanes;
+                for (; i + L <= n; i += L)
+                    store(x + i, apply<Op>(load<V>(x + i), load<V>(y + i)));
+#endif
+                for (; i < n; ++i)
+                    x[i] = apply<Op>(x[i], y[i]);
+            }
+
+            template<typename T>
+            typed_kernels<T> make_typed_kernels() {
+                typed_kernels<T> k;
+                k.sum = &sum<T>;
+                k.argmin = &argext<T, false>;
+                k.argmax = &argext<T, true>;
+                k.equal = &equal<T>;
+                k.gather = &gather<T>;
+                return k;
+            }
+
+            kernel_table make_kernel_table(isa target) {
+                kernel_table t;
+                t.target = target;
+                t.f64 = make_typed_kernels<double>();
+                t.f32 = make_typed_kernels<float>();
+                t.i32 = make_typed_kernels<int32_t>();
+                t.i64 = make_typed_kernels<int64_t>();
+                t.popcount = &popcount;
+                t.and_blocks = &blocks<op_and>;
+                t.or_blocks = &blocks<op_or>;
+                t.xor_blocks = &blocks<op_xor>;
+                t.andnot_blocks = &blocks<op_andnot>;
+                return t;
+            }
+
+        }
+    }
+}
@@ -0,0 +1,37 @@
+//compiled with -msse4.2 -mpopcnt where the compiler supports it, see sx/CMakeLists.txt
+//only called after the cpu has been checked, see kernels.cpp
+
+#include "sx/kernel_table.h"
+
+#if defined(__GNUC__) && defined(__SSE4_2__) && defined(__POPCNT__)
+
+#include <immintrin.h>
+
+#define SX_KERNEL_WIDTH 16
+
+#include "sx/kernels_impl.h"
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_sse42() {
+            static const kernel_table t = make_kernel_table(isa::sse42);
+            return &t;
+        }
+
+    }
+}
+
+#else
+
+namespace sx {
+    namespace detail {
+
+        const kernel_table *kernel_table_sse42() {
+            return nullptr;
+        }
+
+    }
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "sx/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sx {
+
+    namespace {
+        std::runtime_error system_error(const char *what, const std::string &path) {
+            return std::runtime_error(std::string(what) + " '" + path + "': " + strerror(errno));
+        }
+    }
+
+    mapped_file::mapped_file()
+            : mode_(mode::read_only), fd_(-1), data_(nullptr), size_(0) {
+    }
+
+    mapped_file::mapped_file(mapped_file &&x)
+            : path_(std::move(x.path_)), mode_(x.mode_), fd_(x.fd_), data_(x.data_), size_(x.size_) {
+        x.fd_ = -1;
+        x.data_ = nullptr;
+        x.size_ = 0;
+    }
+
+    mapped_file &mapped_file::operator=(mapped_file &&x) {
+        if (this != &x) {
+            close();
+            path_ = std::move(x.path_);
+            mode_ = x.mode_;
+            fd_ = x.fd_;
+            data_ = x.data_;
+            size_ = x.size_;
+            x.fd_ = -1;
+            x.data_ = nullptr;
+            x.size_ = 0;
+        }
+        return *this;
+    }
+
+    mapped_file::~mapped_file() {
+        close();
+    }
+
+#ifndef _WIN32
+
+    mapped_file::mapped_file(const std::string &path, mode m)
+            : path_(path), mode_(m), fd_(-1), data_(nullptr), size_(0) {
+        const int flags = m == mode::read_write ? O_RDWR | O_CREAT : O_RDONLY;
+        fd_ = ::open(path.c_str(), flags, 0644);
+        if (fd_ < 0)
+            throw system_error("mapped_file: can't open", path);
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            throw system_error("mapped_file: can't stat", path);
+        }
+        size_ = st.st_size;
+        try {
+            map();
+        } catch (...) {
+            ::close(fd_);
+            fd_ = -1;
+            throw;
+        }
+    }
+
+    void mapped_file::map() {
+        if (size_ == 0) {
+            data_ = nullptr;
+            return;
+        }
+        const int prot = mode_ == mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+        const int flags = mode_ == mode::read_write ? MAP_SHARED : MAP_PRIVATE;
+        void *p = mmap(nullptr, size_, prot, flags, fd_, 0);
+        if (p == MAP_FAILED)
+            throw system_error("mapped_file: can't map", path_);
+        data_ = static_cast<char *>(p);
+    }
+
+    void mapped_file::unmap() {
+        if (data_)
+            munmap(data_, size_);
+        data_ = nullptr;
+    }
+
+    void mapped_file::close() {
+        if (fd_ < 0)
+            return;
+        unmap();
+        ::close(fd_);
+        fd_ = -1;
+        size_ = 0;
+    }
+
+    bool mapped_file::advise(advice a, ssize_t offset, ssize_t length) const {
+        if (!data_)
+            return false;
+        if (length < 0)
+            length = size_ - offset;
+        //madvise wants a page aligned start
+        const ssize_t page = sysconf(_SC_PAGESIZE);
+        const ssize_t start = offset / page * page;
+        length += offset - start;
+        int adv;
+        switch (a) {
+            case advice::normal:
+                adv = MADV_NORMAL;
+                break;
+            case advice::sequential:
+                adv = MADV_SEQUENTIAL;
+                break;
+            case advice::random:
+                adv = MADV_RANDOM;
+                break;
+            case advice::willneed:
+                adv = MADV_WILLNEED;
+                break;
+            case advice::dontneed:
+                adv = MADV_DONTNEED;
+                break;
+            case advice::hugepages:
+#ifdef MADV_HUGEPAGE
+                adv = MADV_HUGEPAGE;
+                break;
+#else
+                return false;
+#endif
+            default:
+                return false;
+        }
+        return madvise(data_ + start, length, adv) == 0;
+    }
+
+    void mapped_file::resize(ssize_t new_size) {
+        if (mode_ != mode::read_write)
+            throw std::runtime_error("mapped_file::resize: file is not opened for writing");
+        if (new_size == size_)
+            return;
+        if (ftruncate(fd_, new_size) != 0)
+            throw system_error("mapped_file: can't resize", path_);
+#ifdef MREMAP_MAYMOVE
+        if (data_ && new_size > 0) {
+            void *p = mremap(data_, size_, new_size, MREMAP_MAYMOVE);
+            if (p == MAP_FAILED)
+                throw system_error("mapped_file: can't remap", path_);
+            data_ = static_cast<char *>(p);
+            size_ = new_size;
+            return;
+        }
+#endif
+        unmap();
+        size_ = new_size;
+        map();
+    }
+
+    void mapped_file::flush() const {
+        if (mode_ != mode::read_write)
+            throw std::runtime_error("mapped_file::flush: file is not opened for writing");
+        if (data_ && msync(data_, size_, MS_SYNC) != 0)
+            throw system_error("mapped_file: can't flush", path_);
+    }
+
+#else
+
+    mapped_file::mapped_file(const std::string &path, mode m)
+            : path_(path), mode_(m), fd_(-1), data_(nullptr), size_(0) {
+        throw std::runtime_error("mapped_file: not implemented on this platform");
+    }
+
+    void mapped_file::map() {
+    }
+
+    void mapped_file::unmap() {
+    }
+
+    void mapped_file::close() {
+    }
+
+    bool mapped_file::advise(advice, ssize_t, ssize_t) const {
+        return false;
+    }
+
+    void mapped_file::resize(ssize_t) {
+    }
+
+    void mapped_file::flush() const {
+    }
+
+#endif
+
+}
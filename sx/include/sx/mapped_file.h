@@ -0,0 +1,348 @@
+#ifndef MAPPED_FILE_INCLUDED_4410387
+#define MAPPED_FILE_INCLUDED_4410387
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "types.h"
+#include "traits.h"
+#include "index_iterator.h"
+#include "array1.h"
+#include "array2.h"
+
+namespace sx {
+
+    //memory mapping of a whole file, POSIX mmap
+    //read_only and copy_on_write map the file as it is, writes to a copy_on_write mapping stay private
+    //read_write maps it shared, creates the file if needed and can grow it with resize()
+    class mapped_file {
+    public:
+        enum class mode {
+            read_only,
+            copy_on_write,
+            read_write
+        };
+
+        //madvise hints, best effort: advise() returns false if the system rejected the hint
+        enum class advice {
+            normal,
+            sequential,
+            random,
+            willneed,
+            dontneed,
+            hugepages
+        };
+
+        mapped_file();
+
+        explicit mapped_file(const std::string &path, mode m = mode::read_only);
+
+        mapped_file(const mapped_file &) = delete;
+
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        mapped_file(mapped_file &&x);
+
+        mapped_file &operator=(mapped_file &&x);
+
+        ~mapped_file();
+
+        void close();
+
+        bool is_open() const {
+            return fd_ >= 0;
+        }
+
+        bool writable() const {
+            return mode_ != mode::read_only;
+        }
+
+        mode open_mode() const {
+            return mode_;
+        }
+
+        const std::string &path() const {
+            return path_;
+        }
+
+        char *data() const {
+            return data_;
+        }
+
+        //current file size in bytes
+        ssize_t size() const {
+            return size_;
+        }
+
+        //hint for the byte range [offset, offset + length), the whole mapping if length < 0
+        bool advise(advice a, ssize_t offset = 0, ssize_t length = -1) const;
+
+        //read_write only: changes the file size and remaps, data() may change
+        void resize(ssize_t new_size);
+
+        //read_write only: writes dirty pages of the mapping back to the file
+        void flush() const;
+
+    private:
+        void map();
+        void unmap();
+
+        std::string path_;
+        mode mode_;
+        int fd_;
+        char *data_;
+        ssize_t size_;
+    };
+
+    //file of raw T elements exposed as a darray1-like container
+    //writable files grow geometrically on append, the unused tail is cut off in close()
+    template<typename T>
+    class mapped_darray1
+            : public container_traits_tags::indexable {
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef ssize_t size_type;
+        typedef mapped_darray1<T> this_type;
+
+        mapped_darray1() : size_(0) {
+        }
+
+        explicit mapped_darray1(const std::string &path, mapped_file::mode m = mapped_file::mode::read_only)
+                : file_(path, m), size_(file_.size() / (ssize_t) sizeof(T)) {
+            if (file_.size() % (ssize_t) sizeof(T) != 0)
+                throw std::runtime_error("mapped_darray1: file size is not a multiple of the element size");
+        }
+
+        mapped_darray1(this_type &&x) : file_(std::move(x.file_)), size_(x.size_) {
+            x.size_ = 0;
+        }
+
+        this_type &operator=(this_type &&x) {
+            close();
+            file_ = std::move(x.file_);
+            size_ = x.size_;
+            x.size_ = 0;
+            return *this;
+        }
+
+        //a tail that can't be cut off stays in the file, call close() first to get the error
+        ~mapped_darray1() {
+            try {
+                close();
+            } catch (...) {
+                file_.close();
+            }
+        }
+
+        //throws if cutting off the unused tail fails
+        void close() {
+            if (!file_.is_open())
+                return;
+            if (file_.open_mode() == mapped_file::mode::read_write && capacity() != size_)
+                file_.resize(size_ * (ssize_t) sizeof(T));
+            file_.close();
+            size_ = 0;
+        }
+
+        const mapped_file &file() const {
+            return file_;
+        }
+
+        bool advise(mapped_file::advice a) const {
+            return file_.advise(a, 0, size_ * (ssize_t) sizeof(T));
+        }
+
+        ssize_t size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        ssize_t stride() const {
+            return 1;
+        }
+
+        ssize_t capacity() const {
+            return file_.size() / (ssize_t) sizeof(T);
+        }
+
+        //writes need a copy_on_write or read_write mapping
+        pointer data() {
+            return reinterpret_cast<pointer>(file_.data());
+        }
+
+        const_pointer data() const {
+            return reinterpret_cast<const_pointer>(file_.data());
+        }
+
+        reference operator[](ssize_t idx) {
+            return data()[idx];
+        }
+
+        const_reference operator[](ssize_t idx) const {
+            return data()[idx];
+        }
+
+        operator array1<T>() const {
+            return array1<T>(data(), size_);
+        }
+
+        operator marray1<T>() {
+            return marray1<T>(data(), size_);
+        }
+
+        //read_write only, the views taken before may be invalidated
+        void reserve(ssize_t n) {
+            if (n > capacity())
+                file_.resize(n * (ssize_t) sizeof(T));
+        }
+
+        void push_back(const T &x) {
+            if (size_ == capacity())
+                reserve(std::max<ssize_t>(size_ * 2, 4096 / (ssize_t) sizeof(T) + 1));
+            data()[size_++] = x;
+        }
+
+        template<typename InputIt>
+        void push_back(InputIt first, InputIt last) {
+            for (; first != last; ++first)
+                push_back(*first);
+        }
+
+    private:
+        mapped_file file_;
+        ssize_t size_;
+    };
+
+    //file of raw T elements in row-major order exposed as a darray2-like container with nc columns
+    template<typename T>
+    class mapped_darray2
+            : public container_traits_tags::indexable,
+              public container_traits_tags::two_dimensional {
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef ssize_t size_type;
+        typedef mapped_darray2<T> this_type;
+
+        mapped_darray2() : nc_(0) {
+        }
+
+        mapped_darray2(const std::string &path, ssize_t ncols, mapped_file::mode m = mapped_file::mode::read_only)
+                : v_(path, m), nc_(ncols) {
+            if (ncols <= 0 || v_.size() % ncols != 0)
+                throw std::runtime_error("mapped_darray2: file size is not a multiple of the row size");
+        }
+
+        const mapped_file &file() const {
+            return v_.file();
+        }
+
+        bool advise(mapped_file::advice a) const {
+            return v_.advise(a);
+        }
+
+        void close() {
+            v_.close();
+        }
+
+        ssize_t nr() const {
+            return nc_ == 0 ? 0 : v_.size() / nc_;
+        }
+
+        ssize_t nc() const {
+            return nc_;
+        }
+
+        ssize_t size() const {
+            return v_.size();
+        }
+
+        pointer data() {
+            return v_.data();
+        }
+
+        const_pointer data() const {
+            return v_.data();
+        }
+
+        reference operator[](ssize_t idx) {
+            return v_[idx];
+        }
+
+        const_reference operator[](ssize_t idx) const {
+            return v_[idx];
+        }
+
+        reference operator()(ssize_t row, ssize_t col) {
+            assert(0 <= row && row < nr() && 0 <= col && col < nc());
+            return v_[row * nc_ + col];
+        }
+
+        const_reference operator()(ssize_t row, ssize_t col) const {
+            assert(0 <= row && row < nr() && 0 <= col && col < nc());
+            return v_[row * nc_ + col];
+        }
+
+        operator array2<T>() const {
+            return array2<T>(data(), nr(), nc());
+        }
+
+        operator marray2<T>() {
+            return marray2<T>(data(), nr(), nc());
+        }
+
+        //read_write only, the views taken before may be invalidated
+        void append_row(array1<T> v) {
+            if (v.size() != nc_)
+                throw std::runtime_error("append_row: invalid arg size");
+            v_.reserve(v_.size() + nc_);
+            v_.push_back(BEGINEND(v));
+        }
+
+    private:
+        mapped_darray1<T> v_;
+        ssize_t nc_;
+    };
+
+    template<typename T>
+    const_index_iterator<const mapped_darray1<T>> begin(const mapped_darray1<T> &that) {
+        return const_index_iterator<const mapped_darray1<T>>(&that, 0);
+    }
+
+    template<typename T>
+    const_index_iterator<const mapped_darray1<T>> end(const mapped_darray1<T> &that) {
+        return const_index_iterator<const mapped_darray1<T>>(&that, that.size());
+    }
+
+    template<typename T>
+    mutable_index_iterator<mapped_darray1<T>> begin(mapped_darray1<T> &that) {
+        return mutable_index_iterator<mapped_darray1<T>>(&that, 0);
+    }
+
+    template<typename T>
+    mutable_index_iterator<mapped_darray1<T>> end(mapped_darray1<T> &that) {
+        return mutable_index_iterator<mapped_darray1<T>>(&that, that.size());
+    }
+
+    template<typename T>
+    array2<T> as_array2(const mapped_darray2<T> &x) {
+        return x;
+    }
+
+}
+
+#endif
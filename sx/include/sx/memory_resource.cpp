@@ -0,0 +1,185 @@
+#include "sx/memory_resource.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "sx/scratch_allocator.h"
+
+namespace sx {
+
+    namespace {
+        char *align_up(char *p, size_t align) {
+            return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + (align - 1)) & ~uintptr_t(align - 1));
+        }
+
+        class heap_resource_type : public memory_resource {
+        protected:
+            void *do_allocate(size_t nbytes, size_t) {
+                void *p = ::operator new(nbytes);
+#if SX_ALLOC_STATS
+                detail::alloc_record(nbytes, "memory_resource");
+#endif
+                return p;
+            }
+
+            void do_deallocate(void *p, size_t nbytes, size_t) {
+#if SX_ALLOC_STATS
+                detail::dealloc_record(nbytes, "memory_resource");
+#else
+                (void) nbytes;
+#endif
+                ::operator delete(p);
+            }
+
+            bool do_is_equal(const memory_resource &x) const noexcept {
+                return dynamic_cast<const heap_resource_type *>(&x) != nullptr;
+            }
+        };
+
+        class null_resource_type : public memory_resource {
+        protected:
+            void *do_allocate(size_t, size_t) {
+                throw std::bad_alloc();
+            }
+
+            void do_deallocate(void *, size_t, size_t) {
+            }
+
+            bool do_is_equal(const memory_resource &x) const noexcept {
+                return this == &x;
+            }
+        };
+
+        //one per thread, like the arena
+        class scratch_resource_type : public memory_resource {
+        public:
+            scratch_resource_type() : arena_(scratch_arena::current()) {
+            }
+
+        protected:
+            void *do_allocate(size_t nbytes, size_t align) {
+                if (arena_.depth() == 0)
+                    return heap_resource()->allocate(nbytes, align);
+                return arena_.allocate(nbytes, align);
+            }
+
+            void do_deallocate(void *p, size_t nbytes, size_t align) {
+                if (!arena_.owns(p))
+                    heap_resource()->deallocate(p, nbytes, align);
+            }
+
+            bool do_is_equal(const memory_resource &x) const noexcept {
+                return this == &x;
+            }
+
+        private:
+            scratch_arena &arena_;
+        };
+
+        memory_resource *&thread_default_resource() {
+            static thread_local memory_resource *r = nullptr;
+            return r;
+        }
+
+        const size_t first_block_bytes = 4096;
+    }
+
+    memory_resource::~memory_resource() {
+    }
+
+    memory_resource *heap_resource() noexcept {
+        static heap_resource_type r;
+        return &r;
+    }
+
+    memory_resource *null_resource() noexcept {
+        static null_resource_type r;
+        return &r;
+    }
+
+    memory_resource *scratch_resource() noexcept {
+        static thread_local scratch_resource_type r;
+        return &r;
+    }
+
+    memory_resource *default_resource() noexcept {
+        memory_resource *r = thread_default_resource();
+        return r ? r : heap_resource();
+    }
+
+    resource_scope::resource_scope(memory_resource *r) : outer_(thread_default_resource()) {
+        thread_default_resource() = r;
+    }
+
+    resource_scope::~resource_scope() {
+        thread_default_resource() = outer_;
+    }
+
+    //header of the blocks taken from upstream
+    struct monotonic_buffer_resource::block {
+        block *next;
+        size_t nbytes;  //including the header
+    };
+
+    monotonic_buffer_resource::monotonic_buffer_resource(memory_resource *upstream)
+            : monotonic_buffer_resource(first_block_bytes, upstream) {
+    }
+
+    monotonic_buffer_resource::monotonic_buffer_resource(size_t initial_bytes, memory_resource *upstream)
+            : upstream_(upstream), buffer_(nullptr), buffer_bytes_(0), blocks_(nullptr), ptr_(nullptr), end_(nullptr),
+              next_bytes_(std::max(initial_bytes, sizeof(block))), used_(0) {
+    }
+
+    monotonic_buffer_resource::monotonic_buffer_resource(void *buffer, size_t nbytes, memory_resource *upstream)
+            : upstream_(upstream), buffer_(static_cast<char *>(buffer)), buffer_bytes_(nbytes), blocks_(nullptr),
+              ptr_(buffer_), end_(buffer_ + nbytes), next_bytes_(std::max(2 * nbytes, first_block_bytes)), used_(0) {
+    }
+
+    monotonic_buffer_resource::~monotonic_buffer_resource() {
+        release();
+    }
+
+    void monotonic_buffer_resource::release() {
+        while (blocks_) {
+            block *b = blocks_;
+            blocks_ = b->next;
+            upstream_->deallocate(b, b->nbytes);
+        }
+        ptr_ = buffer_;
+        end_ = buffer_ ? buffer_ + buffer_bytes_ : nullptr;
+        used_ = 0;
+    }
+
+    void *monotonic_buffer_resource::do_allocate(size_t nbytes, size_t align) {
+        if (ptr_) {
+            char *p = align_up(ptr_, align);
+            if (p <= end_ && nbytes <= size_t(end_ - p)) {
+                used_ += (p + nbytes) - ptr_;
+                ptr_ = p + nbytes;
+                return p;
+            }
+        }
+        //the block header keeps the rest max_align aligned, larger alignments pad inside the block
+        const size_t header = std::max(sizeof(block), size_t(max_align));
+        const size_t need = header + nbytes + (align > max_align ? align : 0);
+        const size_t size = std::max(next_bytes_, need);
+        block *b = static_cast<block *>(upstream_->allocate(size));
+        b->next = blocks_;
+        b->nbytes = size;
+        blocks_ = b;
+        next_bytes_ = size + size / 2;
+        char *p = align_up(reinterpret_cast<char *>(b) + header, align);
+        ptr_ = p + nbytes;
+        end_ = reinterpret_cast<char *>(b) + size;
+        used_ += nbytes;
+        return p;
+    }
+
+    void monotonic_buffer_resource::do_deallocate(void *, size_t, size_t) {
+    }
+
+    bool monotonic_buffer_resource::do_is_equal(const memory_resource &x) const noexcept {
+        return this == &x;
+    }
+
+}
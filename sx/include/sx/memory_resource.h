@@ -0,0 +1,186 @@
+#ifndef MEMORY_RESOURCE_INCLUDED_4471093
+#define MEMORY_RESOURCE_INCLUDED_4471093
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include "types.h"
+#include "allocator.h"
+#include "array1.h"
+#include "array2.h"
+
+//runtime-chosen memory for containers, after std::pmr which C++11 doesn't have
+//a container with polymorphic_allocator (pmr::darray1, pmr::darray2, dynamic_bitset) allocates from the
+//memory_resource it was constructed with: a monotonic buffer, the scratch arena, shared memory or anything
+//else deriving from memory_resource, which must outlive it
+//unlike std::pmr, copies allocate from the resource of their source, and moves and swaps take the resource along
+//results of ops do not follow their inputs: + * / == each gather and the other elementwise ops return darray1
+//with sx::allocator, only where, grade_up, grade_down, cut and horzcat take an Alloc, and with
+//<polymorphic_allocator> they allocate from default_resource(), see resource_scope
+
+namespace sx {
+
+    class memory_resource {
+    public:
+        static const size_t max_align = alignof(std::max_align_t);
+
+        virtual ~memory_resource();
+
+        void *allocate(size_t nbytes, size_t align = max_align) {
+            return do_allocate(nbytes, align);
+        }
+
+        void deallocate(void *p, size_t nbytes, size_t align = max_align) {
+            do_deallocate(p, nbytes, align);
+        }
+
+        //memory from one can be freed by the other
+        bool is_equal(const memory_resource &x) const noexcept {
+            return this == &x || do_is_equal(x);
+        }
+
+    protected:
+        virtual void *do_allocate(size_t nbytes, size_t align) = 0;
+
+        virtual void do_deallocate(void *p, size_t nbytes, size_t align) = 0;
+
+        virtual bool do_is_equal(const memory_resource &x) const noexcept = 0;
+    };
+
+    //operator new, counted by alloc_stats.h when built with SX_ALLOC_STATS
+    memory_resource *heap_resource() noexcept;
+
+    //throws std::bad_alloc on every allocation, as upstream of a monotonic_buffer_resource it proves
+    //that a pipeline fits its buffer
+    memory_resource *null_resource() noexcept;
+
+    //the scratch arena of the calling thread, see scratch_allocator.h, heap_resource() outside of scratch_scopes
+    memory_resource *scratch_resource() noexcept;
+
+    //hands out memory by bumping a pointer through its buffer and then through blocks from upstream,
+    //deallocate does nothing, release() or the destructor frees everything at once; not thread-safe
+    class monotonic_buffer_resource : public memory_resource {
+    public:
+        explicit monotonic_buffer_resource(memory_resource *upstream = heap_resource());
+
+        //the first block from upstream is initial_bytes
+        explicit monotonic_buffer_resource(size_t initial_bytes, memory_resource *upstream = heap_resource());
+
+        //[buffer, buffer + nbytes) first, then blocks from upstream
+        monotonic_buffer_resource(void *buffer, size_t nbytes, memory_resource *upstream = heap_resource());
+
+        monotonic_buffer_resource(const monotonic_buffer_resource &) = delete;
+
+        monotonic_buffer_resource &operator=(const monotonic_buffer_resource &) = delete;
+
+        ~monotonic_buffer_resource();
+
+        //gives the upstream blocks back and starts over at the beginning of the buffer
+        void release();
+
+        memory_resource *upstream() const {
+            return upstream_;
+        }
+
+        //handed out since construction or the last release(), counting alignment padding
+        size_t bytes_used() const {
+            return used_;
+        }
+
+    protected:
+        void *do_allocate(size_t nbytes, size_t align);
+
+        void do_deallocate(void *p, size_t nbytes, size_t align);
+
+        bool do_is_equal(const memory_resource &x) const noexcept;
+
+    private:
+        struct block;
+
+        memory_resource *upstream_;
+        char *buffer_;
+        size_t buffer_bytes_;
+        block *blocks_;         //upstream blocks, newest first
+        char *ptr_;
+        char *end_;
+        size_t next_bytes_;
+        size_t used_;
+    };
+
+    //what default constructed polymorphic_allocators and dynamic_bitsets of the calling thread use,
+    //heap_resource() unless a resource_scope is open
+    memory_resource *default_resource() noexcept;
+
+    //makes r the default resource of the calling thread for its lifetime, e.g. so the results of
+    //where<polymorphic_allocator>(x) land in a monotonic buffer
+    class resource_scope {
+    public:
+        explicit resource_scope(memory_resource *r);
+
+        resource_scope(const resource_scope &) = delete;
+
+        resource_scope &operator=(const resource_scope &) = delete;
+
+        ~resource_scope();
+
+    private:
+        memory_resource *outer_;
+    };
+
+    //allocator taking its memory from a memory_resource
+    template<typename T>
+    class polymorphic_allocator {
+    public:
+        typedef T value_type;
+        typedef std::false_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        polymorphic_allocator() noexcept : resource_(default_resource()) {
+        }
+
+        polymorphic_allocator(memory_resource *r) noexcept : resource_(r) {
+        }
+
+        template<typename U>
+        polymorphic_allocator(const polymorphic_allocator<U> &x) noexcept : resource_(x.resource()) {
+        }
+
+        T *allocate(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T *>(resource_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p, size_t n) {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        memory_resource *resource() const noexcept {
+            return resource_;
+        }
+
+    private:
+        memory_resource *resource_;
+    };
+
+    template<typename T, typename U>
+    bool operator==(const polymorphic_allocator<T> &x, const polymorphic_allocator<U> &y) {
+        return x.resource()->is_equal(*y.resource());
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const polymorphic_allocator<T> &x, const polymorphic_allocator<U> &y) {
+        return !(x == y);
+    }
+
+    namespace pmr {
+        template<typename T> using darray1 = sx::darray1<T, polymorphic_allocator<T>>;
+        template<typename T> using darray2 = sx::darray2<T, polymorphic_allocator<T>>;
+    }
+
+}
+
+#endif
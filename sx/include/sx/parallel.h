@@ -0,0 +1,60 @@
+#ifndef PARALLEL_INCLUDED_6620184
+#define PARALLEL_INCLUDED_6620184
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace sx {
+
+    //number of worker threads used by the parallel kernels
+    inline ssize_t default_thread_count() {
+        const unsigned n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : (ssize_t) n;
+    }
+
+    //splits [0, n) into contiguous bands of at least min_band items and calls f(lo, hi) for each
+    //band on its own thread; runs on the calling thread when there is only one band
+    //an exception thrown by f is rethrown on the calling thread after all bands finished
+    template<typename F>
+    void parallel_for_bands(ssize_t n, ssize_t min_band, F &&f, ssize_t nthreads = 0) {
+        if (nthreads <= 0)
+            nthreads = default_thread_count();
+        const ssize_t nbands = std::max<ssize_t>(1, std::min(nthreads, n / std::max<ssize_t>(1, min_band)));
+        if (nbands == 1) {
+            if (n > 0)
+                f(ssize_t(0), n);
+            return;
+        }
+        std::vector<std::exception_ptr> errors(nbands);
+        std::vector<std::thread> threads;
+        threads.reserve(nbands - 1);
+        for (ssize_t b = 1; b < nbands; ++b) {
+            const ssize_t lo = n * b / nbands, hi = n * (b + 1) / nbands;
+            std::exception_ptr *error = &errors[b];
+            threads.emplace_back([&f, lo, hi, error]() {
+                try {
+                    f(lo, hi);
+                } catch (...) {
+                    *error = std::current_exception();
+                }
+            });
+        }
+        try {
+            f(ssize_t(0), n / nbands);
+        } catch (...) {
+            errors[0] = std::current_exception();
+        }
+        for (auto &t : threads)
+            t.join();
+        for (auto &e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+}
+
+#endif
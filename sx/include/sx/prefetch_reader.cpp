@@ -0,0 +1,402 @@
+#include "sx/prefetch_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define SX_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace sx {
+
+    namespace detail {
+        //asynchronous positioned reads identified by a small integer tag, at most one request per tag at a time
+        class read_engine {
+        public:
+            virtual ~read_engine() {
+            }
+
+            //starts reading len bytes at offset off into buf
+            virtual void submit(ssize_t tag, char *buf, ssize_t len, ssize_t off) = 0;
+
+            //waits for the request of tag, returns the number of bytes read or -errno
+            virtual ssize_t wait(ssize_t tag) = 0;
+        };
+    }
+
+#ifndef _WIN32
+
+    namespace {
+        //short only at the end of the file
+        ssize_t pread_full(int fd, char *buf, ssize_t len, ssize_t off) {
+            ssize_t done = 0;
+            while (done < len) {
+                const ssize_t n = pread(fd, buf + done, len - done, off + done);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return -errno;
+                }
+                if (n == 0)
+                    break;
+                done += n;
+            }
+            return done;
+        }
+
+        class thread_read_engine : public detail::read_engine {
+        public:
+            thread_read_engine(int fd, ssize_t ntags, ssize_t nthreads)
+                    : fd_(fd), requests_(ntags), stop_(false) {
+                for (ssize_t i = 0; i < nthreads; ++i)
+                    threads_.emplace_back([this]() { run(); });
+            }
+
+            ~thread_read_engine() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                work_.notify_all();
+                for (auto &t : threads_)
+                    t.join();
+            }
+
+            void submit(ssize_t tag, char *buf, ssize_t len, ssize_t off) override {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    requests_[tag] = request{buf, len, off, false, 0};
+                    queue_.push_back(tag);
+                }
+                work_.notify_one();
+            }
+
+            ssize_t wait(ssize_t tag) override {
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [this, tag]() { return requests_[tag].done; });
+                return requests_[tag].result;
+            }
+
+        private:
+            struct request {
+                char *buf;
+                ssize_t len, off;
+                bool done;
+                ssize_t result;
+            };
+
+            void run() {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (;;) {
+                    work_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+                    if (stop_)
+                        return;
+                    const ssize_t tag = queue_.front();
+                    queue_.pop_front();
+                    const request r = requests_[tag];
+                    lock.unlock();
+                    const ssize_t result = pread_full(fd_, r.buf, r.len, r.off);
+                    lock.lock();
+                    requests_[tag].result = result;
+                    requests_[tag].done = true;
+                    done_.notify_all();
+                }
+            }
+
+            int fd_;
+            std::vector<request> requests_;
+            std::deque<ssize_t> queue_;
+            std::mutex mutex_;
+            std::condition_variable work_, done_;
+            bool stop_;
+            std::vector<std::thread> threads_;
+        };
+
+#ifdef SX_HAVE_IO_URING
+
+        //io_uring through the raw system calls, one READV per request
+        class uring_read_engine : public detail::read_engine {
+        public:
+            uring_read_engine(int fd, ssize_t ntags)
+                    : fd_(fd), ring_fd_(-1), sq_ptr_(MAP_FAILED), cq_ptr_(MAP_FAILED), sqes_(nullptr),
+                      iov_(ntags), requests_(ntags), in_flight_(0) {
+                io_uring_params p;
+                memset(&p, 0, sizeof(p));
+                ring_fd_ = (int) syscall(__NR_io_uring_setup, (unsigned) ntags, &p);
+                if (ring_fd_ < 0)
+                    throw std::runtime_error(std::string("io_uring_setup: ") + strerror(errno));
+
+                sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+                cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+                const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single_mmap)
+                    sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+                sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+                if (sq_ptr_ != MAP_FAILED)
+                    cq_ptr_ = single_mmap ? sq_ptr_
+                            : mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+                sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+                void *sqes = cq_ptr_ == MAP_FAILED ? MAP_FAILED
+                        : mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED) {
+                    const int e = errno;
+                    unmap();
+                    throw std::runtime_error(std::string("io_uring mmap: ") + strerror(e));
+                }
+                sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+                char *sq = static_cast<char *>(sq_ptr_);
+                sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+                sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+                sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+                char *cq = static_cast<char *>(cq_ptr_);
+                cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+                cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+                cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+            }
+
+            ~uring_read_engine() {
+                //the kernel may still be writing into the buffers
+                while (in_flight_ > 0 && reap_or_block())
+                    ;
+                unmap();
+            }
+
+            void submit(ssize_t tag, char *buf, ssize_t len, ssize_t off) override {
+                iov_[tag].iov_base = buf;
+                iov_[tag].iov_len = len;
+                requests_[tag] = request{buf, len, off, false, 0};
+                const unsigned tail = *sq_tail_;
+                const unsigned idx = tail & sq_mask_;
+                io_uring_sqe *sqe = &sqes_[idx];
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READV;
+                sqe->fd = fd_;
+                sqe->addr = (uint64_t) (uintptr_t) &iov_[tag];
+                sqe->len = 1;
+                sqe->off = off;
+                sqe->user_data = tag;
+                sq_array_[idx] = idx;
+                __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+                long r;
+                do {
+                    r = syscall(__NR_io_uring_enter, ring_fd_, 1u, 0u, 0u, nullptr, 0);
+                } while (r < 0 && errno == EINTR);
+                if (r < 0)
+                    throw std::runtime_error(std::string("io_uring_enter: ") + strerror(errno));
+                ++in_flight_;
+            }
+
+            ssize_t wait(ssize_t tag) override {
+                while (!requests_[tag].done)
+                    if (!reap_or_block())
+                        return -errno;
+                request &r = requests_[tag];
+                //READV may come back short before the end of the file, finish those synchronously
+                if (r.result > 0 && r.result < r.len) {
+                    const ssize_t rest = pread_full(fd_, r.buf + r.result, r.len - r.result, r.off + r.result);
+                    r.result = rest < 0 ? rest : r.result + rest;
+                }
+                return r.result;
+            }
+
+        private:
+            struct request {
+                char *buf;
+                ssize_t len, off;
+                bool done;
+                ssize_t result;
+            };
+
+            //consumes the available completions, blocks for one if there's none; false on error
+            bool reap_or_block() {
+                unsigned head = *cq_head_;
+                const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                if (head == tail) {
+                    const long r = syscall(__NR_io_uring_enter, ring_fd_, 0u, 1u, (unsigned) IORING_ENTER_GETEVENTS, nullptr, 0);
+                    return r >= 0 || errno == EINTR;
+                }
+                for (; head != tail; ++head) {
+                    const io_uring_cqe &c = cqes_[head & cq_mask_];
+                    request &r = requests_[c.user_data];
+                    r.result = c.res;
+                    r.done = true;
+                    --in_flight_;
+                }
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                return true;
+            }
+
+            void unmap() {
+                if (sqes_)
+                    munmap(sqes_, sqes_len_);
+                if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_)
+                    munmap(cq_ptr_, cq_len_);
+                if (sq_ptr_ != MAP_FAILED)
+                    munmap(sq_ptr_, sq_len_);
+                if (ring_fd_ >= 0)
+                    ::close(ring_fd_);
+            }
+
+            int fd_, ring_fd_;
+            void *sq_ptr_, *cq_ptr_;
+            size_t sq_len_, cq_len_, sqes_len_;
+            io_uring_sqe *sqes_;
+            unsigned *sq_tail_, *sq_array_, sq_mask_;
+            unsigned *cq_head_, *cq_tail_, cq_mask_;
+            io_uring_cqe *cqes_;
+            std::vector<iovec> iov_;
+            std::vector<request> requests_;
+            ssize_t in_flight_;
+        };
+
+#endif
+
+        std::runtime_error system_error(const char *what, const std::string &path) {
+            return std::runtime_error(std::string(what) + " '" + path + "': " + strerror(errno));
+        }
+    }
+
+    prefetch_reader::prefetch_reader(const std::string &path, ssize_t offset, ssize_t length, const options &opts)
+            : path_(path), opts_(opts), fd_(-1), offset_(offset), length_(0), nchunks_(0),
+              next_submit_(0), next_deliver_(0), delivered_slot_(-1), active_(backend::threads) {
+        if (opts.chunk_bytes <= 0 || opts.depth <= 0 || opts.alignment < (ssize_t) sizeof(void *)
+                || (opts.alignment & (opts.alignment - 1)) != 0)
+            throw std::runtime_error("prefetch_reader: invalid options");
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            throw system_error("prefetch_reader: can't open", path);
+        try {
+            struct stat st;
+            if (fstat(fd_, &st) != 0)
+                throw system_error("prefetch_reader: can't stat", path);
+            if (offset < 0 || offset > st.st_size || (length >= 0 && length > st.st_size - offset))
+                throw std::runtime_error("prefetch_reader: range is outside of '" + path + "'");
+            length_ = length < 0 ? st.st_size - offset : length;
+            nchunks_ = (length_ + opts.chunk_bytes - 1) / opts.chunk_bytes;
+#ifdef POSIX_FADV_SEQUENTIAL
+            posix_fadvise(fd_, offset_, length_, POSIX_FADV_SEQUENTIAL);
+#endif
+
+            //depth reads in flight plus the chunk the consumer holds
+            slots_.resize(opts.depth + 1, slot{nullptr, -1});
+            for (auto &s : slots_) {
+                void *p;
+                if (posix_memalign(&p, opts.alignment, opts.chunk_bytes) != 0)
+                    throw std::runtime_error("prefetch_reader: can't allocate the chunk buffers");
+                s.buffer = static_cast<char *>(p);
+            }
+
+            if (opts.engine != backend::threads) {
+#ifdef SX_HAVE_IO_URING
+                try {
+                    engine_.reset(new uring_read_engine(fd_, (ssize_t) slots_.size()));
+                    active_ = backend::io_uring;
+                } catch (std::runtime_error &) {
+                    if (opts.engine == backend::io_uring)
+                        throw;
+                }
+#else
+                if (opts.engine == backend::io_uring)
+                    throw std::runtime_error("prefetch_reader: io_uring is not available on this platform");
+#endif
+            }
+            if (!engine_)
+                engine_.reset(new thread_read_engine(fd_, (ssize_t) slots_.size(), opts.depth));
+
+            while (next_submit_ < std::min(nchunks_, opts.depth))
+                submit(next_submit_++);
+        } catch (...) {
+            engine_.reset();
+            for (auto &s : slots_)
+                free(s.buffer);
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    prefetch_reader::~prefetch_reader() {
+        //waits for the reads in flight before the buffers go away
+        engine_.reset();
+        for (auto &s : slots_)
+            free(s.buffer);
+        ::close(fd_);
+    }
+
+    void prefetch_reader::submit(ssize_t chunk) {
+        ssize_t s = 0;
+        while (slots_[s].chunk >= 0 || s == delivered_slot_)
+            ++s;
+        const ssize_t off = chunk * opts_.chunk_bytes;
+        slots_[s].chunk = chunk;
+        engine_->submit(s, slots_[s].buffer, std::min(opts_.chunk_bytes, length_ - off), offset_ + off);
+    }
+
+    array1<char> prefetch_reader::next() {
+        if (delivered_slot_ >= 0) {
+            slots_[delivered_slot_].chunk = -1;
+            delivered_slot_ = -1;
+        }
+        if (next_deliver_ == nchunks_)
+            return array1<char>();
+        ssize_t s = 0;
+        while (slots_[s].chunk != next_deliver_)
+            ++s;
+        const ssize_t len = std::min(opts_.chunk_bytes, length_ - next_deliver_ * opts_.chunk_bytes);
+        const ssize_t r = engine_->wait(s);
+        if (r < 0) {
+            errno = (int) -r;
+            throw system_error("prefetch_reader: can't read", path_);
+        }
+        if (r != len)
+            throw std::runtime_error("prefetch_reader: '" + path_ + "' got shorter while reading");
+        delivered_slot_ = s;
+        ++next_deliver_;
+        //into the spare slot, so depth reads stay in flight while the consumer works on this chunk
+        if (next_submit_ < nchunks_)
+            submit(next_submit_++);
+        return array1<char>(slots_[s].buffer, len);
+    }
+
+#else
+
+    prefetch_reader::prefetch_reader(const std::string &path, ssize_t offset, ssize_t, const options &opts)
+            : path_(path), opts_(opts), fd_(-1), offset_(offset), length_(0), nchunks_(0),
+              next_submit_(0), next_deliver_(0), delivered_slot_(-1), active_(backend::threads) {
+        throw std::runtime_error("prefetch_reader: not implemented on this platform");
+    }
+
+    prefetch_reader::~prefetch_reader() {
+    }
+
+    void prefetch_reader::submit(ssize_t) {
+    }
+
+    array1<char> prefetch_reader::next() {
+        return array1<char>();
+    }
+
+#endif
+
+}
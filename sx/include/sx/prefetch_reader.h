@@ -0,0 +1,111 @@
+#ifndef PREFETCH_READER_INCLUDED_8126044
+#define PREFETCH_READER_INCLUDED_8126044
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "array1.h"
+#include "chunk_stream.h"
+
+namespace sx {
+
+    namespace detail {
+        class read_engine;
+    }
+
+    //reads a byte range of a file sequentially in chunks, keeping up to depth chunk reads in flight
+    //so the I/O of the next chunks overlaps with processing the current one
+    //uses io_uring where the kernel supports it and a pool of pread threads otherwise
+    class prefetch_reader {
+    public:
+        enum class backend {
+            automatic,  //io_uring if it can be set up, threads otherwise
+            io_uring,   //throws if it can't be set up
+            threads
+        };
+
+        struct options {
+            ssize_t chunk_bytes;
+            ssize_t depth;      //reads in flight
+            ssize_t alignment;  //of the chunk buffers, power of two
+            backend engine;
+
+            options() : chunk_bytes(ssize_t(1) << 20), depth(4), alignment(4096), engine(backend::automatic) {
+            }
+        };
+
+        //[offset, offset + length) of the file, to the end of the file if length < 0
+        explicit prefetch_reader(const std::string &path, ssize_t offset = 0, ssize_t length = -1,
+                const options &opts = options());
+
+        prefetch_reader(const prefetch_reader &) = delete;
+
+        prefetch_reader &operator=(const prefetch_reader &) = delete;
+
+        ~prefetch_reader();
+
+        //the next chunk, valid until the following next() call; empty at the end
+        //chunks are chunk_bytes long except the last one
+        array1<char> next();
+
+        //the next chunk as T elements, chunk_bytes must be a multiple of sizeof(T)
+        template<typename T>
+        array1<T> next_as() {
+            if (opts_.chunk_bytes % (ssize_t) sizeof(T) != 0)
+                throw std::runtime_error("prefetch_reader::next_as: chunk size is not a multiple of the element size");
+            const array1<char> c = next();
+            if (c.size() % (ssize_t) sizeof(T) != 0)
+                throw std::runtime_error("prefetch_reader::next_as: range is not a multiple of the element size");
+            return array1<T>(reinterpret_cast<const T *>(c.data()), c.size() / (ssize_t) sizeof(T));
+        }
+
+        //the one actually used, never automatic
+        backend active_backend() const {
+            return active_;
+        }
+
+        ssize_t size() const {
+            return length_;
+        }
+
+        //chunks submitted and not yet returned by next(), depth while chunks remain to be read
+        ssize_t in_flight() const {
+            return next_submit_ - next_deliver_;
+        }
+
+    private:
+        struct slot {
+            char *buffer;
+            ssize_t chunk;  //index of the chunk being read into it, -1 if free
+        };
+
+        void submit(ssize_t chunk);
+
+        std::string path_;
+        options opts_;
+        int fd_;
+        ssize_t offset_, length_, nchunks_;
+        ssize_t next_submit_, next_deliver_;
+        std::vector<slot> slots_;
+        ssize_t delivered_slot_;    //handed out by the last next(), recycled by the following one
+        std::unique_ptr<detail::read_engine> engine_;
+        backend active_;
+    };
+
+    //chunk_stream source over a file of raw T elements with reads in flight, see prefetch_reader
+    template<typename T>
+    chunk_stream<T> stream_prefetch(const std::string &path, ssize_t chunk_size = default_chunk_size,
+            prefetch_reader::options opts = prefetch_reader::options()) {
+        opts.chunk_bytes = chunk_size * (ssize_t) sizeof(T);
+        auto r = std::make_shared<prefetch_reader>(path, 0, -1, opts);
+        return chunk_stream<T>([r]() -> array1<T> {
+            return r->next_as<T>();
+        });
+    }
+
+}
+
+#endif
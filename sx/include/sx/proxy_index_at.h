@@ -9,6 +9,12 @@ namespace sx {
             : public container_traits_tags::indexable, public container_traits_tags::use_const_index_iterator {
     public:
         typedef proxy_const_indexable_at_indexable<C1, C2> this_type;
+        typedef typename C1::value_type value_type;
+        typedef typename C1::const_reference reference;
+        typedef typename C1::const_reference const_reference;
+        typedef typename C1::const_pointer pointer;
+        typedef typename C1::const_pointer const_pointer;
+        typedef ssize_t size_type;
 
         proxy_const_indexable_at_indexable(const C1 &c1, const C2 &c2) : c1(c1), c2(c2) {
         }
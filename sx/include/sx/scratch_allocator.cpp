@@ -0,0 +1,110 @@
+#include "sx/scratch_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace sx {
+
+    namespace {
+        //the first block, each further one doubles up to the largest, bigger requests get a block of their own
+        const size_t first_block_bytes = size_t(1) << 16;
+        const size_t max_block_bytes = size_t(1) << 26;
+
+        char *align_up(char *p, size_t align) {
+            return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + (align - 1)) & ~uintptr_t(align - 1));
+        }
+
+        void free_block(char *begin, char *end) {
+#if SX_ALLOC_STATS
+            detail::dealloc_record(size_t(end - begin), "scratch_arena");
+#else
+            (void) end;
+#endif
+            ::operator delete(begin);
+        }
+    }
+
+    scratch_arena &scratch_arena::current() {
+        static thread_local scratch_arena arena;
+        return arena;
+    }
+
+    scratch_arena::scratch_arena() : cur_(0), ptr_(nullptr), depth_(0) {
+    }
+
+    scratch_arena::~scratch_arena() {
+        for (const block &b : blocks_)
+            free_block(b.begin, b.end);
+    }
+
+    void *scratch_arena::allocate(size_t nbytes, size_t align) {
+        if (nbytes == 0)
+            nbytes = 1;
+        //ptr_ is nullptr at the start of an untouched block
+        while (cur_ < blocks_.size()) {
+            const block &b = blocks_[cur_];
+            if (!ptr_)
+                ptr_ = b.begin;
+            char *p = align_up(ptr_, align);
+            if (nbytes <= size_t(b.end - b.begin) && p <= b.end - nbytes) {
+                ptr_ = p + nbytes;
+                return p;
+            }
+            ++cur_;
+            ptr_ = nullptr;
+        }
+        //operator new aligns to max_align, larger alignments pad inside the block
+        const size_t pad = align > alignof(std::max_align_t) ? align : 0;
+        if (nbytes > std::numeric_limits<size_t>::max() - pad)
+            throw std::bad_alloc();
+        const size_t last = blocks_.empty() ? 0 : size_t(blocks_.back().end - blocks_.back().begin);
+        const size_t size = std::max(std::min(std::max(2 * last, first_block_bytes), max_block_bytes), nbytes + pad);
+        char *begin = static_cast<char *>(::operator new(size));
+#if SX_ALLOC_STATS
+        detail::alloc_record(size, "scratch_arena");
+#endif
+        blocks_.push_back({begin, begin + size});
+        cur_ = blocks_.size() - 1;
+        char *p = align_up(begin, align);
+        ptr_ = p + nbytes;
+        return p;
+    }
+
+    bool scratch_arena::owns(const void *p) const {
+        const char *q = static_cast<const char *>(p);
+        for (const block &b : blocks_)
+            if (b.begin <= q && q < b.end)
+                return true;
+        return false;
+    }
+
+    ssize_t scratch_arena::bytes_used() const {
+        ssize_t n = 0;
+        for (size_t i = 0; i < cur_ && i < blocks_.size(); ++i)
+            n += blocks_[i].end - blocks_[i].begin;
+        if (cur_ < blocks_.size() && ptr_)
+            n += ptr_ - blocks_[cur_].begin;
+        return n;
+    }
+
+    ssize_t scratch_arena::bytes_reserved() const {
+        ssize_t n = 0;
+        for (const block &b : blocks_)
+            n += b.end - b.begin;
+        return n;
+    }
+
+    void scratch_arena::trim() {
+        size_t keep = cur_;
+        if (cur_ < blocks_.size() && ptr_ && ptr_ != blocks_[cur_].begin)
+            ++keep;
+        for (size_t i = keep; i < blocks_.size(); ++i)
+            free_block(blocks_[i].begin, blocks_[i].end);
+        blocks_.resize(std::min(keep, blocks_.size()));
+        if (cur_ >= blocks_.size()) {
+            cur_ = blocks_.size();
+            ptr_ = nullptr;
+        }
+    }
+
+}
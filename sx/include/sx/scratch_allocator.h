@@ -0,0 +1,169 @@
+#ifndef SCRATCH_ALLOCATOR_INCLUDED_3905718
+#define SCRATCH_ALLOCATOR_INCLUDED_3905718
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "types.h"
+#include "allocator.h"
+#include "array1.h"
+#include "array2.h"
+
+//thread-local bump allocation for the temporaries of a pipeline
+//inside a scratch_scope, scratch_allocator takes memory from the arena of the thread by bumping a pointer
+//and frees nothing, the scope gives everything allocated since it was opened back in O(1) when it closes
+//outside of scopes scratch_allocator is sx::allocator
+//
+//    {
+//        sx::scratch_scope scope;
+//        auto order = sx::grade_up<sx::scratch_allocator>(x);
+//        auto hits = sx::where<sx::scratch_allocator>(mask);
+//        ...
+//    }   //order and hits must not be read after this point
+//
+//scratch containers must not be read after their scope closes, nor be used or destroyed on another thread
+//destroying them later is fine
+
+namespace sx {
+
+    class scratch_arena {
+    public:
+        //the arena of the calling thread
+        static scratch_arena &current();
+
+        scratch_arena();
+
+        scratch_arena(const scratch_arena &) = delete;
+
+        scratch_arena &operator=(const scratch_arena &) = delete;
+
+        ~scratch_arena();
+
+        //nbytes from the current block, from the next cached block it fits or from a new one
+        //align is a power of two
+        void *allocate(size_t nbytes, size_t align);
+
+        bool owns(const void *p) const;
+
+        //where the next allocation starts
+        struct position {
+            size_t block;
+            char *ptr;
+        };
+
+        position mark() const {
+            return {cur_, ptr_};
+        }
+
+        //gives back everything allocated since p, keeps the blocks for reuse
+        void release(const position &p) {
+            cur_ = p.block;
+            ptr_ = p.ptr;
+        }
+
+        //open scratch_scopes
+        int depth() const {
+            return depth_;
+        }
+
+        //allocated since the arena was empty, counting the unused tails of skipped blocks
+        ssize_t bytes_used() const;
+
+        //the blocks taken from the heap
+        ssize_t bytes_reserved() const;
+
+        //frees the cached blocks after the current one
+        void trim();
+
+    private:
+        friend class scratch_scope;
+
+        struct block {
+            char *begin;
+            char *end;
+        };
+
+        std::vector<block> blocks_;
+        size_t cur_;    //blocks_.size() if there is no block yet
+        char *ptr_;
+        int depth_;
+    };
+
+    //allocations of scratch_allocator on this thread come from the arena for the lifetime of the scope
+    //and are given back when it ends, scopes nest
+    class scratch_scope {
+    public:
+        scratch_scope() : arena_(scratch_arena::current()), mark_(arena_.mark()) {
+            ++arena_.depth_;
+        }
+
+        scratch_scope(const scratch_scope &) = delete;
+
+        scratch_scope &operator=(const scratch_scope &) = delete;
+
+        ~scratch_scope() {
+            --arena_.depth_;
+            arena_.release(mark_);
+        }
+
+    private:
+        scratch_arena &arena_;
+        scratch_arena::position mark_;
+    };
+
+    //outside of scopes the memory comes from sx::allocator, which like std::allocator in C++11 only aligns to
+    //alignof(std::max_align_t)
+    template<typename T>
+    class scratch_allocator {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "scratch_allocator: over-aligned types are not supported");
+
+    public:
+        typedef T value_type;
+
+        scratch_allocator() : arena_(&scratch_arena::current()) {
+        }
+
+        template<typename U>
+        scratch_allocator(const scratch_allocator<U> &x) : arena_(x.arena()) {
+        }
+
+        T *allocate(size_t n) {
+            if (arena_->depth() == 0)
+                return allocator<T>().allocate(n);
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        //memory of the arena comes back when its scope ends
+        void deallocate(T *p, size_t n) {
+            if (!arena_->owns(p))
+                allocator<T>().deallocate(p, n);
+        }
+
+        scratch_arena *arena() const {
+            return arena_;
+        }
+
+    private:
+        scratch_arena *arena_;
+    };
+
+    template<typename T, typename U>
+    bool operator==(const scratch_allocator<T> &x, const scratch_allocator<U> &y) {
+        return x.arena() == y.arena();
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const scratch_allocator<T> &x, const scratch_allocator<U> &y) {
+        return x.arena() != y.arena();
+    }
+
+    template<typename T> using scratch_darray1 = darray1<T, scratch_allocator<T>>;
+    template<typename T> using scratch_darray2 = darray2<T, scratch_allocator<T>>;
+
+}
+
+#endif
@@ -0,0 +1,448 @@
+#ifndef SEGMENTED_ARRAY_INCLUDED_4471620
+#define SEGMENTED_ARRAY_INCLUDED_4471620
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "traits.h"
+#include "index_iterator.h"
+#include "array1.h"
+#include "array2.h"
+#include "chunk_stream.h"
+
+namespace sx {
+
+    //growable 1D array stored in fixed chunks of (1 << ChunkBits) elements
+    //appending never moves elements: addresses stay valid until the element is removed,
+    //growth costs one chunk allocation and no copying, unlike darray1::push_back past the capacity
+    //T must be default constructible, chunks are allocated whole
+    template<typename T, int ChunkBits = 16>
+    class segmented_darray1
+            : public container_traits_tags::indexable {
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef ssize_t size_type;
+        typedef segmented_darray1<T, ChunkBits> this_type;
+
+        static const ssize_t chunk_size = ssize_t(1) << ChunkBits;
+
+        segmented_darray1() : size_(0) {
+        }
+
+        segmented_darray1(const this_type &x) : size_(0) {
+            reserve(x.size_);
+            x.for_each_chunk([this](const array1<T> &c) {
+                push_back(BEGINEND(c));
+            });
+        }
+
+        segmented_darray1(this_type &&x) : chunks_(std::move(x.chunks_)), size_(x.size_) {
+            x.size_ = 0;
+        }
+
+        this_type &operator=(const this_type &x) {
+            if (this != &x) {
+                this_type y(x);
+                *this = std::move(y);
+            }
+            return *this;
+        }
+
+        this_type &operator=(this_type &&x) {
+            chunks_ = std::move(x.chunks_);
+            size_ = x.size_;
+            x.size_ = 0;
+            return *this;
+        }
+
+        template<typename InputIt>
+        segmented_darray1(InputIt first, InputIt last) : size_(0) {
+            push_back(first, last);
+        }
+
+        ssize_t size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        //allocated elements
+        ssize_t capacity() const {
+            return (ssize_t) chunks_.size() << ChunkBits;
+        }
+
+        //allocates the chunks up front
+        void reserve(ssize_t n) {
+            while (capacity() < n)
+                chunks_.emplace_back(new T[chunk_size]);
+        }
+
+        void clear() {
+            chunks_.clear();
+            size_ = 0;
+        }
+
+        reference operator[](ssize_t idx) {
+            assert(0 <= idx && idx < size_);
+            return chunks_[idx >> ChunkBits][idx & (chunk_size - 1)];
+        }
+
+        const_reference operator[](ssize_t idx) const {
+            assert(0 <= idx && idx < size_);
+            return chunks_[idx >> ChunkBits][idx & (chunk_size - 1)];
+        }
+
+        reference back() {
+            return (*this)[size_ - 1];
+        }
+
+        const_reference back() const {
+            return (*this)[size_ - 1];
+        }
+
+        void push_back(const T &x) {
+            *grow() = x;
+        }
+
+        void push_back(T &&x) {
+            *grow() = std::move(x);
+        }
+
+        template<typename...Args>
+        void emplace_back(Args &&... args) {
+            *grow() = T(std::forward<Args>(args)...);
+        }
+
+        //copies chunk by chunk for random access iterators
+        template<typename InputIt>
+        void push_back(InputIt first, InputIt last) {
+            append(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        //the chunk stays allocated for the next append
+        void pop_back() {
+            assert(size_ > 0);
+            --size_;
+        }
+
+        ssize_t nchunks() const {
+            return (size_ + chunk_size - 1) >> ChunkBits;
+        }
+
+        //the used part of chunk k, contiguous
+        array1<T> chunk(ssize_t k) const {
+            assert(0 <= k && k < nchunks());
+            return array1<T>(chunks_[k].get(), std::min(chunk_size, size_ - (k << ChunkBits)));
+        }
+
+        marray1<T> chunk(ssize_t k) {
+            assert(0 <= k && k < nchunks());
+            return marray1<T>(chunks_[k].get(), std::min(chunk_size, size_ - (k << ChunkBits)));
+        }
+
+        //calls f(chunk view) for each chunk in order
+        template<typename F>
+        void for_each_chunk(F &&f) const {
+            for (ssize_t k = 0; k < nchunks(); ++k)
+                f(chunk(k));
+        }
+
+        template<typename F>
+        void for_each_chunk(F &&f) {
+            for (ssize_t k = 0; k < nchunks(); ++k)
+                f(chunk(k));
+        }
+
+        //contiguous copy, for code that needs a flat layout
+        darray1<T> compact() const {
+            darray1<T> result;
+            result.reserve(size_);
+            for_each_chunk([&result](const array1<T> &c) {
+                result.push_back(BEGINEND(c));
+            });
+            return result;
+        }
+
+    private:
+        //slot for one more element
+        T *grow() {
+            if (size_ == capacity())
+                chunks_.emplace_back(new T[chunk_size]);
+            T *p = &chunks_[size_ >> ChunkBits][size_ & (chunk_size - 1)];
+            ++size_;
+            return p;
+        }
+
+        template<typename InputIt>
+        void append(InputIt first, InputIt last, std::random_access_iterator_tag) {
+            ssize_t n = last - first;
+            reserve(size_ + n);
+            while (n > 0) {
+                const ssize_t offset = size_ & (chunk_size - 1), m = std::min(n, chunk_size - offset);
+                std::copy(first, first + m, chunks_[size_ >> ChunkBits].get() + offset);
+                first += m;
+                size_ += m;
+                n -= m;
+            }
+        }
+
+        template<typename InputIt>
+        void append(InputIt first, InputIt last, std::input_iterator_tag) {
+            for (; first != last; ++first)
+                push_back(*first);
+        }
+
+        std::vector<std::unique_ptr<T[]>> chunks_;
+        ssize_t size_;
+    };
+
+    template<typename T, int ChunkBits>
+    const ssize_t segmented_darray1<T, ChunkBits>::chunk_size;
+
+    //growable 2D array of rows, appended with append_row like darray2
+    //each chunk holds a whole number of rows (at least one), so rows are contiguous views
+    //and rows never move once appended
+    //the broadcasting ops of broadcast.h work on it element by element, like on tiled_darray2
+    template<typename T, int ChunkBits = 16>
+    class segmented_darray2
+            : public container_traits_tags::indexable,
+              public container_traits_tags::two_dimensional {
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef ssize_t size_type;
+        typedef segmented_darray2<T, ChunkBits> this_type;
+
+        segmented_darray2() : nr_(0), nc_(0), rows_per_chunk_(0) {
+        }
+
+        //fixes the number of columns, otherwise the first append_row does
+        explicit segmented_darray2(ssize_t ncols) : nr_(0), nc_(0), rows_per_chunk_(0) {
+            set_ncols(ncols);
+        }
+
+        segmented_darray2(this_type &&x)
+                : chunks_(std::move(x.chunks_)), nr_(x.nr_), nc_(x.nc_), rows_per_chunk_(x.rows_per_chunk_) {
+            x.nr_ = 0;
+        }
+
+        this_type &operator=(this_type &&x) {
+            chunks_ = std::move(x.chunks_);
+            nr_ = x.nr_;
+            nc_ = x.nc_;
+            rows_per_chunk_ = x.rows_per_chunk_;
+            x.nr_ = 0;
+            return *this;
+        }
+
+        ssize_t nr() const {
+            return nr_;
+        }
+
+        ssize_t nc() const {
+            return nc_;
+        }
+
+        ssize_t size() const {
+            return nr_ * nc_;
+        }
+
+        ssize_t rows_per_chunk() const {
+            return rows_per_chunk_;
+        }
+
+        void append_row(array1<T> v) {
+            if (nc_ == 0) {
+                if (v.size() == 0)
+                    throw std::runtime_error("append_row: empty arg");
+                set_ncols(v.size());
+            } else if (v.size() != nc_)
+                throw std::runtime_error("append_row: invalid arg size");
+            if (nr_ == (ssize_t) chunks_.size() * rows_per_chunk_)
+                chunks_.emplace_back(new T[rows_per_chunk_ * nc_]);
+            std::copy(BEGINEND(v), row_pointer(nr_));
+            ++nr_;
+        }
+
+        const_reference operator()(ssize_t row, ssize_t col) const {
+            assert(0 <= row && row < nr_ && 0 <= col && col < nc_);
+            return row_pointer(row)[col];
+        }
+
+        reference operator()(ssize_t row, ssize_t col) {
+            assert(0 <= row && row < nr_ && 0 <= col && col < nc_);
+            return row_pointer(row)[col];
+        }
+
+        //linear index, row-major
+        const_reference operator[](ssize_t idx) const {
+            return (*this)(idx / nc_, idx % nc_);
+        }
+
+        reference operator[](ssize_t idx) {
+            return (*this)(idx / nc_, idx % nc_);
+        }
+
+        array1<T> row(ssize_t r) const {
+            assert(0 <= r && r < nr_);
+            return array1<T>(row_pointer(r), nc_);
+        }
+
+        marray1<T> row(ssize_t r) {
+            assert(0 <= r && r < nr_);
+            return marray1<T>(row_pointer(r), nc_);
+        }
+
+        ssize_t nchunks() const {
+            return rows_per_chunk_ == 0 ? 0 : (nr_ + rows_per_chunk_ - 1) / rows_per_chunk_;
+        }
+
+        //the rows of chunk k as a row-major view
+        array2<T> chunk(ssize_t k) const {
+            assert(0 <= k && k < nchunks());
+            return array2<T>(chunks_[k].get(), std::min(rows_per_chunk_, nr_ - k * rows_per_chunk_), nc_);
+        }
+
+        marray2<T> chunk(ssize_t k) {
+            assert(0 <= k && k < nchunks());
+            return marray2<T>(chunks_[k].get(), std::min(rows_per_chunk_, nr_ - k * rows_per_chunk_), nc_);
+        }
+
+        //calls f(first row, chunk view) for each chunk in order
+        template<typename F>
+        void for_each_chunk(F &&f) const {
+            for (ssize_t k = 0; k < nchunks(); ++k)
+                f(k * rows_per_chunk_, chunk(k));
+        }
+
+        template<typename F>
+        void for_each_chunk(F &&f) {
+            for (ssize_t k = 0; k < nchunks(); ++k)
+                f(k * rows_per_chunk_, chunk(k));
+        }
+
+        //contiguous row-major copy
+        darray2<T> compact() const {
+            darray2<T> result(nr_, nc_);
+            for_each_chunk([&result, this](ssize_t r0, const array2<T> &c) {
+                std::copy(c.data(), c.data() + c.nr() * nc_, &result(r0, 0));
+            });
+            return result;
+        }
+
+    private:
+        void set_ncols(ssize_t ncols) {
+            if (ncols <= 0)
+                throw std::runtime_error("segmented_darray2: invalid number of columns");
+            nc_ = ncols;
+            rows_per_chunk_ = std::max<ssize_t>(1, (ssize_t(1) << ChunkBits) / ncols);
+        }
+
+        T *row_pointer(ssize_t r) const {
+            return chunks_[r / rows_per_chunk_].get() + (r % rows_per_chunk_) * nc_;
+        }
+
+        std::vector<std::unique_ptr<T[]>> chunks_;
+        ssize_t nr_, nc_, rows_per_chunk_;
+    };
+
+    template<typename T, int ChunkBits>
+    const_index_iterator<const segmented_darray1<T, ChunkBits>> begin(const segmented_darray1<T, ChunkBits> &that) {
+        return const_index_iterator<const segmented_darray1<T, ChunkBits>>(&that, 0);
+    }
+
+    template<typename T, int ChunkBits>
+    const_index_iterator<const segmented_darray1<T, ChunkBits>> end(const segmented_darray1<T, ChunkBits> &that) {
+        return const_index_iterator<const segmented_darray1<T, ChunkBits>>(&that, that.size());
+    }
+
+    template<typename T, int ChunkBits>
+    mutable_index_iterator<segmented_darray1<T, ChunkBits>> begin(segmented_darray1<T, ChunkBits> &that) {
+        return mutable_index_iterator<segmented_darray1<T, ChunkBits>>(&that, 0);
+    }
+
+    template<typename T, int ChunkBits>
+    mutable_index_iterator<segmented_darray1<T, ChunkBits>> end(segmented_darray1<T, ChunkBits> &that) {
+        return mutable_index_iterator<segmented_darray1<T, ChunkBits>>(&that, that.size());
+    }
+
+    template<typename T, int ChunkBits>
+    const_index_iterator<const segmented_darray2<T, ChunkBits>> begin(const segmented_darray2<T, ChunkBits> &that) {
+        return const_index_iterator<const segmented_darray2<T, ChunkBits>>(&that, 0);
+    }
+
+    template<typename T, int ChunkBits>
+    const_index_iterator<const segmented_darray2<T, ChunkBits>> end(const segmented_darray2<T, ChunkBits> &that) {
+        return const_index_iterator<const segmented_darray2<T, ChunkBits>>(&that, that.size());
+    }
+
+    //chunk_stream source over the chunks, no copying
+    template<typename T, int ChunkBits>
+    chunk_stream<T> stream_chunks(const segmented_darray1<T, ChunkBits> &x) {
+        auto k = std::make_shared<ssize_t>(0);
+        const segmented_darray1<T, ChunkBits> *p = &x;
+        return chunk_stream<T>([p, k]() -> array1<T> {
+            return *k < p->nchunks() ? p->chunk((*k)++) : array1<T>();
+        });
+    }
+
+    //reductions chunk by chunk, the generic ones in eager_ops.h index every element
+
+    // sum(segmented)
+    template<typename T, int ChunkBits>
+    T sum(const segmented_darray1<T, ChunkBits> &x) {
+        T result = T(0);
+        x.for_each_chunk([&result](const array1<T> &c) {
+            const T *p = c.data();
+            for (ssize_t i = 0; i < c.size(); ++i)
+                result += p[i];
+        });
+        return result;
+    }
+
+    // min(segmented)
+    template<typename T, int ChunkBits>
+    const T &min(const segmented_darray1<T, ChunkBits> &x) {
+        if (x.empty())
+            throw std::runtime_error("min: input cannot be empty");
+        const T *result = &x[0];
+        x.for_each_chunk([&result](const array1<T> &c) {
+            const T *m = std::min_element(c.data(), c.data() + c.size());
+            if (*m < *result)
+                result = m;
+        });
+        return *result;
+    }
+
+    // max(segmented)
+    template<typename T, int ChunkBits>
+    const T &max(const segmented_darray1<T, ChunkBits> &x) {
+        if (x.empty())
+            throw std::runtime_error("max: input cannot be empty");
+        const T *result = &x[0];
+        x.for_each_chunk([&result](const array1<T> &c) {
+            const T *m = std::max_element(c.data(), c.data() + c.size());
+            if (*result < *m)
+                result = m;
+        });
+        return *result;
+    }
+
+}
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef SMALL_ARRAY_INCLUDED_5582043
+#define SMALL_ARRAY_INCLUDED_5582043
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "types.h"
+#include "traits.h"
+#include "index_iterator.h"
+#include "array1.h"
+
+namespace sx {
+
+    //growable 1D array keeping its first N elements inside the object
+    //nothing is allocated while size() <= N, past that the elements move to a buffer from Alloc and stay there,
+    //so the short lists built per row or per request cost no allocation
+    //moving an array whose elements are inline moves them one by one
+    template<typename T, ssize_t N, typename Alloc>
+    class small_darray1
+            : public container_traits_tags::indexable {
+        static_assert(N > 0, "small_darray1: the inline capacity must be positive");
+
+        typedef std::allocator_traits<Alloc> alloc_traits;
+
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef ssize_t size_type;
+        typedef Alloc allocator_type;
+        typedef small_darray1<T, N, Alloc> this_type;
+
+        static const ssize_t inline_capacity = N;
+
+        small_darray1() : data_(inline_data()), size_(0), capacity_(N) {
+        }
+
+        explicit small_darray1(const allocator_type &alloc) : alloc_(alloc), data_(inline_data()), size_(0), capacity_(N) {
+        }
+
+        small_darray1(const this_type &x) : small_darray1(x.alloc_) {
+            push_back(x.data_, x.data_ + x.size_);
+        }
+
+        small_darray1(this_type &&x) : small_darray1(x.alloc_) {
+            take(x);
+        }
+
+        this_type &operator=(const this_type &x) {
+            if (this != &x) {
+                clear();
+                push_back(x.data_, x.data_ + x.size_);
+            }
+            return *this;
+        }
+
+        //takes the allocator of x along with its buffer
+        this_type &operator=(this_type &&x) {
+            if (this != &x) {
+                clear();
+                release();
+                alloc_ = x.alloc_;
+                take(x);
+            }
+            return *this;
+        }
+
+        ~small_darray1() {
+            clear();
+            release();
+        }
+
+        small_darray1(const_pointer p, ssize_t size) : small_darray1() {
+            push_back(p, p + size);
+        }
+
+        template<typename InputIt, typename std::enable_if<!std::is_integral<InputIt>::value>::type * = nullptr>
+        small_darray1(InputIt first, InputIt last) : small_darray1() {
+            push_back(first, last);
+        }
+
+        template<typename E, typename std::enable_if<container_traits<E>::indexable>::type * = nullptr>
+        explicit small_darray1(const E &e) : small_darray1() {
+            reserve(e.size());
+            for (auto i : iota(e.size())) push_back(e[i]);
+        }
+
+        explicit small_darray1(ssize_t count) : small_darray1() {
+            resize(count);
+        }
+
+        small_darray1(ssize_t count, const T &value) : small_darray1() {
+            resize(count, value);
+        }
+
+        small_darray1(ssize_t count, const T &value, const allocator_type &alloc) : small_darray1(alloc) {
+            resize(count, value);
+        }
+
+        template<typename S>
+        small_darray1(std::initializer_list<S> il) : small_darray1(il.begin(), il.end()) {
+        }
+
+        //destroys the elements, a heap buffer is kept
+        void clear() {
+            for (ssize_t i = size_; i > 0; --i)
+                data_[i - 1].~T();
+            size_ = 0;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        ssize_t size() const {
+            return size_;
+        }
+
+        ssize_t capacity() const {
+            return capacity_;
+        }
+
+        //the elements are still in the object
+        bool is_inline() const {
+            return data_ == inline_data();
+        }
+
+        reference operator[](ssize_t idx) {
+            assert(0 <= idx && idx < size_);
+            return data_[idx];
+        }
+
+        reference operator[](smart_index sidx) {
+            return operator[](sidx.effective_idx_unchecked(size()));
+        }
+
+        const_reference operator[](ssize_t idx) const {
+            assert(0 <= idx && idx < size_);
+            return data_[idx];
+        }
+
+        const_reference operator[](smart_index sidx) const {
+            return operator[](sidx.effective_idx_unchecked(size()));
+        }
+
+        reference back() {
+            return (*this)[size_ - 1];
+        }
+
+        const_reference back() const {
+            return (*this)[size_ - 1];
+        }
+
+        pointer data() {
+            return data_;
+        }
+
+        const_pointer data() const {
+            return data_;
+        }
+
+        ssize_t stride() const {
+            return 1;
+        }
+
+        marray1<T> slice(smart_index lower, smart_index upper) {
+            return marray1<T>(*this).slice(lower, upper);
+        }
+
+        array1<T> slice(smart_index lower, smart_index upper) const {
+            return array1<T>(*this).slice(lower, upper);
+        }
+
+        marray1<T> slicen(smart_index lower, ssize_t n) {
+            return slice(lower, lower + n);
+        }
+
+        array1<T> slicen(smart_index lower, ssize_t n) const {
+            return slice(lower, lower + n);
+        }
+
+        marray1<T> reverse() {
+            return marray1<T>(*this).reverse();
+        }
+
+        array1<T> reverse() const {
+            return array1<T>(*this).reverse();
+        }
+
+        marray1<T> step(ssize_t n) {
+            return marray1<T>(*this).step(n);
+        }
+
+        array1<T> step(ssize_t n) const {
+            return array1<T>(*this).step(n);
+        }
+
+        iterator push_back(const T &x) {
+            return emplace_back(x);
+        }
+
+        iterator push_back(T &&x) {
+            return emplace_back(std::move(x));
+        }
+
+        template<typename...Args>
+        iterator emplace_back(Args &&... args) {
+            if (size_ == capacity_) {
+                grow(size_ + 1, [&](T *q, ssize_t &k) {
+                    new(q) T(std::forward<Args>(args)...);
+                    ++k;
+                });
+                return data_ + size_ - 1;
+            }
+            new(data_ + size_) T(std::forward<Args>(args)...);
+            return data_ + size_++;
+        }
+
+        template<typename InputIt>
+        void push_back(InputIt first, InputIt last) {
+            append(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        void pop_back() {
+            assert(size_ > 0);
+            data_[--size_].~T();
+        }
+
+        void reserve(ssize_t n) {
+            if (n > capacity_)
+                grow(n, [](T *, ssize_t &) {
+                });
+        }
+
+        void resize(ssize_t count) {
+            shrink(count);
+            reserve(count);
+            for (; size_ < count; ++size_)
+                new(data_ + size_) T();
+        }
+
+        void resize(ssize_t count, const T &value) {
+            shrink(count);
+            if (count > capacity_) {
+                const ssize_t n = count - size_;
+                grow(count, [&](T *q, ssize_t &k) {
+                    for (; k < n; ++k)
+                        new(q + k) T(value);
+                });
+            }
+            for (; size_ < count; ++size_)
+                new(data_ + size_) T(value);
+        }
+
+        allocator_type get_allocator() const {
+            return alloc_;
+        }
+
+    private:
+        T *inline_data() {
+            return reinterpret_cast<T *>(inline_);
+        }
+
+        const T *inline_data() const {
+            return reinterpret_cast<const T *>(inline_);
+        }
+
+        //moves the elements to a heap buffer of at least n > capacity_, tail(q, k) constructs the k new ones
+        //behind them at q first, while the old elements, which they may be copied from, are still in place
+        template<typename F>
+        void grow(ssize_t n, F &&tail) {
+            const ssize_t c = std::max(n, 2 * capacity_);
+            T *p = alloc_traits::allocate(alloc_, c);
+            T *q = p + size_;
+            ssize_t k = 0, i = 0;
+            try {
+                tail(q, k);
+                for (; i < size_; ++i)
+                    new(p + i) T(std::move_if_noexcept(data_[i]));
+            } catch (...) {
+                for (; i > 0; --i)
+                    p[i - 1].~T();
+                for (; k > 0; --k)
+                    q[k - 1].~T();
+                alloc_traits::deallocate(alloc_, p, c);
+                throw;
+            }
+            const ssize_t size = size_ + k;
+            clear();
+            release();
+            data_ = p;
+            size_ = size;
+            capacity_ = c;
+        }
+
+        void shrink(ssize_t count) {
+            while (size_ > count)
+                pop_back();
+        }
+
+        //gives the heap buffer back, the array must be empty
+        void release() {
+            assert(size_ == 0);
+            if (!is_inline()) {
+                alloc_traits::deallocate(alloc_, data_, capacity_);
+                data_ = inline_data();
+                capacity_ = N;
+            }
+        }
+
+        //the elements of x, leaving it empty and inline, this one must be empty and inline
+        void take(this_type &x) {
+            if (x.is_inline()) {
+                for (; size_ < x.size_; ++size_)
+                    new(data_ + size_) T(std::move(x.data_[size_]));
+                x.clear();
+            } else {
+                data_ = x.data_;
+                size_ = x.size_;
+                capacity_ = x.capacity_;
+                x.data_ = x.inline_data();
+                x.size_ = 0;
+                x.capacity_ = N;
+            }
+        }
+
+        template<typename InputIt>
+        void append(InputIt first, InputIt last, std::input_iterator_tag) {
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+
+        //one allocation at most, the range may be part of this array
+        template<typename FwdIt>
+        void append(FwdIt first, FwdIt last, std::forward_iterator_tag) {
+            const ssize_t n = std::distance(first, last);
+            if (size_ + n > capacity_) {
+                grow(size_ + n, [&](T *q, ssize_t &k) {
+                    for (; first != last; ++first, ++k)
+                        new(q + k) T(*first);
+                });
+                return;
+            }
+            for (; first != last; ++first, ++size_)
+                new(data_ + size_) T(*first);
+        }
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type inline_[N];
+        Alloc alloc_;
+        T *data_;
+        ssize_t size_;
+        ssize_t capacity_;
+    };
+
+    template<typename T, ssize_t N, typename Alloc>
+    const ssize_t small_darray1<T, N, Alloc>::inline_capacity;
+
+    template<typename T, ssize_t N, typename A>
+    const_index_iterator<const small_darray1<T, N, A>> begin(const small_darray1<T, N, A> &that) {
+        return const_index_iterator<const small_darray1<T, N, A>>(&that, 0);
+    }
+
+    template<typename T, ssize_t N, typename A>
+    const_index_iterator<const small_darray1<T, N, A>> end(const small_darray1<T, N, A> &that) {
+        return const_index_iterator<const small_darray1<T, N, A>>(&that, that.size());
+    }
+
+    template<typename T, ssize_t N, typename A>
+    mutable_index_iterator<small_darray1<T, N, A>> begin(small_darray1<T, N, A> &that) {
+        return mutable_index_iterator<small_darray1<T, N, A>>(&that, 0);
+    }
+
+    template<typename T, ssize_t N, typename A>
+    mutable_index_iterator<small_darray1<T, N, A>> end(small_darray1<T, N, A> &that) {
+        return mutable_index_iterator<small_darray1<T, N, A>>(&that, that.size());
+    }
+
+}
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef SPARSE_ARRAY2_INCLUDED_8841023
+#define SPARSE_ARRAY2_INCLUDED_8841023
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "array1.h"
+#include "array2.h"
+#include "broadcast.h"
+#include "parallel.h"
+#include "tuning.h"
+
+namespace sx {
+
+    //non-owning view of a compressed sparse 2D array, the sparse counterpart of array2
+    //RowMajor == true is CSR: outer_ptr has nr() + 1 entries, inner indices are column indices
+    //RowMajor == false is CSC: outer_ptr has nc() + 1 entries, inner indices are row indices
+    //the entries of outer slot k are [outer_ptr[k], outer_ptr[k + 1]), sorted by inner index
+    template<typename T, bool RowMajor = true>
+    class sparse_array2 {
+    public:
+        typedef T value_type;
+        typedef ssize_t size_type;
+        typedef sparse_array2<T, RowMajor> this_type;
+
+        static const bool row_major = RowMajor;
+
+        sparse_array2() : nr_(0), nc_(0), outer_ptr_(nullptr), inner_(nullptr), values_(nullptr) {
+        }
+
+        sparse_array2(ssize_t nr, ssize_t nc, const ssize_t *outer_ptr, const ssize_t *inner, const T *values)
+                : nr_(nr), nc_(nc), outer_ptr_(outer_ptr), inner_(inner), values_(values) {
+        }
+
+        ssize_t nr() const {
+            return nr_;
+        }
+
+        ssize_t nc() const {
+            return nc_;
+        }
+
+        ssize_t outer_size() const {
+            return RowMajor ? nr_ : nc_;
+        }
+
+        ssize_t nnz() const {
+            return outer_ptr_ ? outer_ptr_[outer_size()] : 0;
+        }
+
+        array1<ssize_t> outer_ptr() const {
+            return outer_ptr_ ? array1<ssize_t>(outer_ptr_, outer_size() + 1) : array1<ssize_t>();
+        }
+
+        array1<ssize_t> inner_indices() const {
+            return array1<ssize_t>(inner_, nnz());
+        }
+
+        array1<T> values() const {
+            return array1<T>(values_, nnz());
+        }
+
+        //inner indices and values of outer slot k (a row for CSR, a column for CSC)
+        array1<ssize_t> inner_indices(ssize_t k) const {
+            assert(0 <= k && k < outer_size());
+            return array1<ssize_t>(inner_ + outer_ptr_[k], outer_ptr_[k + 1] - outer_ptr_[k]);
+        }
+
+        array1<T> values(ssize_t k) const {
+            assert(0 <= k && k < outer_size());
+            return array1<T>(values_ + outer_ptr_[k], outer_ptr_[k + 1] - outer_ptr_[k]);
+        }
+
+        //element lookup with binary search, T() for entries not stored
+        T operator()(ssize_t row, ssize_t col) const {
+            assert(0 <= row && row < nr() && 0 <= col && col < nc());
+            const ssize_t k = RowMajor ? row : col, i = RowMajor ? col : row;
+            const ssize_t *first = inner_ + outer_ptr_[k], *last = inner_ + outer_ptr_[k + 1];
+            const ssize_t *it = std::lower_bound(first, last, i);
+            return it != last && *it == i ? values_[it - inner_] : T();
+        }
+
+        //the same arrays read with the other orientation: the transpose of a CSR array is a CSC array
+        sparse_array2<T, !RowMajor> transpose() const {
+            return sparse_array2<T, !RowMajor>(nc_, nr_, outer_ptr_, inner_, values_);
+        }
+
+    private:
+        ssize_t nr_, nc_;
+        const ssize_t *outer_ptr_;
+        const ssize_t *inner_;
+        const T *values_;
+    };
+
+    template<typename T, bool RowMajor>
+    const bool sparse_array2<T, RowMajor>::row_major;
+
+    template<typename T> using csr_array2 = sparse_array2<T, true>;
+    template<typename T> using csc_array2 = sparse_array2<T, false>;
+
+    //owning compressed sparse 2D array, the sparse counterpart of darray2
+    template<typename T, bool RowMajor = true>
+    class dsparse_array2 {
+    public:
+        typedef T value_type;
+        typedef ssize_t size_type;
+        typedef dsparse_array2<T, RowMajor> this_type;
+        typedef sparse_array2<T, RowMajor> view_type;
+
+        dsparse_array2() : nr_(0), nc_(0), outer_ptr_(1, 0) {
+        }
+
+        //takes over already compressed arrays, see sparse_array2 for the layout
+        //throws unless every view of them stays in bounds, the views do not check
+        dsparse_array2(ssize_t nr, ssize_t nc, darray1<ssize_t> &&outer_ptr, darray1<ssize_t> &&inner, darray1<T> &&values)
+                : nr_(nr), nc_(nc), outer_ptr_(std::move(outer_ptr)), inner_(std::move(inner)), values_(std::move(values)) {
+            if (nr < 0 || nc < 0 || outer_ptr_.size() != (RowMajor ? nr : nc) + 1 || inner_.size() != values_.size()
+                    || outer_ptr_[0] != 0 || outer_ptr_[outer_ptr_.size() - 1] != values_.size())
+                throw std::runtime_error("dsparse_array2: inconsistent compressed arrays");
+            for (ssize_t i = 1; i < outer_ptr_.size(); ++i)
+                if (outer_ptr_[i] < outer_ptr_[i - 1])
+                    throw std::runtime_error("dsparse_array2: decreasing outer pointers");
+            const ssize_t ni = RowMajor ? nc : nr;
+            for (ssize_t k = 0; k < inner_.size(); ++k)
+                if (inner_[k] < 0 || inner_[k] >= ni)
+                    throw std::runtime_error("dsparse_array2: inner index out of range");
+        }
+
+        //intentionally non-explicit, like darray2 to array2
+        operator view_type() const {
+            return view();
+        }
+
+        view_type view() const {
+            return view_type(nr_, nc_, outer_ptr_.data(), inner_.data(), values_.data());
+        }
+
+        ssize_t nr() const {
+            return nr_;
+        }
+
+        ssize_t nc() const {
+            return nc_;
+        }
+
+        ssize_t nnz() const {
+            return values_.size();
+        }
+
+        T operator()(ssize_t row, ssize_t col) const {
+            return view()(row, col);
+        }
+
+        sparse_array2<T, !RowMajor> transpose() const {
+            return view().transpose();
+        }
+
+        //values can be changed in place, the sparsity pattern can't
+        marray1<T> values() {
+            return marray1<T>(values_);
+        }
+
+        array1<T> values() const {
+            return array1<T>(values_);
+        }
+
+    private:
+        ssize_t nr_, nc_;
+        darray1<ssize_t> outer_ptr_;
+        darray1<ssize_t> inner_;
+        darray1<T> values_;
+    };
+
+    template<typename T> using dcsr_array2 = dsparse_array2<T, true>;
+    template<typename T> using dcsc_array2 = dsparse_array2<T, false>;
+
+    namespace detail {
+        //bucket (outer, inner, value) triplets by outer index, sort each bucket by inner index and sum duplicates
+        template<typename T, bool RowMajor, typename EO, typename EI, typename EV>
+        dsparse_array2<T, RowMajor> compress_triplets(ssize_t nr, ssize_t nc, const EO &outer, const EI &inner, const EV &vals) {
+            const ssize_t n = vals.size();
+            if (outer.size() != n || inner.size() != n)
+                throw std::runtime_error("sparse: triplet arrays of different sizes");
+            const ssize_t nouter = RowMajor ? nr : nc, ninner = RowMajor ? nc : nr;
+
+            darray1<ssize_t> ptr(nouter + 1, 0);
+            for (ssize_t k = 0; k < n; ++k) {
+                const ssize_t o = outer[k], i = inner[k];
+                if (!(0 <= o && o < nouter && 0 <= i && i < ninner))
+                    throw std::runtime_error("sparse: triplet index out of range");
+                ++ptr[o + 1];
+            }
+            for (ssize_t o = 0; o < nouter; ++o)
+                ptr[o + 1] += ptr[o];
+
+            std::vector<std::pair<ssize_t, T>> entries(n);
+            {
+                std::vector<ssize_t> next(ptr.data(), ptr.data() + nouter);
+                for (ssize_t k = 0; k < n; ++k)
+                    entries[next[outer[k]]++] = std::make_pair((ssize_t) inner[k], (T) vals[k]);
+            }
+
+            darray1<ssize_t> idx;
+            darray1<T> values;
+            idx.reserve(n);
+            values.reserve(n);
+            ssize_t begin_o = 0;
+            for (ssize_t o = 0; o < nouter; ++o) {
+                const ssize_t end_o = ptr[o + 1];
+                std::sort(entries.begin() + begin_o, entries.begin() + end_o,
+                        [](const std::pair<ssize_t, T> &x, const std::pair<ssize_t, T> &y) { return x.first < y.first; });
+                ptr[o] = idx.size();
+                for (ssize_t k = begin_o; k < end_o; ++k) {
+                    if (idx.size() > ptr[o] && idx[from_end(-1)] == entries[k].first)
+                        values[from_end(-1)] += entries[k].second;
+                    else {
+                        idx.push_back(entries[k].first);
+                        values.push_back(entries[k].second);
+                    }
+                }
+                begin_o = end_o;
+            }
+            ptr[nouter] = idx.size();
+            return dsparse_array2<T, RowMajor>(nr, nc, std::move(ptr), std::move(idx), std::move(values));
+        }
+
+        template<typename T, bool RowMajor>
+        dsparse_array2<T, RowMajor> compress_dense(const array2<T> &x) {
+            const ssize_t nouter = RowMajor ? x.nr() : x.nc(), ninner = RowMajor ? x.nc() : x.nr();
+            darray1<ssize_t> ptr(nouter + 1, 0);
+            darray1<ssize_t> idx;
+            darray1<T> values;
+            for (ssize_t o = 0; o < nouter; ++o) {
+                ptr[o] = idx.size();
+                for (ssize_t i = 0; i < ninner; ++i) {
+                    const T &v = RowMajor ? x(o, i) : x(i, o);
+                    if (v != T()) {
+                        idx.push_back(i);
+                        values.push_back(v);
+                    }
+                }
+            }
+            ptr[nouter] = idx.size();
+            return dsparse_array2<T, RowMajor>(x.nr(), x.nc(), std::move(ptr), std::move(idx), std::move(values));
+        }
+    }
+
+    //builders from (row, col, value) triplets, duplicates are summed
+    template<typename T, typename ER, typename EC, typename EV>
+    dcsr_array2<T> make_csr(ssize_t nr, ssize_t nc, const ER &rows, const EC &cols, const EV &vals) {
+        return detail::compress_triplets<T, true>(nr, nc, rows, cols, vals);
+    }
+
+    template<typename T, typename ER, typename EC, typename EV>
+    dcsc_array2<T> make_csc(ssize_t nr, ssize_t nc, const ER &rows, const EC &cols, const EV &vals) {
+        return detail::compress_triplets<T, false>(nr, nc, cols, rows, vals);
+    }
+
+    //builders from dense array2/darray2, keeps the non-zero elements
+    template<typename E>
+    dcsr_array2<typename E::value_type> csr_from_dense(const E &x) {
+        return detail::compress_dense<typename E::value_type, true>(as_array2(x));
+    }
+
+    template<typename E>
+    dcsc_array2<typename E::value_type> csc_from_dense(const E &x) {
+        return detail::compress_dense<typename E::value_type, false>(as_array2(x));
+    }
+
+    //same elements in the other storage order (CSR to CSC and back), copies
+    template<typename T, bool RowMajor>
+    dsparse_array2<T, !RowMajor> convert_major(const sparse_array2<T, RowMajor> &a) {
+        const sparse_array2<T, RowMajor> &v = a;
+        const ssize_t nouter = v.outer_size(), ninner = RowMajor ? v.nc() : v.nr(), n = v.nnz();
+        const ssize_t *inner = v.inner_indices().data();
+        darray1<ssize_t> ptr(ninner + 1, 0);
+        for (ssize_t k = 0; k < n; ++k)
+            ++ptr[inner[k] + 1];
+        for (ssize_t i = 0; i < ninner; ++i)
+            ptr[i + 1] += ptr[i];
+        darray1<ssize_t> idx(n);
+        darray1<T> values(n);
+        std::vector<ssize_t> next(ptr.data(), ptr.data() + ninner);
+        //outer slots are visited in order, so the new inner indices come out sorted
+        for (ssize_t o = 0; o < nouter; ++o) {
+            array1<ssize_t> ii = v.inner_indices(o);
+            array1<T> vv = v.values(o);
+            for (ssize_t k = 0; k < ii.size(); ++k) {
+                const ssize_t dst = next[ii[k]]++;
+                idx[dst] = o;
+                values[dst] = vv[k];
+            }
+        }
+        return dsparse_array2<T, !RowMajor>(v.nr(), v.nc(), std::move(ptr), std::move(idx), std::move(values));
+    }
+
+    template<typename T, bool RowMajor>
+    dsparse_array2<T, !RowMajor> convert_major(const dsparse_array2<T, RowMajor> &a) {
+        return convert_major(a.view());
+    }
+
+    template<typename T, bool RowMajor>
+    darray2<T> to_dense(const sparse_array2<T, RowMajor> &a) {
+        darray2<T> result(a.nr(), a.nc(), T());
+        for (ssize_t o = 0; o < a.outer_size(); ++o) {
+            array1<ssize_t> ii = a.inner_indices(o);
+            array1<T> vv = a.values(o);
+            for (ssize_t k = 0; k < ii.size(); ++k)
+                (RowMajor ? result(o, ii[k]) : result(ii[k], o)) = vv[k];
+        }
+        return result;
+    }
+
+    template<typename T, bool RowMajor>
+    darray2<T> to_dense(const dsparse_array2<T, RowMajor> &a) {
+        return to_dense(a.view());
+    }
+
+    namespace detail {
+        //y[r] = sum of row r of the CSR array a times x for rows [r0, r1)
+        template<typename T, typename X>
+        void spmv_rows(const csr_array2<T> &a, const X &x, const marray1<T> &y, ssize_t r0, ssize_t r1) {
+            const ssize_t *ptr = a.outer_ptr().data();
+            const ssize_t *idx = a.inner_indices().data();
+            const T *val = a.values().data();
+            for (ssize_t r = r0; r < r1; ++r) {
+                T acc = T();
+                for (ssize_t k = ptr[r]; k < ptr[r + 1]; ++k)
+                    acc += val[k] * x[idx[k]];
+                y[r] = acc;
+            }
+        }
+
+        //don't start threads for less than the tuned grain of non-zeros per band
+        template<typename T>
+        ssize_t spmv_min_parallel_nnz() {
+            return tuning().grain<T>();
+        }
+    }
+
+    //y = a * x, y must not overlap x
+    template<typename T, typename X>
+    void spmv(const csr_array2<T> &a, const X &x, const marray1<T> &y) {
+        if (x.size() != a.nc() || y.size() != a.nr())
+            throw std::runtime_error("spmv: operand sizes don't match");
+        detail::spmv_rows(a, x, y, 0, a.nr());
+    }
+
+    //CSC: scatter each column times its x element
+    template<typename T, typename X>
+    void spmv(const csc_array2<T> &a, const X &x, const marray1<T> &y) {
+        if (x.size() != a.nc() || y.size() != a.nr())
+            throw std::runtime_error("spmv: operand sizes don't match");
+        for (ssize_t r = 0; r < a.nr(); ++r) y[r] = T();
+        for (ssize_t c = 0; c < a.nc(); ++c) {
+            const T xc = x[c];
+            array1<ssize_t> ii = a.inner_indices(c);
+            array1<T> vv = a.values(c);
+            for (ssize_t k = 0; k < ii.size(); ++k)
+                y[ii[k]] += vv[k] * xc;
+        }
+    }
+
+    template<typename T, bool RowMajor, typename X>
+    darray1<T> spmv(const sparse_array2<T, RowMajor> &a, const X &x) {
+        darray1<T> y(a.nr());
+        spmv(a, x, marray1<T>(y));
+        return y;
+    }
+
+    template<typename T, bool RowMajor, typename X>
+    darray1<T> spmv(const dsparse_array2<T, RowMajor> &a, const X &x) {
+        return spmv(a.view(), x);
+    }
+
+    //y = a * x for CSR arrays, rows are split across threads in bands of roughly equal non-zero counts
+    template<typename T, typename X>
+    void spmv_parallel(const csr_array2<T> &a, const X &x, const marray1<T> &y, ssize_t nthreads = 0) {
+        if (x.size() != a.nc() || y.size() != a.nr())
+            throw std::runtime_error("spmv_parallel: operand sizes don't match");
+        const ssize_t nnz = a.nnz();
+        if (nnz == 0) {
+            for (ssize_t r = 0; r < a.nr(); ++r) y[r] = T();
+            return;
+        }
+        const ssize_t *ptr = a.outer_ptr().data();
+        //a band of non-zeros [lo, hi) owns the rows starting in it, the last band also owns trailing empty rows
+        parallel_for_bands(nnz, detail::spmv_min_parallel_nnz<T>(), [&](ssize_t lo, ssize_t hi) {
+            const ssize_t r0 = std::lower_bound(ptr, ptr + a.nr(), lo) - ptr;
+            const ssize_t r1 = hi == nnz ? a.nr() : std::lower_bound(ptr, ptr + a.nr(), hi) - ptr;
+            detail::spmv_rows(a, x, y, r0, r1);
+        }, nthreads);
+    }
+
+    template<typename T, typename X>
+    darray1<T> spmv_parallel(const csr_array2<T> &a, const X &x, ssize_t nthreads = 0) {
+        darray1<T> y(a.nr());
+        spmv_parallel(a, x, marray1<T>(y), nthreads);
+        return y;
+    }
+
+    template<typename T, typename X>
+    darray1<T> spmv_parallel(const dcsr_array2<T> &a, const X &x, ssize_t nthreads = 0) {
+        return spmv_parallel(a.view(), x, nthreads);
+    }
+
+    //a * b with a dense b (array2 or darray2), each stored element adds a scaled row of b to a row of the result
+    template<typename T, bool RowMajor, typename E>
+    darray2<T> spmm(const sparse_array2<T, RowMajor> &a, const E &b0) {
+        const array2<T> b = as_array2(b0);
+        if (b.nr() != a.nc())
+            throw std::runtime_error("spmm: operand sizes don't match");
+        const ssize_t n = b.nc(), bs = b.strides()[1];
+        darray2<T> result(a.nr(), n, T());
+        //no row of b or result to point into
+        if (n == 0)
+            return result;
+        for (ssize_t o = 0; o < a.outer_size(); ++o) {
+            array1<ssize_t> ii = a.inner_indices(o);
+            array1<T> vv = a.values(o);
+            for (ssize_t k = 0; k < ii.size(); ++k) {
+                const ssize_t r = RowMajor ? o : ii[k], c = RowMajor ? ii[k] : o;
+                const T v = vv[k];
+                T *out = &result(r, 0);
+                const T *in = &b(c, 0);
+                if (bs == 1)
+                    for (ssize_t j = 0; j < n; ++j) out[j] += v * in[j];
+                else
+                    for (ssize_t j = 0; j < n; ++j) out[j] += v * in[j * bs];
+            }
+        }
+        return result;
+    }
+
+    template<typename T, bool RowMajor, typename E>
+    darray2<T> spmm(const dsparse_array2<T, RowMajor> &a, const E &b) {
+        return spmm(a.view(), b);
+    }
+
+}
+
+#endif
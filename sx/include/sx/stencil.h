@@ -0,0 +1,211 @@
+#ifndef STENCIL_INCLUDED_7732019
+#define STENCIL_INCLUDED_7732019
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "array1.h"
+#include "array2.h"
+#include "broadcast.h"
+#include "parallel.h"
+#include "tuning.h"
+
+namespace sx {
+
+    //how stencils read samples outside of the source array
+    enum class border_mode {
+        constant,  //iiiiii|abcdefgh|iiiiiii, i is the given constant
+        replicate, //aaaaaa|abcdefgh|hhhhhhh
+        reflect,   //gfedcb|abcdefgh|gfedcba
+        wrap       //cdefgh|abcdefgh|abcdefg
+    };
+
+    //source index for the out-of-range index i in [0, n), -1 for border_mode::constant, n must be positive
+    inline ssize_t border_index(ssize_t i, ssize_t n, border_mode mode) {
+        if (0 <= i && i < n)
+            return i;
+        switch (mode) {
+            case border_mode::constant:
+                return -1;
+            case border_mode::replicate:
+                return i < 0 ? 0 : n - 1;
+            case border_mode::reflect: {
+                if (n == 1)
+                    return 0;
+                const ssize_t period = 2 * (n - 1);
+                i %= period;
+                if (i < 0)
+                    i += period;
+                return i < n ? i : period - i;
+            }
+            case border_mode::wrap:
+                i %= n;
+                return i < 0 ? i + n : i;
+        }
+        return -1;
+    }
+
+    namespace detail {
+        //rows [r0, r1) of src with rx extra border columns on both sides, one contiguous row per source row
+        //this makes the inner loops of the kernels branch-free and unit-stride regardless of src strides
+        template<typename T>
+        void stencil_padded_rows(const array2<T> &src, ssize_t r0, ssize_t r1, ssize_t rx,
+                border_mode mode, const T &border_value, std::vector<T> &buf) {
+            const ssize_t nr = src.nr(), nc = src.nc(), w = nc + 2 * rx;
+            buf.resize((r1 - r0) * w);
+            if (nr == 0 || nc == 0)
+                return;
+            for (ssize_t r = r0; r < r1; ++r) {
+                T *dst = buf.data() + (r - r0) * w;
+                const ssize_t sr = border_index(r, nr, mode);
+                if (sr < 0) {
+                    std::fill(dst, dst + w, border_value);
+                    continue;
+                }
+                const T *p = &src(sr, 0);
+                const ssize_t cs = src.strides()[1];
+                if (cs == 1)
+                    std::copy(p, p + nc, dst + rx);
+                else
+                    for (ssize_t c = 0; c < nc; ++c) dst[rx + c] = p[c * cs];
+                for (ssize_t c = 0; c < rx; ++c) {
+                    const ssize_t lc = border_index(c - rx, nc, mode);
+                    const ssize_t hc = border_index(nc + c, nc, mode);
+                    dst[c] = lc < 0 ? border_value : dst[rx + lc];
+                    dst[rx + nc + c] = hc < 0 ? border_value : dst[rx + hc];
+                }
+            }
+        }
+
+        //rows of each band processed together, keeps the padded band in L2
+        const ssize_t stencil_band_rows = 64;
+
+        //rows per band, don't start threads for less than the tuned grain of output elements per band
+        template<typename T>
+        ssize_t stencil_min_band(ssize_t nc) {
+            return std::max<ssize_t>(1, tuning().grain<T>() / std::max<ssize_t>(1, nc));
+        }
+
+        template<typename T>
+        void stencil_store_row(const std::vector<T> &acc, const marray2<T> &dst, ssize_t r) {
+            T *out = &dst(r, 0);
+            const ssize_t cs = dst.strides()[1];
+            if (cs == 1)
+                std::copy(acc.begin(), acc.end(), out);
+            else
+                for (ssize_t c = 0; c < (ssize_t) acc.size(); ++c) out[c * cs] = acc[c];
+        }
+    }
+
+    //dst(r, c) = sum of kernel(i, j) * src(r + i - kernel.nr() / 2, c + j - kernel.nc() / 2)
+    //correlation, i.e. the kernel is not flipped; kernel dimensions must be odd
+    //dst must have the shape of src and must not overlap it
+    //src and kernel can be array2 or darray2
+    template<typename S, typename K>
+    void stencil(const S &src0, const K &kernel0, const marray2<typename S::value_type> &dst,
+            border_mode mode = border_mode::replicate, const typename S::value_type &border_value = typename S::value_type()) {
+        typedef typename S::value_type T;
+        const array2<T> src = as_array2(src0);
+        const array2<typename K::value_type> kernel = as_array2(kernel0);
+        if (kernel.nr() % 2 == 0 || kernel.nc() % 2 == 0)
+            throw std::runtime_error("stencil: kernel dimensions must be odd");
+        if (dst.nr() != src.nr() || dst.nc() != src.nc())
+            throw std::runtime_error("stencil: dst and src have different shapes");
+        //nothing to write, and the border modes have no source element to map to
+        if (src.nr() == 0 || src.nc() == 0)
+            return;
+        const ssize_t ry = kernel.nr() / 2, rx = kernel.nc() / 2;
+        const ssize_t nc = src.nc(), w = nc + 2 * rx;
+
+        parallel_for_bands(src.nr(), detail::stencil_min_band<T>(nc), [&](ssize_t lo, ssize_t hi) {
+            std::vector<T> buf, acc(nc);
+            for (ssize_t b0 = lo; b0 < hi; b0 += detail::stencil_band_rows) {
+                const ssize_t b1 = std::min(hi, b0 + detail::stencil_band_rows);
+                detail::stencil_padded_rows(src, b0 - ry, b1 + ry, rx, mode, border_value, buf);
+                for (ssize_t r = b0; r < b1; ++r) {
+                    std::fill(acc.begin(), acc.end(), T());
+                    T *a = acc.data();
+                    for (ssize_t i = 0; i < kernel.nr(); ++i) {
+                        const T *row = buf.data() + (r - b0 + i) * w;
+                        for (ssize_t j = 0; j < kernel.nc(); ++j) {
+                            const T k = (T) kernel(i, j);
+                            if (k == T())
+                                continue;
+                            const T *p = row + j;
+                            for (ssize_t c = 0; c < nc; ++c) a[c] += k * p[c];
+                        }
+                    }
+                    detail::stencil_store_row(acc, dst, r);
+                }
+            }
+        });
+    }
+
+    template<typename S, typename K>
+    darray2<typename S::value_type> stencil(const S &src, const K &kernel,
+            border_mode mode = border_mode::replicate, const typename S::value_type &border_value = typename S::value_type()) {
+        darray2<typename S::value_type> result(src.nr(), src.nc());
+        stencil(src, kernel, result, mode, border_value);
+        return result;
+    }
+
+    //separable kernel: the outer product of kcol (vertical, applied second) and krow (horizontal)
+    //costs kcol.size() + krow.size() instead of kcol.size() * krow.size() multiply-adds per element
+    //src can be array2 or darray2, kcol and krow any 1D indexable
+    template<typename S, typename K1, typename K2>
+    void stencil_separable(const S &src0, const K1 &kcol, const K2 &krow, const marray2<typename S::value_type> &dst,
+            border_mode mode = border_mode::replicate, const typename S::value_type &border_value = typename S::value_type()) {
+        typedef typename S::value_type T;
+        const array2<T> src = as_array2(src0);
+        if (kcol.size() % 2 == 0 || krow.size() % 2 == 0)
+            throw std::runtime_error("stencil_separable: kernel sizes must be odd");
+        if (dst.nr() != src.nr() || dst.nc() != src.nc())
+            throw std::runtime_error("stencil_separable: dst and src have different shapes");
+        if (src.nr() == 0 || src.nc() == 0)
+            return;
+        const ssize_t ry = kcol.size() / 2, rx = krow.size() / 2;
+        const ssize_t nc = src.nc(), w = nc + 2 * rx;
+
+        parallel_for_bands(src.nr(), detail::stencil_min_band<T>(nc), [&](ssize_t lo, ssize_t hi) {
+            std::vector<T> buf, horz, acc(nc);
+            for (ssize_t b0 = lo; b0 < hi; b0 += detail::stencil_band_rows) {
+                const ssize_t b1 = std::min(hi, b0 + detail::stencil_band_rows);
+                const ssize_t nbuf = b1 - b0 + 2 * ry;
+                detail::stencil_padded_rows(src, b0 - ry, b1 + ry, rx, mode, border_value, buf);
+                //horizontal pass over the padded band
+                horz.assign(nbuf * nc, T());
+                for (ssize_t r = 0; r < nbuf; ++r) {
+                    T *h = horz.data() + r * nc;
+                    for (ssize_t j = 0; j < krow.size(); ++j) {
+                        const T k = (T) krow[j];
+                        const T *p = buf.data() + r * w + j;
+                        for (ssize_t c = 0; c < nc; ++c) h[c] += k * p[c];
+                    }
+                }
+                //vertical pass
+                for (ssize_t r = b0; r < b1; ++r) {
+                    std::fill(acc.begin(), acc.end(), T());
+                    T *a = acc.data();
+                    for (ssize_t i = 0; i < kcol.size(); ++i) {
+                        const T k = (T) kcol[i];
+                        const T *p = horz.data() + (r - b0 + i) * nc;
+                        for (ssize_t c = 0; c < nc; ++c) a[c] += k * p[c];
+                    }
+                    detail::stencil_store_row(acc, dst, r);
+                }
+            }
+        });
+    }
+
+    template<typename S, typename K1, typename K2>
+    darray2<typename S::value_type> stencil_separable(const S &src, const K1 &kcol, const K2 &krow,
+            border_mode mode = border_mode::replicate, const typename S::value_type &border_value = typename S::value_type()) {
+        darray2<typename S::value_type> result(src.nr(), src.nc());
+        stencil_separable(src, kcol, krow, result, mode, border_value);
+        return result;
+    }
+
+}
+
+#endif
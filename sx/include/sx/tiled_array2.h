@@ -0,0 +1,210 @@
+#ifndef TILED_ARRAY2_INCLUDED_5520913
+#define TILED_ARRAY2_INCLUDED_5520913
+
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+#include "smart_index.h"
+#include "index_iterator.h"
+#include "traits.h"
+#include "array1.h"
+#include "array2.h"
+
+namespace sx {
+
+    //2D array stored as square tiles of (1 << TileBits) x (1 << TileBits) elements
+    //tiles are laid out row-major and each tile is row-major internally, so 2D neighbourhoods
+    //share cache lines and pages; edge tiles are padded to full size
+    //linear operator[] and the index iterators still walk the logical row-major order
+    //the broadcasting ops of broadcast.h work on it element by element, it has no strided array2 view
+    template<typename T, int TileBits = 6>
+    class tiled_darray2
+            : public container_traits_tags::indexable,
+              public container_traits_tags::two_dimensional {
+    public:
+        typedef std::vector<T> container_type;
+        typedef typename container_type::value_type value_type;
+        typedef typename container_type::reference reference;
+        typedef typename container_type::const_reference const_reference;
+        typedef typename container_type::pointer pointer;
+        typedef typename container_type::const_pointer const_pointer;
+        typedef tiled_darray2<T, TileBits> this_type;
+        typedef ssize_t size_type;
+
+        static const ssize_t tile_size = ssize_t(1) << TileBits;
+        static const ssize_t tile_elems = tile_size * tile_size;
+
+        tiled_darray2() : nr_(0), nc_(0), ntc_(0) {
+        }
+
+        tiled_darray2(ssize_t nrows, ssize_t ncols) {
+            resize(nrows, ncols);
+        }
+
+        tiled_darray2(ssize_t nrows, ssize_t ncols, const value_type &x) {
+            resize(nrows, ncols, x);
+        }
+
+        //conversion from row-major, copies tile by tile
+        template<bool Mutable>
+        explicit tiled_darray2(const array2<T, Mutable> &x) {
+            resize(x.nr(), x.nc());
+            for (ssize_t tr = 0; tr < ntile_rows(); ++tr)
+                for (ssize_t tc = 0; tc < ntile_cols(); ++tc) {
+                    marray2<T> dst = tile(tr, tc);
+                    for (ssize_t r = 0; r < dst.nr(); ++r) {
+                        array1<T> src = x.row(tr * tile_size + r).slicen(tc * tile_size, dst.nc());
+                        std::copy(BEGINEND(src), &dst(r, 0));
+                    }
+                }
+        }
+
+        explicit tiled_darray2(const darray2<T> &x) : tiled_darray2(array2<T>(x)) {
+        }
+
+        void resize(ssize_t nrows, ssize_t ncols) {
+            resize(nrows, ncols, value_type());
+        }
+
+        //existing contents are not preserved
+        void resize(ssize_t nrows, ssize_t ncols, const value_type &x) {
+            nr_ = nrows;
+            nc_ = ncols;
+            ntc_ = (ncols + tile_size - 1) >> TileBits;
+            const ssize_t ntr = (nrows + tile_size - 1) >> TileBits;
+            v_.assign(ntr * ntc_ * tile_elems, x);
+        }
+
+        ssize_t nr() const {
+            return nr_;
+        }
+
+        ssize_t nc() const {
+            return nc_;
+        }
+
+        ssize_t size() const {
+            return nr_ * nc_;
+        }
+
+        ssize_t ntile_rows() const {
+            return (nr_ + tile_size - 1) >> TileBits;
+        }
+
+        ssize_t ntile_cols() const {
+            return ntc_;
+        }
+
+        //offset of (row, col) in the tiled storage
+        ssize_t offset(ssize_t row, ssize_t col) const {
+            const ssize_t mask = tile_size - 1;
+            return (((row >> TileBits) * ntc_ + (col >> TileBits)) << (2 * TileBits))
+                    + ((row & mask) << TileBits) + (col & mask);
+        }
+
+        const_reference operator()(ssize_t row, ssize_t col) const {
+            assert(0 <= row && row < nr() && 0 <= col && col < nc());
+            return v_[offset(row, col)];
+        }
+
+        const_reference operator()(smart_index srow, smart_index scol) const {
+            return (*this)(srow.effective_idx_unchecked(nr()), scol.effective_idx_unchecked(nc()));
+        }
+
+        reference operator()(ssize_t row, ssize_t col) {
+            assert(0 <= row && row < nr() && 0 <= col && col < nc());
+            return v_[offset(row, col)];
+        }
+
+        reference operator()(smart_index srow, smart_index scol) {
+            return (*this)(srow.effective_idx_unchecked(nr()), scol.effective_idx_unchecked(nc()));
+        }
+
+        //linear index, row-major
+        const_reference operator[](ssize_t idx) const {
+            return (*this)(idx / nc_, idx % nc_);
+        }
+
+        reference operator[](ssize_t idx) {
+            return (*this)(idx / nc_, idx % nc_);
+        }
+
+        //tile (tr, tc) as a row-major view, edge tiles are cropped to the array
+        array2<T> tile(ssize_t tr, ssize_t tc) const {
+            assert(0 <= tr && tr < ntile_rows() && 0 <= tc && tc < ntile_cols());
+            return array2<T>(v_.data() + ((tr * ntc_ + tc) << (2 * TileBits)),
+                    std::min(tile_size, nr_ - (tr << TileBits)),
+                    std::min(tile_size, nc_ - (tc << TileBits)),
+                    tile_size);
+        }
+
+        marray2<T> tile(ssize_t tr, ssize_t tc) {
+            assert(0 <= tr && tr < ntile_rows() && 0 <= tc && tc < ntile_cols());
+            return marray2<T>(v_.data() + ((tr * ntc_ + tc) << (2 * TileBits)),
+                    std::min(tile_size, nr_ - (tr << TileBits)),
+                    std::min(tile_size, nc_ - (tc << TileBits)),
+                    tile_size);
+        }
+
+        //calls f(row0, col0, tile view) for each tile in storage order
+        template<typename F>
+        void for_each_tile(F &&f) const {
+            for (ssize_t tr = 0; tr < ntile_rows(); ++tr)
+                for (ssize_t tc = 0; tc < ntc_; ++tc)
+                    f(tr << TileBits, tc << TileBits, tile(tr, tc));
+        }
+
+        template<typename F>
+        void for_each_tile(F &&f) {
+            for (ssize_t tr = 0; tr < ntile_rows(); ++tr)
+                for (ssize_t tc = 0; tc < ntc_; ++tc)
+                    f(tr << TileBits, tc << TileBits, tile(tr, tc));
+        }
+
+        //conversion to row-major, copies tile by tile
+        darray2<T> to_darray2() const {
+            darray2<T> result(nr_, nc_);
+            for_each_tile([&result](ssize_t r0, ssize_t c0, const array2<T> &t) {
+                for (ssize_t r = 0; r < t.nr(); ++r) {
+                    array1<T> src = t.row(r);
+                    std::copy(BEGINEND(src), &result(r0 + r, c0));
+                }
+            });
+            return result;
+        }
+
+    private:
+        container_type v_;
+        ssize_t nr_, nc_, ntc_;
+    };
+
+    template<typename T, int TileBits>
+    const ssize_t tiled_darray2<T, TileBits>::tile_size;
+
+    template<typename T, int TileBits>
+    const ssize_t tiled_darray2<T, TileBits>::tile_elems;
+
+    template<typename T, int TileBits>
+    const_index_iterator<const tiled_darray2<T, TileBits>> begin(const tiled_darray2<T, TileBits> &that) {
+        return const_index_iterator<const tiled_darray2<T, TileBits>>(&that, 0);
+    }
+
+    template<typename T, int TileBits>
+    const_index_iterator<const tiled_darray2<T, TileBits>> end(const tiled_darray2<T, TileBits> &that) {
+        return const_index_iterator<const tiled_darray2<T, TileBits>>(&that, that.size());
+    }
+
+    template<typename T, int TileBits>
+    mutable_index_iterator<tiled_darray2<T, TileBits>> begin(tiled_darray2<T, TileBits> &that) {
+        return mutable_index_iterator<tiled_darray2<T, TileBits>>(&that, 0);
+    }
+
+    template<typename T, int TileBits>
+    mutable_index_iterator<tiled_darray2<T, TileBits>> end(tiled_darray2<T, TileBits> &that) {
+        return mutable_index_iterator<tiled_darray2<T, TileBits>>(&that, that.size());
+    }
+
+}
+
+#endif
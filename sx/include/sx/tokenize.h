@@ -0,0 +1,102 @@
+#ifndef TOKENIZE_INCLUDED_3308915
+#define TOKENIZE_INCLUDED_3308915
+
+#include <string>
+#include <type_traits>
+
+#include "types.h"
+#include "traits.h"
+#include "array1.h"
+#include "char_scan.h"
+
+namespace sx {
+
+    namespace detail {
+        //calls f(i) in increasing order for each i where p[i * stride] is one of the chars in set
+        //contiguous input is compared 16 bytes at a time against each char of small sets (SSE2),
+        //everything else goes through a 256-entry table
+        template<typename F>
+        void for_each_char_match(const char *p, ssize_t n, ssize_t stride, const std::string &set, F &&f) {
+            bool table[256] = {};
+            for (char c : set)
+                table[(unsigned char) c] = true;
+            ssize_t i = 0;
+#ifdef __SSE2__
+            const int max_simd_set = 8;
+            if (stride == 1 && !set.empty() && set.size() <= (size_t) max_simd_set) {
+                __m128i v[max_simd_set];
+                const int nset = (int) set.size();
+                for (int k = 0; k < nset; ++k)
+                    v[k] = _mm_set1_epi8(set[k]);
+                for (; n - i >= 16; i += 16) {
+                    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                    __m128i eq = _mm_cmpeq_epi8(x, v[0]);
+                    for (int k = 1; k < nset; ++k)
+                        eq = _mm_or_si128(eq, _mm_cmpeq_epi8(x, v[k]));
+                    for (unsigned m = (unsigned) _mm_movemask_epi8(eq); m != 0; m &= m - 1)
+                        f(i + ctz32(m));
+                }
+            }
+#endif
+            for (; i < n; ++i)
+                if (table[(unsigned char) p[i * stride]])
+                    f(i);
+        }
+    }
+
+    //positions of c in s, ascending
+    inline darray1<ssize_t> find_all(const array1<char> &s, char c) {
+        darray1<ssize_t> result;
+        if (s.stride() == 1) {
+            //memchr is the fastest single-char search the platform has
+            const char *const b = s.data(), *const e = b + s.size();
+            for (const char *p = scan_char(b, e, c); p != e; p = scan_char(p + 1, e, c))
+                result.push_back(p - b);
+            return result;
+        }
+        detail::for_each_char_match(s.data(), s.size(), s.stride(), std::string(1, c), [&result](ssize_t i) {
+            result.push_back(i);
+        });
+        return result;
+    }
+
+    //positions in s holding any of the chars, ascending
+    inline darray1<ssize_t> split_points(const array1<char> &s, const std::string &chars) {
+        darray1<ssize_t> result;
+        detail::for_each_char_match(s.data(), s.size(), s.stride(), chars, [&result](ssize_t i) {
+            result.push_back(i);
+        });
+        return result;
+    }
+
+    // split_at(idxlist, list): views of the pieces between the elements at idcs, which are left out
+    // idcs must be ascending, the result has idcs.size() + 1 pieces, some of them may be empty
+    template<typename E1, typename E2, typename std::enable_if<container_traits<E1>::indexable && container_traits<E2>::indexable>::type * = nullptr>
+    darray1<array1<typename E2::value_type>> split_at(const E1 &idcs, const E2 &y) {
+        darray1<array1<typename E2::value_type>> result;
+        const ssize_t N = idcs.size();
+        result.reserve(N + 1);
+        ssize_t lo = 0;
+        for (ssize_t i = 0; i < N; ++i) {
+            const ssize_t hi = idcs[i];
+            result.push_back(y.slice(lo, hi));
+            lo = hi + 1;
+        }
+        //slice() doesn't take an empty range at the end
+        result.push_back(lo < y.size() ? y.slice(lo, y.size()) : array1<typename E2::value_type>());
+        return result;
+    }
+
+    //fields of s separated by c, as views into s
+    inline darray1<array1<char>> split(const array1<char> &s, char c) {
+        return split_at(find_all(s, c), s);
+    }
+
+    //fields of s separated by any of the chars, as views into s
+    inline darray1<array1<char>> split(const array1<char> &s, const std::string &chars) {
+        return split_at(split_points(s, chars), s);
+    }
+
+}
+
+#endif
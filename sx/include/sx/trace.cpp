@@ -0,0 +1,186 @@
+#include "sx/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace sx {
+
+    namespace {
+        //fields are relaxed atomics so a dump can read a slot while its thread overwrites it,
+        //the torn ones are discarded by checking head again afterwards
+        struct trace_event {
+            std::atomic<const char *> name;
+            std::atomic<int64_t> start, end, n, bytes;
+        };
+
+        //written by the thread holding it, a thread that exits hands it over to a new one through the registry
+        struct trace_buffer {
+            int tid;
+            std::atomic<uint64_t> head;     //events ever recorded
+            std::atomic<uint64_t> tail;     //events before it were cleared
+            std::unique_ptr<trace_event[]> events;
+
+            explicit trace_buffer(int tid)
+                    : tid(tid), head(0), tail(0), events(new trace_event[trace_buffer_events]) {
+            }
+        };
+
+        struct trace_registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<trace_buffer>> buffers;    //kept after their thread exits
+            std::vector<trace_buffer *> free;                       //of exited threads, for the next new ones
+        };
+
+        trace_registry &registry() {
+            static trace_registry r;
+            return r;
+        }
+
+        //gives the buffer back to the registry when its thread exits, so threads started per parallel_for_bands
+        //call reuse the buffers, and the tids, of the finished ones instead of adding a buffer each
+        struct thread_buffer_holder {
+            trace_buffer *b = nullptr;
+
+            ~thread_buffer_holder() {
+                if (b) {
+                    trace_registry &r = registry();
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    r.free.push_back(b);
+                }
+            }
+        };
+
+        //takes a buffer for the thread on its first span, the only time a lock is taken
+        trace_buffer &thread_buffer() {
+            static thread_local thread_buffer_holder h;
+            if (!h.b) {
+                trace_registry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                if (!r.free.empty()) {
+                    h.b = r.free.back();
+                    r.free.pop_back();
+                } else {
+                    r.buffers.emplace_back(new trace_buffer((int) r.buffers.size() + 1));
+                    h.b = r.buffers.back().get();
+                }
+            }
+            return *h.b;
+        }
+
+        struct span {
+            const char *name;
+            int64_t start, end, n, bytes;
+        };
+
+        //copies the spans of b that are not being overwritten
+        void snapshot(const trace_buffer &b, std::vector<span> &out) {
+            const uint64_t cap = trace_buffer_events;
+            const uint64_t h1 = b.head.load(std::memory_order_acquire);
+            const uint64_t lo = std::max(b.tail.load(std::memory_order_relaxed), h1 > cap ? h1 - cap : 0);
+            std::vector<span> spans;
+            spans.reserve(h1 - lo);
+            for (uint64_t i = lo; i < h1; ++i) {
+                const trace_event &e = b.events[i % cap];
+                span s;
+                s.name = e.name.load(std::memory_order_relaxed);
+                s.start = e.start.load(std::memory_order_relaxed);
+                s.end = e.end.load(std::memory_order_relaxed);
+                s.n = e.n.load(std::memory_order_relaxed);
+                s.bytes = e.bytes.load(std::memory_order_relaxed);
+                spans.push_back(s);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            //while writing event h the thread overwrites slot h - cap
+            const uint64_t h2 = b.head.load(std::memory_order_relaxed);
+            const uint64_t valid = h2 >= cap ? h2 - cap + 1 : 0;
+            for (uint64_t i = lo; i < h1; ++i)
+                if (i >= valid)
+                    out.push_back(spans[i - lo]);
+        }
+
+        void append_json_string(std::string &r, const char *s) {
+            r += '"';
+            for (; *s; ++s) {
+                if (*s == '"' || *s == '\\')
+                    r += '\\';
+                r += *s;
+            }
+            r += '"';
+        }
+    }
+
+    namespace detail {
+
+        int64_t trace_now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void trace_record(const char *name, int64_t start, int64_t end, int64_t n, int64_t bytes) {
+            trace_buffer &b = thread_buffer();
+            const uint64_t h = b.head.load(std::memory_order_relaxed);
+            trace_event &e = b.events[h % trace_buffer_events];
+            e.name.store(name, std::memory_order_relaxed);
+            e.start.store(start, std::memory_order_relaxed);
+            e.end.store(end, std::memory_order_relaxed);
+            e.n.store(n, std::memory_order_relaxed);
+            e.bytes.store(bytes, std::memory_order_relaxed);
+            b.head.store(h + 1, std::memory_order_release);
+        }
+
+    }
+
+    std::string chrome_trace_json() {
+        std::vector<std::pair<int, std::vector<span>>> threads;
+        {
+            trace_registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (auto &b : r.buffers) {
+                threads.emplace_back(b->tid, std::vector<span>());
+                snapshot(*b, threads.back().second);
+            }
+        }
+        std::string result = "{\"traceEvents\":[";
+        bool first = true;
+        char buf[256];
+        for (auto &t : threads) {
+            for (const span &s : t.second) {
+                result += first ? "\n" : ",\n";
+                first = false;
+                result += "{\"name\":";
+                append_json_string(result, s.name);
+                snprintf(buf, sizeof(buf),
+                        ",\"cat\":\"sx\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                                "\"args\":{\"n\":%lld,\"bytes\":%lld}}",
+                        t.first, s.start * 1e-3, (s.end - s.start) * 1e-3, (long long) s.n, (long long) s.bytes);
+                result += buf;
+            }
+        }
+        result += "\n],\"displayTimeUnit\":\"ns\"}\n";
+        return result;
+    }
+
+    void write_chrome_trace(const std::string &path) {
+        const std::string json = chrome_trace_json();
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f)
+            throw std::runtime_error("write_chrome_trace: can't open '" + path + "'");
+        const bool ok = fwrite(json.data(), 1, json.size(), f) == json.size();
+        if (fclose(f) != 0 || !ok)
+            throw std::runtime_error("write_chrome_trace: can't write '" + path + "'");
+    }
+
+    void clear_trace() {
+        trace_registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto &b : r.buffers)
+            b->tail.store(b->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+}
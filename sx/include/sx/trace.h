@@ -0,0 +1,85 @@
+#ifndef TRACE_INCLUDED_3391570
+#define TRACE_INCLUDED_3391570
+
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+#include "allocator.h"
+
+//op tracing, compiled out unless SX_TRACE is defined to 1 (cmake -DSX_TRACE=ON)
+//each thread records a span per top-level op into its own ring buffer of the last trace_buffer_events spans,
+//nested ops are part of the span of the outermost one
+//the buffer of a thread that exits goes to the next new thread, which records under the same tid after its spans
+//write_chrome_trace() dumps them as trace-event JSON for chrome://tracing or Perfetto
+
+#ifndef SX_TRACE
+#define SX_TRACE 0
+#endif
+
+namespace sx {
+
+    const ssize_t trace_buffer_events = ssize_t(1) << 14;
+
+    //all recorded spans of all threads as trace-event JSON, can be called while other threads record
+    std::string chrome_trace_json();
+
+    void write_chrome_trace(const std::string &path);
+
+    //drops the spans recorded so far
+    void clear_trace();
+
+    namespace detail {
+        int64_t trace_now();
+
+        //name must outlive the trace, e.g. a string literal
+        void trace_record(const char *name, int64_t start, int64_t end, int64_t n, int64_t bytes);
+
+        inline int &trace_depth() {
+            static thread_local int depth = 0;
+            return depth;
+        }
+    }
+
+    //records [construction, destruction) if no other span is open on the thread
+    class trace_span {
+    public:
+        trace_span(const char *name, int64_t n, int64_t bytes)
+                : name_(name), n_(n), bytes_(bytes), top_(detail::trace_depth()++ == 0), start_(0) {
+            if (top_)
+                start_ = detail::trace_now();
+        }
+
+        trace_span(const trace_span &) = delete;
+
+        trace_span &operator=(const trace_span &) = delete;
+
+        ~trace_span() {
+            --detail::trace_depth();
+            if (top_)
+                detail::trace_record(name_, start_, detail::trace_now(), n_, bytes_);
+        }
+
+    private:
+        const char *name_;
+        int64_t n_, bytes_;
+        bool top_;
+        int64_t start_;
+    };
+
+}
+
+#define SX_TRACE_CONCAT2(a, b) a##b
+#define SX_TRACE_CONCAT(a, b) SX_TRACE_CONCAT2(a, b)
+
+//SX_TRACE_OP("name", elements, bytes touched) opens a span until the end of the enclosing block
+//and names it as the allocation site for alloc_stats.h
+#if SX_TRACE
+#define SX_TRACE_OP(name, n, bytes) \
+    SX_ALLOC_SITE(name); \
+    const ::sx::trace_span SX_TRACE_CONCAT(sx_trace_span_, __LINE__)((name), int64_t(n), int64_t(bytes))
+#else
+#define SX_TRACE_OP(name, n, bytes) SX_ALLOC_SITE(name)
+#endif
+
+#endif
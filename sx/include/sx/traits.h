@@ -1,9 +1,13 @@
 #ifndef TRAITS_INCLUDED_204394
 #define TRAITS_INCLUDED_204394
 
+#include <memory>
 #include <type_traits>
 #include <vector>
 
+#include "types.h"
+#include "allocator.h"
+
 namespace sx {
 
     struct container_traits_tags {
@@ -17,6 +21,8 @@ namespace sx {
         };
         struct use_mutable_pointer_iterator {
         };
+        struct two_dimensional {
+        };
     };
 
     template<typename T>
@@ -26,6 +32,7 @@ namespace sx {
         static const bool use_mutable_index_iterator = std::is_base_of<container_traits_tags::use_mutable_index_iterator, T>::value;
         static const bool use_const_pointer_iterator = std::is_base_of<container_traits_tags::use_const_pointer_iterator, T>::value;
         static const bool use_mutable_pointer_iterator = std::is_base_of<container_traits_tags::use_mutable_pointer_iterator, T>::value;
+        static const bool two_dimensional = std::is_base_of<container_traits_tags::two_dimensional, T>::value;
     };
 
     template<typename T>
@@ -33,18 +40,25 @@ namespace sx {
         static const bool indexable = true;
         static const bool use_const_index_iterator = false;
         static const bool use_mutable_index_iterator = false;
+        static const bool two_dimensional = false;
     };
 
-    template<typename T>
+    //Alloc is the allocator of the underlying std::vector, see allocator.h and huge_page_allocator.h
+    template<typename T, typename Alloc = allocator<T>>
     class darray1;
 
-    template<typename T>
-    struct container_traits<darray1<T>> {
+    template<typename T, typename Alloc>
+    struct container_traits<darray1<T, Alloc>> {
         static const bool indexable = true;
         static const bool use_const_index_iterator = false;
         static const bool use_mutable_index_iterator = false;
+        static const bool two_dimensional = false;
     };
 
+    //up to N elements inside the object, see small_array.h
+    template<typename T, ssize_t N, typename Alloc = allocator<T>>
+    class small_darray1;
+
 }
 
 #endif
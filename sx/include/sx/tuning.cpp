@@ -0,0 +1,383 @@
+#include "sx/tuning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "sx/kernels.h"
+#include "sx/parallel.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sx {
+
+    namespace {
+        const int tuning_version = 1;
+
+        double now_ns() {
+            return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        bool read_file(const std::string &path, std::string &s) {
+            FILE *f = fopen(path.c_str(), "rb");
+            if (!f)
+                return false;
+            char buf[4096];
+            size_t n;
+            s.clear();
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+                s.append(buf, n);
+            fclose(f);
+            return true;
+        }
+
+        //through a temporary and a rename, so concurrent readers never see half a file, failures are ignored
+        //the temporary has a name of its own, processes tuning at the same time would write each other's otherwise
+        void write_file(const std::string &path, const std::string &s) {
+#ifdef _WIN32
+            const std::string tmp = path + "." + std::to_string(_getpid()) + ".tmp";
+            FILE *f = fopen(tmp.c_str(), "wb");
+#else
+            std::string tmp = path + ".XXXXXX";
+            const int fd = mkstemp(&tmp[0]);
+            FILE *f = fd >= 0 ? fdopen(fd, "wb") : nullptr;
+            if (fd >= 0 && !f) {
+                close(fd);
+                remove(tmp.c_str());
+            }
+#endif
+            if (!f)
+                return;
+            const bool ok = fwrite(s.data(), 1, s.size(), f) == s.size();
+            if (fclose(f) == 0 && ok && rename(tmp.c_str(), path.c_str()) == 0)
+                return;
+            remove(tmp.c_str());
+        }
+
+        //"48K", "2048K", "8M" or plain bytes
+        ssize_t parse_size(const std::string &s) {
+            char *end = nullptr;
+            const long long n = strtoll(s.c_str(), &end, 10);
+            if (end == s.c_str() || n <= 0)
+                return 0;
+            switch (*end) {
+                case 'K':
+                case 'k':
+                    return ssize_t(n) << 10;
+                case 'M':
+                case 'm':
+                    return ssize_t(n) << 20;
+                case 'G':
+                case 'g':
+                    return ssize_t(n) << 30;
+                default:
+                    return ssize_t(n);
+            }
+        }
+
+        std::string first_line(const std::string &path) {
+            std::string s;
+            if (!read_file(path, s))
+                return std::string();
+            return s.substr(0, s.find('\n'));
+        }
+
+        void probe_caches(tuning_params &p) {
+            p.l1d_bytes = p.l2_bytes = p.l3_bytes = p.cache_line_bytes = 0;
+#ifdef __linux__
+            for (int i = 0; i < 16; ++i) {
+                const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+                const std::string level = first_line(dir + "level"), type = first_line(dir + "type");
+                if (level.empty())
+                    break;
+                if (type == "Instruction")
+                    continue;
+                const ssize_t size = parse_size(first_line(dir + "size"));
+                if (level == "1")
+                    p.l1d_bytes = size;
+                else if (level == "2")
+                    p.l2_bytes = size;
+                else if (level == "3")
+                    p.l3_bytes = size;
+                if (p.cache_line_bytes == 0)
+                    p.cache_line_bytes = parse_size(first_line(dir + "coherency_line_size"));
+            }
+#endif
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+            if (p.l1d_bytes <= 0)
+                p.l1d_bytes = ssize_t(sysconf(_SC_LEVEL1_DCACHE_SIZE));
+            if (p.l2_bytes <= 0)
+                p.l2_bytes = ssize_t(sysconf(_SC_LEVEL2_CACHE_SIZE));
+            if (p.l3_bytes <= 0)
+                p.l3_bytes = std::max<ssize_t>(0, ssize_t(sysconf(_SC_LEVEL3_CACHE_SIZE)));
+            if (p.cache_line_bytes <= 0)
+                p.cache_line_bytes = ssize_t(sysconf(_SC_LEVEL1_DCACHE_LINESIZE));
+#endif
+            if (p.l1d_bytes <= 0)
+                p.l1d_bytes = 32 << 10;
+            if (p.l2_bytes <= 0)
+                p.l2_bytes = 256 << 10;
+            if (p.l3_bytes < 0)
+                p.l3_bytes = 0;
+            if (p.cache_line_bytes <= 0)
+                p.cache_line_bytes = 64;
+        }
+
+        //best of repeated sums over an array of the given size for about 2 ms
+        double calibrate_stream(ssize_t bytes) {
+            const ssize_t n = std::max<ssize_t>(1024, bytes / ssize_t(sizeof(double)));
+            std::vector<double> v(n, 1.0);
+            volatile double sink = 0;
+            double best = 0;
+            const double deadline = now_ns() + 2e6;
+            for (int rep = 0; rep < 3 || now_ns() < deadline; ++rep) {
+                const double t0 = now_ns();
+                double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+                ssize_t i = 0;
+                for (; i + 4 <= n; i += 4) {
+                    s0 += v[i];
+                    s1 += v[i + 1];
+                    s2 += v[i + 2];
+                    s3 += v[i + 3];
+                }
+                for (; i < n; ++i)
+                    s0 += v[i];
+                sink = sink + (s0 + s1) + (s2 + s3);
+                const double dt = std::max(1.0, now_ns() - t0);
+                best = std::max(best, double(n * sizeof(double)) / dt);
+            }
+            return best;
+        }
+
+        double calibrate_thread_start() {
+            double best = 1e300;
+            for (int rep = 0; rep < 16; ++rep) {
+                const double t0 = now_ns();
+                std::thread t([]() {
+                });
+                t.join();
+                best = std::min(best, now_ns() - t0);
+            }
+            return best;
+        }
+
+        ssize_t round_up(ssize_t n, ssize_t m) {
+            return (n + m - 1) / m * m;
+        }
+
+        void derive(tuning_params &p) {
+            //thread start at most 1/8 of the work of a band
+            const double grain = 8 * p.thread_start_ns * p.stream_bytes_per_ns;
+            p.grain_bytes = round_up(ssize_t(std::min(std::max(grain, 16384.0), 67108864.0)), 4096);
+            p.chunk_bytes = std::max<ssize_t>(16 << 10, p.l2_bytes / 2);
+            const ssize_t panel = ssize_t(std::sqrt(double(p.l2_bytes) / (3 * sizeof(double))));
+            p.panel = std::max<ssize_t>(8, panel / 8 * 8);
+        }
+
+        std::atomic<const tuning_params *> active(nullptr);
+        std::mutex active_mutex;
+
+        //every installed tuning_params lives until exit, see set_tuning()
+        std::vector<std::unique_ptr<tuning_params>> &installed() {
+            static std::vector<std::unique_ptr<tuning_params>> v;
+            return v;
+        }
+
+        //with active_mutex held
+        const tuning_params &install(const tuning_params &x) {
+            installed().emplace_back(new tuning_params(x));
+            active.store(installed().back().get(), std::memory_order_release);
+            return *installed().back();
+        }
+
+        std::string host_name() {
+#ifdef _WIN32
+            const char *h = getenv("COMPUTERNAME");
+            return h ? h : "host";
+#else
+            char h[256] = {0};
+            if (gethostname(h, sizeof(h) - 1) != 0 || h[0] == 0)
+                return "host";
+            return h;
+#endif
+        }
+
+        std::string cpu_model() {
+#ifdef __linux__
+            std::string s;
+            if (read_file("/proc/cpuinfo", s)) {
+                const size_t k = s.find("model name");
+                if (k != std::string::npos) {
+                    const size_t e = s.find('\n', k), b = s.find_first_not_of(' ', s.find(':', k) + 1);
+                    if (b < e)
+                        return s.substr(b, e - b);
+                }
+            }
+#endif
+            return "unknown cpu";
+        }
+    }
+
+    tuning_params calibrate_tuning() {
+        tuning_params p;
+        probe_caches(p);
+        p.nthreads = default_thread_count();
+        p.thread_start_ns = calibrate_thread_start();
+        p.stream_bytes_per_ns = calibrate_stream(p.l2_bytes / 2);
+        derive(p);
+        return p;
+    }
+
+    std::string tuning_host() {
+        return cpu_model() + ", " + std::to_string(default_thread_count()) + " threads, " + isa_name(detected_isa());
+    }
+
+    std::string tuning_cache_path() {
+        const char *env = getenv("SX_TUNING_CACHE");
+        if (env)
+            return strcmp(env, "off") == 0 ? std::string() : std::string(env);
+        std::string dir;
+#ifdef _WIN32
+        if (const char *d = getenv("LOCALAPPDATA"))
+            dir = d;
+#else
+        if (const char *d = getenv("XDG_CACHE_HOME"))
+            dir = d;
+        else if (const char *h = getenv("HOME")) {
+            dir = std::string(h) + "/.cache";
+            mkdir(dir.c_str(), 0755);
+        }
+#endif
+        if (dir.empty())
+            return std::string();
+        //one file per machine, home directories are often shared across hosts
+        return dir + "/sx-tuning-" + host_name() + ".txt";
+    }
+
+    std::string tuning_str(const tuning_params &x) {
+        std::string s = "version " + std::to_string(tuning_version) + "\n";
+        s += "host " + tuning_host() + "\n";
+        char buf[128];
+        const auto line = [&](const char *key, ssize_t v) {
+            snprintf(buf, sizeof(buf), "%s %lld\n", key, (long long) v);
+            s += buf;
+        };
+        const auto fline = [&](const char *key, double v) {
+            snprintf(buf, sizeof(buf), "%s %.9g\n", key, v);
+            s += buf;
+        };
+        line("l1d_bytes", x.l1d_bytes);
+        line("l2_bytes", x.l2_bytes);
+        line("l3_bytes", x.l3_bytes);
+        line("cache_line_bytes", x.cache_line_bytes);
+        line("nthreads", x.nthreads);
+        fline("thread_start_ns", x.thread_start_ns);
+        fline("stream_bytes_per_ns", x.stream_bytes_per_ns);
+        line("grain_bytes", x.grain_bytes);
+        line("chunk_bytes", x.chunk_bytes);
+        line("panel", x.panel);
+        return s;
+    }
+
+    tuning_params parse_tuning(const std::string &s, std::string *host) {
+        std::map<std::string, std::string> kv;
+        size_t pos = 0;
+        while (pos < s.size()) {
+            size_t e = s.find('\n', pos);
+            if (e == std::string::npos)
+                e = s.size();
+            const std::string l = s.substr(pos, e - pos);
+            const size_t sp = l.find(' ');
+            if (sp != std::string::npos)
+                kv[l.substr(0, sp)] = l.substr(sp + 1);
+            pos = e + 1;
+        }
+        const auto get = [&](const char *key) -> const std::string & {
+            const auto it = kv.find(key);
+            if (it == kv.end())
+                throw std::runtime_error(std::string("parse_tuning: missing ") + key);
+            return it->second;
+        };
+        const auto num = [&](const char *key) {
+            const std::string &v = get(key);
+            char *end = nullptr;
+            const double x = strtod(v.c_str(), &end);
+            if (end == v.c_str() || *end != 0 || !(x >= 0))
+                throw std::runtime_error(std::string("parse_tuning: bad ") + key + " '" + v + "'");
+            return x;
+        };
+        if (num("version") != tuning_version)
+            throw std::runtime_error("parse_tuning: unsupported version " + get("version"));
+        if (host)
+            *host = get("host");
+        tuning_params p;
+        p.l1d_bytes = ssize_t(num("l1d_bytes"));
+        p.l2_bytes = ssize_t(num("l2_bytes"));
+        p.l3_bytes = ssize_t(num("l3_bytes"));
+        p.cache_line_bytes = ssize_t(num("cache_line_bytes"));
+        p.nthreads = ssize_t(num("nthreads"));
+        p.thread_start_ns = num("thread_start_ns");
+        p.stream_bytes_per_ns = num("stream_bytes_per_ns");
+        p.grain_bytes = ssize_t(num("grain_bytes"));
+        p.chunk_bytes = ssize_t(num("chunk_bytes"));
+        p.panel = ssize_t(num("panel"));
+        return p;
+    }
+
+    const tuning_params &tuning() {
+        const tuning_params *t = active.load(std::memory_order_acquire);
+        if (t)
+            return *t;
+        std::lock_guard<std::mutex> lock(active_mutex);
+        t = active.load(std::memory_order_relaxed);
+        if (t)
+            return *t;
+        const std::string path = tuning_cache_path();
+        std::string s;
+        if (!path.empty() && read_file(path, s)) {
+            try {
+                std::string host;
+                const tuning_params p = parse_tuning(s, &host);
+                if (host == tuning_host())
+                    return install(p);
+            } catch (const std::runtime_error &) {
+                //stale or damaged, recalibrated below
+            }
+        }
+        const tuning_params p = calibrate_tuning();
+        if (!path.empty())
+            write_file(path, tuning_str(p));
+        return install(p);
+    }
+
+    void set_tuning(const tuning_params &x) {
+        std::lock_guard<std::mutex> lock(active_mutex);
+        install(x);
+    }
+
+    const tuning_params &retune() {
+        const tuning_params p = calibrate_tuning();
+        const std::string path = tuning_cache_path();
+        if (!path.empty())
+            write_file(path, tuning_str(p));
+        std::lock_guard<std::mutex> lock(active_mutex);
+        return install(p);
+    }
+
+}
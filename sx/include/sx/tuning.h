@@ -0,0 +1,71 @@
+#ifndef TUNING_INCLUDED_2251876
+#define TUNING_INCLUDED_2251876
+
+#include <string>
+
+#include "types.h"
+
+//host dependent block sizes and thread thresholds for the blocked and parallel kernels
+//the first tuning() call loads them from the cache file of the host or, if there is none or it was written
+//for a different cpu, probes the caches, runs a few milliseconds of calibration loops and writes the file
+//SX_TUNING_CACHE=path in the environment moves the file, SX_TUNING_CACHE=off turns persistence off
+
+namespace sx {
+
+    struct tuning_params {
+        //probed, sysfs or sysconf where available, typical values otherwise
+        ssize_t l1d_bytes;
+        ssize_t l2_bytes;           //per core
+        ssize_t l3_bytes;           //0 if there is none
+        ssize_t cache_line_bytes;
+        ssize_t nthreads;           //default_thread_count()
+
+        //calibrated
+        double thread_start_ns;     //starting and joining one worker thread
+        double stream_bytes_per_ns; //one thread reading an L2 sized array
+
+        //derived
+        ssize_t grain_bytes;        //least input per thread worth starting it for, e.g. the bands of a parallel where
+        ssize_t chunk_bytes;        //blocks of streaming loops like each, an input and an output block fit in L2
+        ssize_t panel;              //side of the square panels of array2 multiply, three double panels fit in L2
+
+        //grain_bytes, chunk_bytes in elements of T, at least 1
+        template<typename T>
+        ssize_t grain() const {
+            return grain_bytes / ssize_t(sizeof(T)) > 0 ? grain_bytes / ssize_t(sizeof(T)) : 1;
+        }
+
+        template<typename T>
+        ssize_t chunk() const {
+            return chunk_bytes / ssize_t(sizeof(T)) > 0 ? chunk_bytes / ssize_t(sizeof(T)) : 1;
+        }
+    };
+
+    //the parameters in use, see above
+    const tuning_params &tuning();
+
+    //probes and calibrates now, without touching the cache file or the parameters in use
+    tuning_params calibrate_tuning();
+
+    //replaces the parameters in use, e.g. to pin them for reproducible benchmarks
+    //references returned by tuning() earlier stay valid but keep the old values
+    void set_tuning(const tuning_params &x);
+
+    //calibrates, saves and uses the result
+    const tuning_params &retune();
+
+    //"" if persistence is off
+    std::string tuning_cache_path();
+
+    //the cache file format: "key value" lines, the host line identifies the cpu the values were measured on
+    std::string tuning_str(const tuning_params &x);
+
+    //the host line of this machine
+    std::string tuning_host();
+
+    //parses tuning_str(), throws on missing or malformed values
+    tuning_params parse_tuning(const std::string &s, std::string *host = nullptr);
+
+}
+
+#endif
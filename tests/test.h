@@ -0,0 +1,37 @@
+#ifndef TEST_INCLUDED_6604318
+#define TEST_INCLUDED_6604318
+
+#include <string>
+
+//minimal test registry of sx_tests, one executable run by ctest
+//SX_CHECK stays on in release builds, unlike assert
+
+namespace sx {
+    namespace test {
+
+        typedef void (*function)();
+
+        int register_test(const char *name, function f);
+
+        //counts a failed check of the running test
+        void fail(const char *file, int line, const char *expr);
+
+        //runs the tests whose name contains the first argument, all of them without one, returns the exit code
+        int run(int argc, const char *argv[]);
+
+    }
+}
+
+#define SX_TEST_CONCAT2(a, b) a##b
+#define SX_TEST_CONCAT(a, b) SX_TEST_CONCAT2(a, b)
+
+#define SX_TEST(name) \
+    static void SX_TEST_CONCAT(test_, name)(); \
+    static const int SX_TEST_CONCAT(test_registered_, name) = \
+        ::sx::test::register_test(#name, &SX_TEST_CONCAT(test_, name)); \
+    static void SX_TEST_CONCAT(test_, name)()
+
+#define SX_CHECK(expr) \
+    ((expr) ? (void) 0 : ::sx::test::fail(__FILE__, __LINE__, #expr))
+
+#endif
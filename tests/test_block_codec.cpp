@@ -0,0 +1,45 @@
+#include "test.h"
+
+#include <stdexcept>
+
+#include "sx/block_codec.h"
+
+namespace sx {
+
+    SX_TEST(compress_caps_the_block_size) {
+        const darray1<int> x = {5, 6, 7, 9, 9, 9};
+        bool threw = false;
+        try {
+            compress(x, block_encoding::rle, max_codec_block_size<int>() + 1);
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        SX_CHECK(threw);
+        for (block_encoding enc : {block_encoding::raw, block_encoding::frame_of_reference, block_encoding::delta,
+                block_encoding::rle, block_encoding::automatic}) {
+            const dcompressed_array1<int> c = compress(x, enc, max_codec_block_size<int>());
+            const darray1<int> y = c.decode(0, x.size());
+            SX_CHECK(y.size() == x.size() && y[0] == 5 && y[5] == 9);
+        }
+    }
+
+    SX_TEST(compressed_slices_across_block_boundaries) {
+        //runs, a sorted stretch and scattered values, so every encoding gets blocks it suits and blocks it doesn't
+        darray1<int> x(103);
+        for (ssize_t i = 0; i < x.size(); ++i)
+            x[i] = i < 30 ? 7 : i < 70 ? int(1000 + 3 * i) : int((i * 7919) % 251) - 100;
+        for (block_encoding enc : {block_encoding::raw, block_encoding::frame_of_reference, block_encoding::delta,
+                block_encoding::rle, block_encoding::automatic}) {
+            const dcompressed_array1<int> c = compress(x, enc, 16);
+            const ssize_t ranges[][2] = {{0, 103}, {5, 40}, {15, 17}, {16, 32}, {31, 97}, {100, 103}, {50, 50}};
+            for (const auto &r : ranges) {
+                const darray1<int> y = c.decode(r[0], r[1]);
+                bool same = y.size() == r[1] - r[0];
+                for (ssize_t i = 0; same && i < y.size(); ++i)
+                    same = y[i] == x[r[0] + i];
+                SX_CHECK(same);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,50 @@
+#include "test.h"
+
+#include "sx/broadcast.h"
+#include "sx/segmented_array.h"
+#include "sx/tiled_array2.h"
+
+namespace sx {
+
+    namespace {
+        //r * 10 + c
+        template<typename A>
+        void fill(A &a) {
+            for (ssize_t r = 0; r < a.nr(); ++r)
+                for (ssize_t c = 0; c < a.nc(); ++c)
+                    a(r, c) = double(r * 10 + c);
+        }
+    }
+
+    SX_TEST(broadcast_ops_on_tiled_darray2) {
+        tiled_darray2<double, 1> a(3, 5), b(3, 5, 2.0);
+        fill(a);
+        darray2<double> sum = a + b, diff = a - b, prod = a * b, quot = a / b;
+        SX_CHECK(sum.nr() == 3 && sum.nc() == 5);
+        SX_CHECK(sum(2, 4) == 26.0 && diff(2, 4) == 22.0 && prod(2, 4) == 48.0 && quot(2, 4) == 12.0);
+        darray2<double> scaled = a * 2.0, shifted = 1.0 + a, halved = a / 2.0, negated = 0.0 - a;
+        SX_CHECK(scaled(1, 3) == 26.0 && shifted(1, 3) == 14.0 && halved(1, 3) == 6.5 && negated(1, 3) == -13.0);
+        darray1<double> row(5, 1.0);
+        darray2<double> plus_row = a + row;
+        SX_CHECK(plus_row(2, 0) == 21.0);
+        darray2<double> dense(3, 5, 1.0);
+        darray2<double> mixed = dense - a;
+        SX_CHECK(mixed(0, 1) == 0.0 && mixed(2, 2) == -21.0);
+        darray2<double> col(3, 1, 100.0);
+        darray2<double> plus_col = a + col;
+        SX_CHECK(plus_col(2, 4) == 124.0);
+    }
+
+    SX_TEST(broadcast_ops_on_segmented_darray2) {
+        segmented_darray2<double, 3> a(4);
+        for (int r = 0; r < 5; ++r)
+            a.append_row(darray1<double>(4, double(r)));
+        darray2<double> sum = a + a, diff = a - 1.0, prod = a * 2.0, quot = 8.0 / (a + 1.0);
+        SX_CHECK(sum.nr() == 5 && sum.nc() == 4);
+        SX_CHECK(sum(4, 3) == 8.0 && diff(4, 0) == 3.0 && prod(3, 2) == 6.0 && quot(1, 1) == 4.0);
+        tiled_darray2<double> t(5, 4, 3.0);
+        darray2<double> both = a * t;
+        SX_CHECK(both(2, 1) == 6.0);
+    }
+
+}
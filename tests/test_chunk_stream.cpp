@@ -0,0 +1,43 @@
+#include "test.h"
+
+#include <stdexcept>
+
+#include "sx/chunk_stream.h"
+
+namespace sx {
+
+    SX_TEST(chunk_stream_zip_with_itself_throws) {
+        darray1<int> a(12);
+        for (ssize_t i = 0; i < a.size(); ++i)
+            a[i] = int(i);
+        const chunk_stream<int> st = stream_chunks(a, 3);
+        int threw = 0;
+        try {
+            collect(st * st);
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        try {
+            collect(each([](int x) { return x + 1; }, st) + st);
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        try {
+            collect(where(st > 5) * each([](int x) { return ssize_t(x); }, st));
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        SX_CHECK(threw == 3);
+    }
+
+    SX_TEST(chunk_stream_zip_of_two_sources_over_the_same_data) {
+        darray1<int> a(12);
+        for (ssize_t i = 0; i < a.size(); ++i)
+            a[i] = int(i);
+        const darray1<int> r = collect(stream_chunks(a, 3) * stream_chunks(a, 5));
+        SX_CHECK(r.size() == 12);
+        for (ssize_t i = 0; i < r.size(); ++i)
+            SX_CHECK(r[i] == int(i * i));
+    }
+
+}
@@ -0,0 +1,59 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace sx {
+    namespace test {
+
+        namespace {
+            std::vector<std::pair<const char *, function>> &registry() {
+                static std::vector<std::pair<const char *, function>> r;
+                return r;
+            }
+
+            int failures = 0;
+        }
+
+        int register_test(const char *name, function f) {
+            registry().push_back(std::make_pair(name, f));
+            return 0;
+        }
+
+        void fail(const char *file, int line, const char *expr) {
+            fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+            ++failures;
+        }
+
+        int run(int argc, const char *argv[]) {
+            const char *filter = argc > 1 ? argv[1] : "";
+            int failed = 0, ran = 0;
+            for (auto &t : registry()) {
+                if (!strstr(t.first, filter))
+                    continue;
+                const int before = failures;
+                try {
+                    t.second();
+                } catch (std::exception &e) {
+                    fprintf(stderr, "%s: exception: %s\n", t.first, e.what());
+                    ++failures;
+                }
+                ++ran;
+                const bool ok = failures == before;
+                failed += !ok;
+                printf("%-40s %s\n", t.first, ok ? "ok" : "FAILED");
+            }
+            printf("%d of %d tests failed\n", failed, ran);
+            return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    return sx::test::run(argc, argv);
+}
@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "sx/memory_resource.h"
+#include "sx/scratch_allocator.h"
+#include "sx/dynamic_bitset.h"
+#include "sx/eager_ops.h"
+
+//counts every global allocation of the process, the pipeline below must not make any
+namespace {
+    long global_allocations = 0;
+}
+
+void *operator new(size_t n) {
+    ++global_allocations;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+namespace sx {
+
+    SX_TEST(memory_resource_pipeline_makes_no_global_allocation) {
+        static char buffer[1 << 20];
+        //kernel dispatch and the thread's default resource initialize lazily, once
+        {
+            dynamic_bitset b(64);
+            b.count();
+            const long counted = global_allocations;
+            darray1<double> x(4, 1.0);
+            SX_CHECK(global_allocations > counted);
+            sum(x);
+            default_resource();
+        }
+        const long before = global_allocations;
+        {
+            monotonic_buffer_resource mr(buffer, sizeof(buffer), null_resource());
+            resource_scope scope(&mr);
+
+            pmr::darray1<double> x(1000, 0.0, &mr);
+            for (ssize_t i = 0; i < x.size(); ++i)
+                x[i] = double((i * 37) % 100);
+            pmr::darray1<double> y;
+            for (int i = 0; i < 1000; ++i)
+                y.push_back(i);
+            SX_CHECK(y.get_allocator().resource() == &mr);
+
+            auto order = grade_up<polymorphic_allocator>(x);
+            auto hits = where<polymorphic_allocator>(x);
+            auto pieces = cut<polymorphic_allocator>(hits, x);
+            auto longer = horzcat<polymorphic_allocator>(x, 1.0);
+            SX_CHECK(order.size() == 1000 && x[order[0]] == 0.0);
+            SX_CHECK(hits.size() == 990 && pieces.size() == hits.size());
+            SX_CHECK(longer.size() == 1001 && longer[1000] == 1.0);
+
+            dynamic_bitset a(5000), b(5000, 0, &mr);
+            for (size_t i = 0; i < 5000; i += 3)
+                a.set(i);
+            for (size_t i = 0; i < 5000; i += 5)
+                b.set(i);
+            dynamic_bitset c = a & b;
+            c |= b;
+            dynamic_bitset d = c << 3;
+            SX_CHECK((a & b).count() == 334);
+            SX_CHECK(d.get_allocator().resource() == &mr);
+
+            pmr::darray2<int> m(10, 10, 0, &mr);
+            SX_CHECK(mr.bytes_used() > 0 && mr.bytes_used() < sizeof(buffer));
+        }
+        SX_CHECK(global_allocations == before);
+    }
+
+    SX_TEST(monotonic_buffer_resource_null_upstream_throws_when_full) {
+        static char buffer[4096];
+        monotonic_buffer_resource mr(buffer, sizeof(buffer), null_resource());
+        bool threw = false;
+        try {
+            pmr::darray1<char> big(8192, 'a', &mr);
+        } catch (std::bad_alloc &) {
+            threw = true;
+        }
+        SX_CHECK(threw);
+    }
+
+    SX_TEST(monotonic_buffer_resource_grows_upstream_and_releases) {
+        monotonic_buffer_resource mr(64);
+        pmr::darray1<int> v(&mr);
+        for (int i = 0; i < 100000; ++i)
+            v.push_back(i);
+        SX_CHECK(v[99999] == 99999);
+        v.clear();
+        mr.release();
+        SX_CHECK(mr.bytes_used() == 0);
+    }
+
+    SX_TEST(scratch_arena_aligns_allocations_in_new_blocks) {
+        scratch_arena arena;
+        const size_t aligns[] = {alignof(std::max_align_t), 256, 4096};
+        for (size_t align : aligns) {
+            //the first allocation and one too large for any cached block both start a new block
+            void *p = arena.allocate(24, align);
+            void *q = arena.allocate(size_t(1) << 20, align);
+            SX_CHECK(reinterpret_cast<uintptr_t>(p) % align == 0 && arena.owns(p));
+            SX_CHECK(reinterpret_cast<uintptr_t>(q) % align == 0 && arena.owns(static_cast<char *>(q) + (1 << 20) - 1));
+        }
+    }
+
+}
@@ -0,0 +1,43 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "sx/prefetch_reader.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+
+namespace sx {
+
+    SX_TEST(prefetch_reader_keeps_depth_reads_in_flight_while_a_chunk_is_held) {
+        char path[] = "/tmp/sx_prefetch_XXXXXX";
+        const int fd = mkstemp(path);
+        SX_CHECK(fd >= 0);
+        const std::string data(10 * 64 + 5, 'x');
+        SX_CHECK(write(fd, data.data(), data.size()) == ssize_t(data.size()));
+        close(fd);
+        for (prefetch_reader::backend engine : {prefetch_reader::backend::threads, prefetch_reader::backend::automatic}) {
+            for (ssize_t depth : {1, 4}) {
+                prefetch_reader::options opts;
+                opts.chunk_bytes = 64;
+                opts.depth = depth;
+                opts.engine = engine;
+                prefetch_reader r(path, 0, -1, opts);
+                ssize_t chunks = 0, bytes = 0;
+                for (array1<char> c = r.next(); c.size() > 0; c = r.next()) {
+                    ++chunks;
+                    bytes += c.size();
+                    //11 chunks, the ones after this one are being read
+                    SX_CHECK(r.in_flight() == std::min<ssize_t>(depth, 11 - chunks));
+                }
+                SX_CHECK(chunks == 11 && bytes == ssize_t(data.size()));
+            }
+        }
+        remove(path);
+    }
+
+}
+
+#endif
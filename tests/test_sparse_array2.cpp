@@ -0,0 +1,57 @@
+#include "test.h"
+
+#include "sx/sparse_array2.h"
+
+namespace sx {
+
+    SX_TEST(spmm_with_no_columns) {
+        darray2<double> dense(2, 3, 0.0);
+        dense(0, 1) = 2.0;
+        dense(1, 2) = 3.0;
+        const darray2<double> b(3, 0);
+        const darray2<double> r1 = spmm(csr_from_dense(dense), b);
+        SX_CHECK(r1.nr() == 2 && r1.nc() == 0);
+        const darray2<double> r2 = spmm(csc_from_dense(dense), b);
+        SX_CHECK(r2.nr() == 2 && r2.nc() == 0);
+    }
+
+    SX_TEST(spmm_matches_dense_product) {
+        darray2<double> dense(2, 3, 0.0);
+        dense(0, 1) = 2.0;
+        dense(1, 2) = 3.0;
+        darray2<double> b(3, 2, 1.0);
+        b(2, 1) = 5.0;
+        const darray2<double> r = spmm(csr_from_dense(dense), b);
+        SX_CHECK(r(0, 0) == 2.0 && r(0, 1) == 2.0 && r(1, 0) == 3.0 && r(1, 1) == 15.0);
+    }
+
+    SX_TEST(dsparse_array2_rejects_out_of_bounds_arrays) {
+        typedef dsparse_array2<double> csr;
+        //2x3, rows {1: 2.0} and {2: 3.0}
+        const csr ok(2, 3, darray1<ssize_t>{0, 1, 2}, darray1<ssize_t>{1, 2}, darray1<double>{2.0, 3.0});
+        SX_CHECK(ok.nr() == 2 && ok.nc() == 3);
+        int threw = 0;
+        try {
+            csr(2, 3, darray1<ssize_t>{1, 1, 2}, darray1<ssize_t>{1, 2}, darray1<double>{2.0, 3.0});
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        try {
+            csr(2, 3, darray1<ssize_t>{0, 3, 2}, darray1<ssize_t>{1, 2}, darray1<double>{2.0, 3.0});
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        try {
+            csr(2, 3, darray1<ssize_t>{0, 1, 2}, darray1<ssize_t>{1, 3}, darray1<double>{2.0, 3.0});
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        try {
+            csr(2, 3, darray1<ssize_t>{0, 1, 2}, darray1<ssize_t>{-1, 2}, darray1<double>{2.0, 3.0});
+        } catch (const std::runtime_error &) {
+            ++threw;
+        }
+        SX_CHECK(threw == 4);
+    }
+
+}
@@ -0,0 +1,27 @@
+#include "test.h"
+
+#include "sx/stencil.h"
+
+namespace sx {
+
+    SX_TEST(stencil_of_empty_source) {
+        const darray2<double> kernel(3, 3, 1.0);
+        const darray1<double> k1(3, 1.0);
+        for (border_mode mode : {border_mode::constant, border_mode::replicate, border_mode::reflect, border_mode::wrap}) {
+            for (ssize_t nr : {0, 3}) {
+                const darray2<double> src(nr, nr == 0 ? 3 : 0);
+                darray2<double> dst = stencil(src, kernel, mode);
+                SX_CHECK(dst.nr() == src.nr() && dst.nc() == src.nc());
+                dst = stencil_separable(src, k1, k1, mode);
+                SX_CHECK(dst.nr() == src.nr() && dst.nc() == src.nc());
+            }
+        }
+    }
+
+    SX_TEST(stencil_wrap_sums_neighbours) {
+        darray2<double> src(2, 3, 1.0);
+        const darray2<double> dst = stencil(src, darray2<double>(3, 3, 1.0), border_mode::wrap);
+        SX_CHECK(dst(0, 0) == 9.0 && dst(1, 2) == 9.0);
+    }
+
+}
@@ -0,0 +1,33 @@
+#include "test.h"
+
+#include <set>
+#include <string>
+#include <thread>
+
+#include "sx/trace.h"
+
+namespace sx {
+
+    SX_TEST(trace_reuses_buffers_of_exited_threads) {
+        clear_trace();
+        for (int i = 0; i < 20; ++i) {
+            std::thread t([] {
+                trace_span span("test_thread", 1, 0);
+            });
+            t.join();
+        }
+        //one after the other, so every thread takes the buffer the previous one gave back
+        const std::string json = chrome_trace_json();
+        std::set<std::string> tids;
+        int spans = 0;
+        for (size_t p = json.find("\"test_thread\""); p != std::string::npos; p = json.find("\"test_thread\"", p + 1)) {
+            const size_t t = json.find("\"tid\":", p);
+            tids.insert(json.substr(t, json.find(',', t) - t));
+            ++spans;
+        }
+        SX_CHECK(spans == 20);
+        SX_CHECK(tids.size() == 1);
+        clear_trace();
+    }
+
+}
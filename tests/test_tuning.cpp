@@ -0,0 +1,47 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "sx/tuning.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+namespace sx {
+
+#ifndef _WIN32
+    SX_TEST(retune_writes_the_cache_file_without_leftovers) {
+        char dir[] = "/tmp/sx_tuning_XXXXXX";
+        SX_CHECK(mkdtemp(dir) != nullptr);
+        const std::string path = std::string(dir) + "/tuning.txt";
+        setenv("SX_TUNING_CACHE", path.c_str(), 1);
+        const tuning_params p = retune();
+        unsetenv("SX_TUNING_CACHE");
+
+        FILE *f = fopen(path.c_str(), "rb");
+        SX_CHECK(f != nullptr);
+        std::string s;
+        char buf[256];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            s.append(buf, n);
+        fclose(f);
+        SX_CHECK(parse_tuning(s).grain_bytes == p.grain_bytes);
+
+        //the temporary was renamed over the cache file
+        int entries = 0;
+        DIR *d = opendir(dir);
+        while (dirent *e = readdir(d))
+            entries += std::string(e->d_name) != "." && std::string(e->d_name) != "..";
+        closedir(d);
+        SX_CHECK(entries == 1);
+        remove(path.c_str());
+        rmdir(dir);
+    }
+#endif
+
+}